@@ -0,0 +1,423 @@
+#include "analysis.h"
+#include <stdlib.h>
+
+#define PURITY_UNKNOWN 0
+#define PURITY_PURE    1
+#define PURITY_IMPURE  2
+
+#define DECLARATION_HASH_SEED 14695981039346656037ull
+#define DECLARATION_HASH_PRIME 1099511628211ull
+
+//A call from the lambda declared in caller's slot to the one in callee's
+typedef struct PurityEdge_s {
+    int callee;
+    int caller;
+} PurityEdge;
+
+VEC_DECLARE(PurityEdge)
+
+typedef struct PurityGraph_s {
+    ASTNode** declared;
+    int* firsts;
+    int* callers;
+} PurityGraph;
+
+size_t DeclarationIndex_position(DeclarationIndexEntry* entries, size_t capacity, String* name) {
+
+    unsigned long long hash = DECLARATION_HASH_SEED;
+    size_t position;
+
+    for(size_t i = 0; i < name->length; i++) hash = (hash ^ (unsigned char)name->data[i]) * DECLARATION_HASH_PRIME;
+
+    for(position = (size_t)hash & (capacity - 1); entries[position].declaration != 0;
+        position = (position + 1) & (capacity - 1)) {
+
+        if(String_equals((String*)entries[position].declaration->DN_SYMBOL->SN_TEXT, name)) break;
+    }
+
+    return position;
+}
+
+char* DeclarationIndex_build(DeclarationIndex* index, ASTNode* module) {
+
+    char* error;
+
+    index->capacity = 16;
+    index->count = 0;
+    index->slotCount = 0;
+
+    while(index->capacity < (size_t)module->childCount * 2) index->capacity *= 2;
+
+    if((index->entries = (DeclarationIndexEntry*)calloc(index->capacity, sizeof(DeclarationIndexEntry))) == 0) {
+
+        return "Unable to allocate space for the declaration index";
+    }
+
+    for(int i = 0; i < module->childCount; i++) {
+
+        if(module->children[i]->type != Declaration) continue;
+
+        if((error = DeclarationIndex_add(index, module->children[i])) != 0) {
+
+            DeclarationIndex_cleanUp(index);
+
+            return error;
+        }
+    }
+
+    return 0;
+}
+
+char* DeclarationIndex_add(DeclarationIndex* index, ASTNode* declaration) {
+
+    size_t position;
+
+    if(index->count + 1 > index->capacity / 2) {
+
+        size_t capacity = index->capacity * 2;
+        DeclarationIndexEntry* entries = (DeclarationIndexEntry*)calloc(capacity, sizeof(DeclarationIndexEntry));
+
+        if(entries == 0) return "Unable to allocate space for the declaration index";
+
+        for(size_t i = 0; i < index->capacity; i++) {
+
+            if(index->entries[i].declaration == 0) continue;
+
+            entries[DeclarationIndex_position(entries, capacity,
+                (String*)index->entries[i].declaration->DN_SYMBOL->SN_TEXT)] = index->entries[i];
+        }
+
+        free(index->entries);
+
+        index->entries = entries;
+        index->capacity = capacity;
+    }
+
+    position = DeclarationIndex_position(index->entries, index->capacity, (String*)declaration->DN_SYMBOL->SN_TEXT);
+
+    if(index->entries[position].declaration == 0) {
+
+        index->entries[position].declaration = declaration;
+        index->entries[position].slot = index->slotCount;
+        index->count++;
+    }
+
+    index->slotCount++;
+
+    return 0;
+}
+
+DeclarationIndexEntry* DeclarationIndex_find(DeclarationIndex* index, String* name) {
+
+    DeclarationIndexEntry* entry = &index->entries[DeclarationIndex_position(index->entries, index->capacity, name)];
+
+    return entry->declaration == 0 ? 0 : entry;
+}
+
+char* DeclarationIndex_findLambda(DeclarationIndex* index, String* name, ASTNode** lambda) {
+
+    DeclarationIndexEntry* entry = DeclarationIndex_find(index, name);
+
+    if(entry == 0) return "No top-level declaration found for symbol";
+
+    if(!ASTDeclarationNode_IsLambda(entry->declaration)) return "Symbol is not declared as a lambda";
+
+    *lambda = entry->declaration->DN_INITIALIZER;
+
+    return 0;
+}
+
+void DeclarationIndex_cleanUp(DeclarationIndex* index) {
+
+    free(index->entries);
+
+    index->entries = 0;
+    index->capacity = index->count = 0;
+}
+
+char* Module_findDeclaration(ASTNode* module, String* name, ASTNode** declaration) {
+
+    for(int i = 0; i < module->childCount; i++) {
+
+        ASTNode* statement = module->children[i];
+
+        if(statement->type != Declaration) continue;
+
+        if(!String_equals((String*)statement->DN_SYMBOL->SN_TEXT, name)) continue;
+
+        *declaration = statement;
+
+        return 0;
+    }
+
+    return "No top-level declaration found for symbol";
+}
+
+char* Module_findLambda(ASTNode* module, String* name, ASTNode** lambda) {
+
+    char* error;
+    ASTNode* declaration;
+
+    if((error = Module_findDeclaration(module, name, &declaration)) != 0) return error;
+
+    if(declaration->DN_INITIALIZER == 0 || declaration->DN_INITIALIZER->type != Lambda) {
+
+        return "Symbol is not declared as a lambda";
+    }
+
+    *lambda = declaration->DN_INITIALIZER;
+
+    return 0;
+}
+
+int ASTLambdaNode_findParameter(ASTNode* lambda, String* name) {
+
+    ASTNode* parameters = lambda->LN_PARAMS;
+
+    for(int i = 0; i < parameters->childCount; i++) {
+
+        if(String_equals((String*)parameters->children[i]->PN_SYMBOL->SN_TEXT, name)) return i;
+    }
+
+    return -1;
+}
+
+int ASTNode_invokesSymbol(ASTNode* node, String* name) {
+
+    if(node == 0) return 0;
+
+    if(node->type == Invocation && String_equals((String*)node->IN_SYMBOL->SN_TEXT, name)) return 1;
+
+    for(int i = 0; i < node->childCount; i++) {
+
+        if(ASTNode_invokesSymbol(node->children[i], name)) return 1;
+    }
+
+    return 0;
+}
+
+//An expression is pure when it only combines number literals and the lambda's
+//own parameters through operators and invocations of other pure lambdas
+int ASTNode_isPureExpression(DeclarationIndex* index, ASTNode* lambda, ASTNode* node) {
+
+    ASTNode* callee;
+
+    switch(node->type) {
+
+        case NumberLiteral:
+            return 1;
+
+        case Symbol:
+            return ASTLambdaNode_findParameter(lambda, (String*)node->SN_TEXT) >= 0;
+
+        case Operator:
+            return ASTNode_isPureExpression(index, lambda, node->ON_LEFT_EXPR) &&
+                ASTNode_isPureExpression(index, lambda, node->ON_RIGHT_EXPR);
+
+        case Invocation:
+            if(ASTLambdaNode_findParameter(lambda, (String*)node->IN_SYMBOL->SN_TEXT) >= 0) return 0;
+
+            if(DeclarationIndex_findLambda(index, (String*)node->IN_SYMBOL->SN_TEXT, &callee) != 0) return 0;
+
+            if(callee->LN_PURE == (void*)PURITY_IMPURE) return 0;
+
+            if(callee->LN_PARAMS->childCount != node->IN_ARGS->childCount) return 0;
+
+            for(int i = 0; i < node->IN_ARGS->childCount; i++) {
+
+                if(!ASTNode_isPureExpression(index, lambda, node->IN_ARGS->children[i])) return 0;
+            }
+
+            return 1;
+
+        default:
+            return 0;
+    }
+}
+
+char* Purity_collectLambda(ASTNode* node, void* void_list) {
+
+    if(node->type != Lambda) return 0;
+
+    node->LN_PURE = (void*)PURITY_PURE;
+
+    return Vec_ASTNodePtr_add((VEC(ASTNodePtr)*)void_list, node);
+}
+
+//Records a call to every declared lambda that node's body invokes by name.
+//Nested lambdas make their enclosing lambda impure by themselves
+char* Purity_collectCalls(DeclarationIndex* index, ASTNode* lambda, ASTNode* node, int caller,
+    VEC(PurityEdge)* edges) {
+
+    char* error;
+    DeclarationIndexEntry* callee;
+
+    if(node == 0 || node->type == Lambda) return 0;
+
+    if(node->type == Invocation && ASTLambdaNode_findParameter(lambda, (String*)node->IN_SYMBOL->SN_TEXT) < 0 &&
+        (callee = DeclarationIndex_find(index, (String*)node->IN_SYMBOL->SN_TEXT)) != 0 &&
+        ASTDeclarationNode_IsLambda(callee->declaration)) {
+
+        if((error = Vec_PurityEdge_add(edges, (PurityEdge){ callee->slot, caller })) != 0) return error;
+    }
+
+    for(int i = 0; i < node->childCount; i++) {
+
+        if((error = Purity_collectCalls(index, lambda, node->children[i], caller, edges)) != 0) return error;
+    }
+
+    return 0;
+}
+
+//The lambda declared in every slot and, grouped by that slot, the slots of
+//the declared lambdas calling it
+char* PurityGraph_build(PurityGraph* graph, DeclarationIndex* index) {
+
+    char* error;
+    VEC(PurityEdge) edges;
+
+    graph->declared = (ASTNode**)calloc(index->slotCount + 1, sizeof(ASTNode*));
+    graph->firsts = (int*)calloc(index->slotCount + 1, sizeof(int));
+    graph->callers = 0;
+
+    if(graph->declared == 0 || graph->firsts == 0) return "Unable to allocate space for the purity call graph";
+
+    Vec_PurityEdge_init(&edges, 0);
+
+    for(size_t i = 0; i < index->capacity; i++) {
+
+        DeclarationIndexEntry* entry = &index->entries[i];
+        ASTNode* lambda;
+
+        if(entry->declaration == 0 || !ASTDeclarationNode_IsLambda(entry->declaration)) continue;
+
+        lambda = graph->declared[entry->slot] = entry->declaration->DN_INITIALIZER;
+
+        if((error = Purity_collectCalls(index, lambda, lambda->LN_EXPR, entry->slot, &edges)) != 0) {
+
+            Vec_PurityEdge_cleanUp(&edges);
+
+            return error;
+        }
+    }
+
+    if((graph->callers = (int*)malloc((edges.count + 1) * sizeof(int))) == 0) {
+
+        Vec_PurityEdge_cleanUp(&edges);
+
+        return "Unable to allocate space for the purity call graph";
+    }
+
+    //Counting sort by callee, each first ends up just past its callers and
+    //is moved back to their start
+    for(size_t i = 0; i < edges.count; i++) graph->firsts[edges.data[i].callee + 1]++;
+
+    for(int i = 0; i < index->slotCount; i++) graph->firsts[i + 1] += graph->firsts[i];
+
+    for(size_t i = 0; i < edges.count; i++) graph->callers[graph->firsts[edges.data[i].callee]++] = edges.data[i].caller;
+
+    for(int i = index->slotCount; i > 0; i--) graph->firsts[i] = graph->firsts[i - 1];
+
+    graph->firsts[0] = 0;
+
+    Vec_PurityEdge_cleanUp(&edges);
+
+    return 0;
+}
+
+void PurityGraph_cleanUp(PurityGraph* graph) {
+
+    free(graph->declared);
+    free(graph->firsts);
+    free(graph->callers);
+}
+
+int Purity_strip(DeclarationIndex* index, ASTNode* lambda, PassStats* stats) {
+
+    if(lambda->LN_PURE == (void*)PURITY_IMPURE) return 0;
+
+    stats->nodesVisited++;
+
+    if(ASTNode_isPureExpression(index, lambda, lambda->LN_EXPR)) return 0;
+
+    lambda->LN_PURE = (void*)PURITY_IMPURE;
+    stats->nodesChanged++;
+
+    return 1;
+}
+
+//Optimistically assumes every lambda is pure and strips the mark from the
+//declared lambdas whose bodies are not, then from their callers through a
+//worklist, so that recursive and mutually recursive lambdas can still be
+//found pure. A caller is only checked again when a lambda it calls turns
+//impure, which turns it impure as well, so every call is followed once.
+//Lambdas without a name can not be called and are checked last
+char* Purity_settle(DeclarationIndex* index, VEC(ASTNodePtr)* lambdas, PassStats* stats) {
+
+    char* error;
+    PurityGraph graph;
+    int* worklist;
+    int pending = 0;
+
+    if((error = PurityGraph_build(&graph, index)) != 0) {
+
+        PurityGraph_cleanUp(&graph);
+
+        return error;
+    }
+
+    if((worklist = (int*)malloc((index->slotCount + 1) * sizeof(int))) == 0) {
+
+        PurityGraph_cleanUp(&graph);
+
+        return "Unable to allocate space for the purity worklist";
+    }
+
+    for(int slot = 0; slot < index->slotCount; slot++) {
+
+        if(graph.declared[slot] != 0 && Purity_strip(index, graph.declared[slot], stats)) worklist[pending++] = slot;
+    }
+
+    while(pending > 0) {
+
+        int callee = worklist[--pending];
+
+        for(int i = graph.firsts[callee]; i < graph.firsts[callee + 1]; i++) {
+
+            if(Purity_strip(index, graph.declared[graph.callers[i]], stats)) worklist[pending++] = graph.callers[i];
+        }
+    }
+
+    for(int i = 0; i < lambdas->count; i++) Purity_strip(index, lambdas->data[i], stats);
+
+    free(worklist);
+    PurityGraph_cleanUp(&graph);
+
+    return 0;
+}
+
+char* Module_analyzePurity(ASTNode* module, PassStats* stats) {
+
+    char* error;
+    DeclarationIndex index;
+    VEC(ASTNodePtr) lambdas;
+
+    if((error = DeclarationIndex_build(&index, module)) != 0) return error;
+
+    Vec_ASTNodePtr_init(&lambdas, 0);
+
+    if((error = ASTNode_forAll(module, Purity_collectLambda, &lambdas)) == 0) {
+
+        error = Purity_settle(&index, &lambdas, stats);
+    }
+
+    Vec_ASTNodePtr_cleanUp(&lambdas);
+    DeclarationIndex_cleanUp(&index);
+
+    return error;
+}
+
+int ASTLambdaNode_IsPure(ASTNode* node) {
+
+    return node->type == Lambda && node->LN_PURE == (void*)PURITY_PURE;
+}
@@ -0,0 +1,47 @@
+#ifndef ANALYSIS_H
+#define ANALYSIS_H
+
+#include "ast.h"
+#include "string.h"
+
+//The first declaration of every top-level name and its slot, the position of
+//the declaration among the module's declarations. Open addressing on the
+//name's hash, kept at most half full so passes can add the declarations
+//they insert
+typedef struct DeclarationIndexEntry_s {
+    ASTNode* declaration;
+    int slot;
+} DeclarationIndexEntry;
+
+typedef struct DeclarationIndex_s {
+    DeclarationIndexEntry* entries;
+    size_t capacity;
+    size_t count;
+    int slotCount;
+} DeclarationIndex;
+
+char* DeclarationIndex_build(DeclarationIndex* index, ASTNode* module);
+
+//Declarations have to be added in module order, a name already indexed
+//keeps its first declaration but still takes up a slot
+char* DeclarationIndex_add(DeclarationIndex* index, ASTNode* declaration);
+
+DeclarationIndexEntry* DeclarationIndex_find(DeclarationIndex* index, String* name);
+
+char* DeclarationIndex_findLambda(DeclarationIndex* index, String* name, ASTNode** lambda);
+
+void DeclarationIndex_cleanUp(DeclarationIndex* index);
+
+char* Module_findDeclaration(ASTNode* module, String* name, ASTNode** declaration);
+
+char* Module_findLambda(ASTNode* module, String* name, ASTNode** lambda);
+
+int ASTLambdaNode_findParameter(ASTNode* lambda, String* name);
+
+int ASTNode_invokesSymbol(ASTNode* node, String* name);
+
+char* Module_analyzePurity(ASTNode* module, PassStats* stats);
+
+int ASTLambdaNode_IsPure(ASTNode* node);
+
+#endif //ANALYSIS_H
@@ -0,0 +1,61 @@
+#include "arena.h"
+#include <stdalign.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#define ARENA_ALIGN alignof(max_align_t)
+#define ARENA_ROUND(n) (((n) + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1))
+
+void Arena_init(Arena* arena, size_t block_bytes) {
+
+    arena->blocks = 0;
+    arena->blockBytes = block_bytes == 0 ? ARENA_DEFAULT_BLOCK_BYTES : block_bytes;
+}
+
+//Allocations bigger than a block get a block of their own
+char* Arena_alloc(Arena* arena, size_t size, void** out) {
+
+    ArenaBlock* block = arena->blocks;
+    size_t header = ARENA_ROUND(sizeof(ArenaBlock));
+
+    if(size > SIZE_MAX - header - ARENA_ALIGN) return "Arena allocation is too large";
+
+    size = ARENA_ROUND(size);
+
+    if(block == 0 || block->size - block->used < size) {
+
+        size_t block_size = size > arena->blockBytes ? size : arena->blockBytes;
+
+        if((block = (ArenaBlock*)malloc(header + block_size)) == 0) return "Failed to allocate an arena block";
+
+        block->used = 0;
+        block->size = block_size;
+
+        //An oversized block goes behind the current one, which keeps filling
+        if(size > arena->blockBytes && arena->blocks != 0) {
+
+            block->next = arena->blocks->next;
+            arena->blocks->next = block;
+        } else {
+
+            block->next = arena->blocks;
+            arena->blocks = block;
+        }
+    }
+
+    *out = (char*)block + header + block->used;
+    block->used += size;
+
+    return 0;
+}
+
+void Arena_cleanUp(Arena* arena) {
+
+    while(arena->blocks != 0) {
+
+        ArenaBlock* next = arena->blocks->next;
+
+        free(arena->blocks);
+        arena->blocks = next;
+    }
+}
@@ -0,0 +1,26 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+#define ARENA_DEFAULT_BLOCK_BYTES (64 * 1024)
+
+//Blocks are chained newest first and only released all at once
+typedef struct ArenaBlock_s {
+    struct ArenaBlock_s* next;
+    size_t used;
+    size_t size;
+} ArenaBlock;
+
+typedef struct Arena_s {
+    ArenaBlock* blocks;
+    size_t blockBytes;
+} Arena;
+
+void Arena_init(Arena* arena, size_t block_bytes);
+
+char* Arena_alloc(Arena* arena, size_t size, void** out);
+
+void Arena_cleanUp(Arena* arena);
+
+#endif //ARENA_H
@@ -0,0 +1,210 @@
+#ifndef ASMTEMPLATE_H
+#define ASMTEMPLATE_H
+
+//GNU assembler output for x86-64 System V. Every value is a 64-bit register
+//value and arithmetic is done on the low 32 bits to match the C backend's
+//ints. Expressions leave their value in rax and park intermediates on the
+//stack, and parameters are pushed on entry so parameter n lives at
+//-8 - 8n(%rbp). Calls save the stack pointer, realign, pad once for every
+//argument past the sixth and push arguments right to left, so after popping
+//the register arguments the rest are already in place on an aligned stack.
+//Symbols must be resolved before rendering
+TemplateConfig AsmTemplateConfig = {
+    {
+    "asm_module", //Module
+    "", //Declaration
+    "", //Parameter
+    "", //ParameterList
+    "", //Operator
+    "", //Lambda
+    "", //Symbol
+    "", //Invocation
+    "", //ArgumentList
+    "", //StringLiteral
+    "", //NumberLiteral
+    },
+    28,
+    {
+        {
+            "asm_module",
+            "    .text\n"
+            "{{er`{{c`pred`{{t`asm_lambda_body`}}`}}`}}"
+            "    .p2align 4\n"
+            "    .globl main\n"
+            "main:\n"
+            "    pushq %rbp\n"
+            "    movq %rsp, %rbp\n"
+            "{{tc`asm_global_assignments`}}"
+            "{{tc`asm_global_expressions`}}"
+            "    xorl %eax, %eax\n"
+            "    leave\n"
+            "    ret\n"
+            "    .data\n"
+            "    .p2align 3\n"
+            "{{tc`asm_global_declarations`}}"
+            "    .section .rodata\n"
+            "{{tc`asm_string_literals`}}"
+            "    .section .note.GNU-stack,\"\",@progbits\n", 0,
+            ASTNode_IsLambda
+        },
+        {
+            "asm_global_declarations",
+            "{{e`{{c`pred`y_{{sc0a0}}:\n    .quad 0\n{{t`asm_lambda_alias`}}`}}`}}", 0,
+            ASTNode_IsDeclaration
+        },
+        {
+            "asm_lambda_alias",
+            "{{c`pred`    .set y_{{sc0a0}}.fn, Lambda_{{sc1a7}}\n`}}", 0,
+            ASTDeclarationNode_IsLambda
+        },
+        {
+            "asm_global_assignments",
+            "{{e`{{c`pred`{{tc1`asm_expression`}}    movq %rax, y_{{sc0a0}}(%rip)\n`}}`}}", 0,
+            ASTNode_IsDeclaration
+        },
+        {
+            "asm_global_expressions",
+            "{{e`{{c`!pred`{{t`asm_expression`}}`}}`}}", 0,
+            ASTNode_IsDeclaration
+        },
+        {
+            "asm_string_literals",
+            "{{er`{{c`pred`.LS{{l}}:\n    .string \"{{sa0}}\"\n`}}`}}", 0,
+            ASTNode_IsStringLiteral
+        },
+        {
+            "asm_lambda_body",
+            "{{c`a5`    .section .text.unlikely,\"ax\",@progbits\n`}}"
+            "    .p2align 4\n"
+            "Lambda_{{sa7}}:\n"
+            "    pushq %rbp\n"
+            "    movq %rsp, %rbp\n"
+            "{{ec0`{{x`    pushq %rdi\n`    pushq %rsi\n`    pushq %rdx\n`    pushq %rcx\n`    pushq %r8\n`    pushq %r9\n`    pushq {{o`8`-32`}}(%rbp)\n`}}`}}"
+            "{{tc1`asm_expression`}}"
+            "    leave\n"
+            "    ret\n"
+            "{{c`a5`    .text\n`}}", 0, 0
+        },
+        {
+            "asm_expression",
+            "{{tc`asm_operator_expression`}}{{tc`asm_symbol_expression`}}{{tc`asm_invocation_expression`}}"
+            "{{tc`asm_string_expression`}}{{tc`asm_number_expression`}}{{tc`asm_lambda_expression`}}", 0, 0
+        },
+        {
+            "asm_number_expression",
+            "{{c`pred`    movq ${{ia0}}, %rax\n`}}", 0,
+            ASTNode_IsNumberLiteral
+        },
+        {
+            "asm_string_expression",
+            "{{c`pred`    leaq .LS{{l}}(%rip), %rax\n`}}", 0,
+            ASTNode_IsStringLiteral
+        },
+        {
+            "asm_lambda_expression",
+            "{{c`pred`    leaq Lambda_{{sa7}}(%rip), %rax\n`}}", 0,
+            ASTNode_IsLambda
+        },
+        {
+            "asm_symbol_expression",
+            "{{tc`asm_parameter_value`}}{{tc`asm_global_value`}}{{tc`asm_global_lambda_value`}}{{tc`asm_external_value`}}", 0, 0
+        },
+        {
+            "asm_parameter_value",
+            "{{c`pred`    movq {{oa2`-8`-8`}}(%rbp), %rax\n`}}", 0,
+            ASTSymbolNode_IsParameter
+        },
+        {
+            "asm_global_value",
+            "{{c`pred`    movq y_{{sa0}}(%rip), %rax\n`}}", 0,
+            ASTSymbolNode_IsGlobalValue
+        },
+        {
+            "asm_global_lambda_value",
+            "{{c`pred`    leaq y_{{sa0}}.fn(%rip), %rax\n`}}", 0,
+            ASTSymbolNode_IsGlobalLambda
+        },
+        {
+            "asm_external_value",
+            "{{c`pred`    movq {{sa0}}@GOTPCREL(%rip), %rax\n`}}", 0,
+            ASTSymbolNode_IsExternal
+        },
+        {
+            "asm_operator_expression",
+            "{{c`pred`{{tc0`asm_expression`}}"
+            "    pushq %rax\n"
+            "{{tc1`asm_expression`}}"
+            "    movl %eax, %ecx\n"
+            "    popq %rax\n"
+            "{{tc`asm_operator`}}"
+            "    cltq\n`}}", 0,
+            ASTNode_IsOperator
+        },
+        {
+            "asm_operator",
+            "{{tc`asm_add_operator`}}{{tc`asm_sub_operator`}}{{tc`asm_mul_operator`}}{{tc`asm_div_operator`}}", 0, 0
+        },
+        {
+            "asm_add_operator",
+            "{{c`pred`    addl %ecx, %eax\n`}}", 0,
+            ASTOperatorNode_OperatorIsAdd
+        },
+        {
+            "asm_sub_operator",
+            "{{c`pred`    subl %ecx, %eax\n`}}", 0,
+            ASTOperatorNode_OperatorIsSub
+        },
+        {
+            "asm_mul_operator",
+            "{{c`pred`    imull %ecx, %eax\n`}}", 0,
+            ASTOperatorNode_OperatorIsMul
+        },
+        {
+            "asm_div_operator",
+            "{{c`pred`    cltd\n    idivl %ecx\n`}}", 0,
+            ASTOperatorNode_OperatorIsDiv
+        },
+        {
+            "asm_invocation_expression",
+            "{{c`pred`    movq %rsp, %rax\n"
+            "    andq $-16, %rsp\n"
+            "    pushq %rax\n"
+            "    pushq %rax\n"
+            "{{ec1`{{x```````    pushq %rax\n`}}`}}"
+            "{{ec1v`{{t`asm_expression`}}    pushq %rax\n`}}"
+            "{{ec1`{{x`    popq %rdi\n`    popq %rsi\n`    popq %rdx\n`    popq %rcx\n`    popq %r8\n`    popq %r9\n``}}`}}"
+            "    xorl %eax, %eax\n"
+            "{{tc0`asm_call`}}"
+            "{{ec1`{{x```````    addq $16, %rsp\n`}}`}}"
+            "    addq $8, %rsp\n"
+            "    popq %rsp\n`}}", 0,
+            ASTNode_IsInvocation
+        },
+        {
+            "asm_call",
+            "{{tc`asm_direct_call`}}{{tc`asm_external_call`}}{{tc`asm_parameter_call`}}{{tc`asm_global_call`}}", 0, 0
+        },
+        {
+            "asm_direct_call",
+            "{{c`pred`    call y_{{sa0}}.fn\n`}}", 0,
+            ASTSymbolNode_IsGlobalLambda
+        },
+        {
+            "asm_external_call",
+            "{{c`pred`    call {{sa0}}@PLT\n`}}", 0,
+            ASTSymbolNode_IsExternal
+        },
+        {
+            "asm_parameter_call",
+            "{{c`pred`    movq {{oa2`-8`-8`}}(%rbp), %r11\n    call *%r11\n`}}", 0,
+            ASTSymbolNode_IsParameter
+        },
+        {
+            "asm_global_call",
+            "{{c`pred`    movq y_{{sa0}}(%rip), %r11\n    call *%r11\n`}}", 0,
+            ASTSymbolNode_IsGlobalValue
+        }
+    }
+};
+
+#endif //ASMTEMPLATE_H
@@ -25,7 +25,7 @@ const ASTNodeMethods ASTNodeMethodsFor[] = {
     AN_METHODS_STRUCT(NumberLiteral)
 };
 
-char* ASTNode_create(ASTNode** node, ASTNodeType type, int childCount, int attributeCount) {
+char* ASTNode_create(ASTNode** node, ASTNodeType type, size_t childCount, size_t attributeCount) {
 
     *node = (ASTNode*)malloc(sizeof(ASTNode));
 
@@ -44,6 +44,7 @@ char* ASTNode_create(ASTNode** node, ASTNodeType type, int childCount, int attri
         if((*node)->children == 0) {
 
             free(*node);
+            *node = 0;
 
             return "Could not allocate space for AST node children";
         }
@@ -58,8 +59,9 @@ char* ASTNode_create(ASTNode** node, ASTNodeType type, int childCount, int attri
 
         if((*node)->attributes == 0) {
 
-            free((*node)->attributes);
+            free((*node)->children);
             free(*node);
+            *node = 0;
 
             return "Could not allocate space for AST node children";
         }
@@ -76,14 +78,59 @@ void ASTNode_cleanUp(ASTNode* node) {
     
     for(int i = 0; i < node->childCount; i++) {
 
-        ASTNode_cleanUp(node->children[i]);
+        if(node->children[i] != 0) ASTNode_cleanUp(node->children[i]);
     }
     
     ASTNodeMethodsFor[node->type].cleanUp(node);
 
+    free(node->children);
+    free(node->attributes);
     free(node);
 }
 
+//Copies the node and its whole subtree, letting each node type duplicate
+//whatever its attributes own once the plain attribute values are copied over
+char* ASTNode_clone(ASTNode* node, ASTNode** out_node) {
+
+    char* error = 0;
+    ASTNode* clone;
+
+    if((error = ASTNode_create(&clone, node->type, node->childCount, node->attributeCount)) != 0) {
+
+        return error;
+    }
+
+    for(int i = 0; i < node->attributeCount; i++) clone->attributes[i] = node->attributes[i];
+
+    for(int i = 0; i < node->childCount; i++) clone->children[i] = 0;
+
+    for(int i = 0; i < node->childCount && error == 0; i++) {
+
+        if(node->children[i] != 0) error = ASTNode_clone(node->children[i], &clone->children[i]);
+    }
+
+    if(error == 0) error = ASTNodeMethodsFor[node->type].clone(node, clone);
+
+    if(error != 0) {
+
+        //The attributes still belong to the source node, so skip the type's cleanUp
+        for(int i = 0; i < clone->childCount; i++) {
+
+            if(clone->children[i] != 0) ASTNode_cleanUp(clone->children[i]);
+        }
+
+        free(clone->children);
+        free(clone->attributes);
+        free(clone);
+
+        return error;
+    }
+
+    *out_node = clone;
+
+    return 0;
+}
+
 void ASTNode_print(ASTNode* node, int depth) { ASTNodeMethodsFor[node->type].print(node, depth); }
 
 typedef char* (*ASTNodeVisitor)(ASTNode*, void*);
@@ -96,6 +143,8 @@ char* ASTNode_forAll(ASTNode* root, ASTNodeVisitor visit, void* args) {
 
     for(int i = 0; i < root->childCount; i++) {
 
+        if(root->children[i] == 0) continue;
+
         if((error = ASTNode_forAll(root->children[i], visit, args)) != 0) {
 
             return error;
@@ -160,35 +209,75 @@ int ASTOperatorNode_OperatorIsMul(ASTNode* node) {
     return node->ON_OPERATOR == (void*)OpMultiply;
 }
 
-char* ASTNode_getChildByPath(ASTNode* in_node, String* path, String** rest_str,
+int ASTSymbolNode_IsParameter(ASTNode* node) {
+
+    return node->type == Symbol && node->SN_KIND == (void*)SymbolParameter;
+}
+
+int ASTSymbolNode_IsExternal(ASTNode* node) {
+
+    return node->type == Symbol && node->SN_KIND == (void*)SymbolExternal;
+}
+
+int ASTSymbolNode_IsGlobalValue(ASTNode* node) {
+
+    return node->type == Symbol && node->SN_KIND == (void*)SymbolGlobal && node->SN_LAMBDA == 0;
+}
+
+int ASTSymbolNode_IsGlobalLambda(ASTNode* node) {
+
+    return node->type == Symbol && node->SN_KIND == (void*)SymbolGlobal && node->SN_LAMBDA != 0;
+}
+
+int ASTDeclarationNode_IsLambda(ASTNode* node) {
+
+    return node->type == Declaration && node->DN_INITIALIZER != 0 && node->DN_INITIALIZER->type == Lambda;
+}
+
+int ASTDeclarationNode_IsValue(ASTNode* node) {
+
+    return node->type == Declaration && node->DN_INITIALIZER != 0 && node->DN_INITIALIZER->type != Lambda;
+}
+
+//Parses the digits at the start of path, which the node paths use for child
+//and attribute indices
+size_t ASTNode_parseIndex(StrView path, size_t* index) {
+
+    size_t i;
+
+    *index = 0;
+
+    for(i = 0; i < path.length && path.data[i] >= '0' && path.data[i] <= '9'; i++) {
+
+        *index = *index * 10 + (size_t)(path.data[i] - '0');
+    }
+
+    return i;
+}
+
+char* ASTNode_getChildByPath(ASTNode* in_node, StrView path, StrView* rest,
     ASTNode** out_node) {
 
-    char* number_str;
-    char* error;
-    int i, j, child_idx;
+    size_t i, digits, child_idx;
 
     *out_node = in_node;
 
-    if(path->length == 0) return 0;
+    if(path.length == 0) return 0;
 
-    for(i = 0; i < path->length;) {
+    for(i = 0; i < path.length;) {
 
-        if(path->data[i] != 'c') {
+        if(path.data[i] != 'c') {
 
-            if(path->data[i] == 'a' && rest_str != 0) break;  
+            if(path.data[i] == 'a' && rest != 0) break;  
 
             return 0;
         }
 
-        if(++i == path->length) break;
-
-        for(j = i; path->data[j] >= '0' && path->data[j] <= '9' && j < path->length; j++);
+        if(++i == path.length) break;
 
-        if(j == i) return "Expected index number following 'c' in node path segment";
+        digits = ASTNode_parseIndex(StrView_slice(&path.data[i], &path.data[path.length]), &child_idx);
 
-        number_str = strndup(&path->data[i], j - i);
-        child_idx = strtol(number_str, 0, 0);
-        free(number_str);
+        if(digits == 0) return "Expected index number following 'c' in node path segment";
 
         if(child_idx >= (*out_node)->childCount) {
 
@@ -197,42 +286,28 @@ char* ASTNode_getChildByPath(ASTNode* in_node, String* path, String** rest_str,
 
         *out_node = (*out_node)->children[child_idx];
 
-        i = j;
+        i += digits;
     }
 
-    if(rest_str == 0) return 0;
-
-    if((error = String_sliceCString(&path->data[i], &path->data[path->length], rest_str)) != 0) {
-
-        return error;
-    }
+    if(rest != 0) *rest = StrView_slice(&path.data[i], &path.data[path.length]);
 
     return 0;
 }
 
-char* ASTNode_getAttributeByPath(ASTNode* node, String* path, void** attribute) {
+char* ASTNode_getAttributeByPath(ASTNode* node, StrView path, void** attribute) {
 
     char* error;
-    int attr_idx;
+    size_t attr_idx;
     ASTNode* attr_node;
-    char* clone_str;
-    String* attr_path;
+    StrView attr_path;
 
     if((error = ASTNode_getChildByPath(node, path, &attr_path, &attr_node)) != 0) return error;
 
-    if(attr_path->length < 2) return "No attribute path at the end of node path";
-
-    if(attr_path->data[0] != 'a') return "Expected 'a' at beginning of attribute path";
-
-    clone_str = strndup(attr_path->data, attr_path->length);
+    if(attr_path.length < 2) return "No attribute path at the end of node path";
 
-    String_cleanUp(attr_path);
+    if(attr_path.data[0] != 'a') return "Expected 'a' at beginning of attribute path";
 
-    if(clone_str == 0) return "Failed to allocate space for attribute index string";
-
-    attr_idx = strtol(clone_str, 0, 0);
-
-    free(clone_str);
+    ASTNode_parseIndex(StrView_slice(&attr_path.data[1], &attr_path.data[attr_path.length]), &attr_idx);
 
     if(attr_idx >= attr_node->attributeCount) {
 
@@ -248,18 +323,11 @@ char* ASTNode_renderTemplate(ASTNode* node, TemplateConfig* config, String** out
 
     char* error;
     Template* template;
-    String* template_name;
-
-    if((template_name = String_new(config->baseTemplateName[node->type])) == 0) {
-        
-        return "Unable to allocate string for template name lookup";
-    }
-
-    error = Template_getCompiled(config, template_name, &template);
 
-    String_cleanUp(template_name);
+    if((error = Template_getCompiled(config, StrView_fromCString(config->baseTemplateName[node->type]), &template)) != 0) {
 
-    if(error != 0) return error;
+        return error;
+    }
 
     if((error = Template_renderCompiled(template, node, out_string)) != 0) return error;
 
@@ -274,10 +342,11 @@ char* ASTNode_writeOut(FILE* out_file, TemplateConfig* config, ASTNode* node) {
 
     if(error != 0) return error;
  
-    fprintf(out_file, "%.*s", code_str->length, code_str->data);
+    if(fwrite(code_str->data, 1, code_str->length, out_file) != code_str->length) error = "Unable to write output file";
+
     String_cleanUp(code_str);
 
-    return 0;
+    return error;
 }
 
 void ASTModuleNode_print(ASTNode* node, int depth) {
@@ -292,6 +361,8 @@ void ASTModuleNode_print(ASTNode* node, int depth) {
 
 void ASTModuleNode_cleanUp(ASTNode* node) { }
 
+char* ASTModuleNode_clone(ASTNode* source, ASTNode* node) { return 0; }
+
 void ASTDeclarationNode_print(ASTNode* node, int depth) {
     
     print_indent(depth); printf("- Declaration\n");
@@ -306,6 +377,8 @@ void ASTDeclarationNode_print(ASTNode* node, int depth) {
 
 void ASTDeclarationNode_cleanUp(ASTNode* node) { }
 
+char* ASTDeclarationNode_clone(ASTNode* source, ASTNode* node) { return 0; }
+
 void ASTParameterNode_print(ASTNode* node, int depth) {
 
     print_indent(depth); printf("- Parameter\n");
@@ -316,6 +389,8 @@ void ASTParameterNode_print(ASTNode* node, int depth) {
 
 void ASTParameterNode_cleanUp(ASTNode* node) { }
 
+char* ASTParameterNode_clone(ASTNode* source, ASTNode* node) { return 0; }
+
 void ASTParameterListNode_print(ASTNode* node, int depth) {
 
     print_indent(depth); printf("- Parameter List\n");
@@ -328,12 +403,14 @@ void ASTParameterListNode_print(ASTNode* node, int depth) {
 
 void ASTParameterListNode_cleanUp(ASTNode* node) { }
 
+char* ASTParameterListNode_clone(ASTNode* source, ASTNode* node) { return 0; }
+
 void ASTSymbolNode_print(ASTNode* node, int depth) {
 
     String* text = (String*)node->SN_TEXT;
 
     print_indent(depth); printf("- Symbol \n");
-    print_indent(depth); printf("  Text: %.*s\n", text->length, text->data);
+    print_indent(depth); printf("  Text: %.*s\n", (int)text->length, text->data);
 }
 
 void ASTSymbolNode_cleanUp(ASTNode* node) {
@@ -341,16 +418,30 @@ void ASTSymbolNode_cleanUp(ASTNode* node) {
     String_cleanUp((String*)node->SN_TEXT);
 }
 
+char* ASTSymbolNode_clone(ASTNode* source, ASTNode* node) {
+
+    return String_copy((String*)source->SN_TEXT, (String**)&node->SN_TEXT);
+}
+
 void ASTStringLiteralNode_print(ASTNode* node, int depth) {
 
     String* text = (String*)node->SLN_STRING;
 
-    print_indent(depth); printf("- String literal: %.*s\n", text->length, text->data);
+    print_indent(depth); printf("- String literal: %.*s\n", (int)text->length, text->data);
 }
 
 void ASTStringLiteralNode_cleanUp(ASTNode* node) {
 
-    String_cleanUp((String*)node->SN_TEXT);
+    String_cleanUp((String*)node->SLN_STRING);
+
+    if(node->SLN_VALUE != 0) free(node->SLN_VALUE);
+}
+
+char* ASTStringLiteralNode_clone(ASTNode* source, ASTNode* node) {
+
+    node->SLN_VALUE = 0;
+
+    return String_copy((String*)source->SLN_STRING, (String**)&node->SLN_STRING);
 }
 
 void ASTNumberLiteralNode_print(ASTNode* node, int depth) {
@@ -362,6 +453,8 @@ void ASTNumberLiteralNode_print(ASTNode* node, int depth) {
 
 void ASTNumberLiteralNode_cleanUp(ASTNode* node) { }
 
+char* ASTNumberLiteralNode_clone(ASTNode* source, ASTNode* node) { return 0; }
+
 void ASTOperatorNode_print(ASTNode* node, int depth) {
 
     print_indent(depth); printf("- Operator\n");
@@ -374,6 +467,8 @@ void ASTOperatorNode_print(ASTNode* node, int depth) {
 
 void ASTOperatorNode_cleanUp(ASTNode* node) { }
 
+char* ASTOperatorNode_clone(ASTNode* source, ASTNode* node) { return 0; }
+
 void ASTLambdaNode_print(ASTNode* node, int depth) {
 
     print_indent(depth); printf("- Lambda\n");
@@ -386,7 +481,18 @@ void ASTLambdaNode_print(ASTNode* node, int depth) {
     ASTNode_print(node->LN_EXPR, depth + 1);
 }
 
-void ASTLambdaNode_cleanUp(ASTNode* node) { }
+void ASTLambdaNode_cleanUp(ASTNode* node) {
+
+    if(node->LN_NAME != 0) String_cleanUp((String*)node->LN_NAME);
+}
+
+char* ASTLambdaNode_clone(ASTNode* source, ASTNode* node) {
+
+    node->LN_NATIVE = 0;
+    node->LN_NAME = 0;
+
+    return 0;
+}
 
 void ASTInvocationNode_print(ASTNode* node, int depth) {
 
@@ -402,6 +508,8 @@ void ASTInvocationNode_print(ASTNode* node, int depth) {
 
 void ASTInvocationNode_cleanUp(ASTNode* node) { }
 
+char* ASTInvocationNode_clone(ASTNode* source, ASTNode* node) { return 0; }
+
 void ASTArgumentListNode_print(ASTNode* node, int depth) {
 
     print_indent(depth); printf("- Argument List\n");
@@ -414,3 +522,5 @@ void ASTArgumentListNode_print(ASTNode* node, int depth) {
 
 void ASTArgumentListNode_cleanUp(ASTNode* node) { }
 
+char* ASTArgumentListNode_clone(ASTNode* source, ASTNode* node) { return 0; }
+
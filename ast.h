@@ -14,6 +14,7 @@ struct ASTAssignmentNode_s;
 
 typedef void (*ASTNodePrinter)(struct ASTNode_s*, int);
 typedef void (*ASTNodeCleaner)(struct ASTNode_s*);
+typedef char* (*ASTNodeCloner)(struct ASTNode_s*, struct ASTNode_s*);
 typedef int (*ASTNodePredicate)(struct ASTNode_s*);
 typedef char* (*ASTNodeVisitor)(struct ASTNode_s*, void*);
 
@@ -33,26 +34,40 @@ typedef enum {
 } ASTNodeType;
 
 #include "string.h"
-#include "template.h"
+#include "vec.h"
 #include <stddef.h>
 #include <stdio.h>
+
+typedef struct ASTNode_s* ASTNodePtr;
+
+VEC_DECLARE(ASTNodePtr)
+
+#include "template.h"
     
 typedef struct ASTNode_s {
     ASTNodeType type;
-    int childCount;
+    size_t childCount;
     struct ASTNode_s** children;
-    int attributeCount;
+    size_t attributeCount;
     void** attributes;
 } ASTNode;
 
+//Counters the optimization passes keep while walking the tree
+typedef struct PassStats_s {
+    long nodesVisited;
+    long nodesChanged;
+} PassStats;
+
 typedef struct ASTNodeMethods_s {
     ASTNodePrinter print;
     ASTNodeCleaner cleanUp;
+    ASTNodeCloner clone;
 } ASTNodeMethods;
 
 #define AN_METHODS_DECL(n) \
     void AST ## n ## Node_print(ASTNode*, int); \
-    void AST ## n ## Node_cleanUp(ASTNode*);
+    void AST ## n ## Node_cleanUp(ASTNode*); \
+    char* AST ## n ## Node_clone(ASTNode*, ASTNode*);
 
 AN_METHODS_DECL(Module);
 AN_METHODS_DECL(Declaration);
@@ -70,11 +85,21 @@ AN_METHODS_DECL(NumberLiteral);
     (ASTNodeMethods){ \
         AST ## n ## Node_print, \
         AST ## n ## Node_cleanUp, \
+        AST ## n ## Node_clone, \
     } 
 
 extern const ASTNodeMethods ASTNodeMethodsFor[];
 
 #define SN_TEXT attributes[0]
+#define SN_KIND attributes[1]
+#define SN_SLOT attributes[2]
+#define SN_LAMBDA attributes[3]
+
+typedef enum {
+    SymbolExternal,
+    SymbolParameter,
+    SymbolGlobal
+} ASTSymbolKind;
 
 #define PN_SYMBOL children[0]
 
@@ -97,6 +122,14 @@ extern const char* OperatorString[];
 
 #define LN_PARAMS children[0]
 #define LN_EXPR children[1]
+#define LN_ID attributes[0]
+#define LN_MEMOIZE attributes[1]
+#define LN_MEMO_DIRECT attributes[2]
+#define LN_MEMO_SIZE attributes[3]
+#define LN_PURE attributes[4]
+#define LN_COLD attributes[5]
+#define LN_NATIVE attributes[6]
+#define LN_NAME attributes[7]
 
 #define AN_SYMBOL children[0]
 #define AN_EXPR children[1]
@@ -105,13 +138,16 @@ extern const char* OperatorString[];
 #define IN_ARGS children[1]
 
 #define SLN_STRING attributes[0]
+#define SLN_VALUE attributes[1]
 
 #define NLN_NUMBER attributes[0]
 
-char* ASTNode_create(ASTNode** node, ASTNodeType type, int childCount, int attributeCount); 
+char* ASTNode_create(ASTNode** node, ASTNodeType type, size_t childCount, size_t attributeCount); 
 
 void ASTNode_cleanUp(ASTNode* node); 
 
+char* ASTNode_clone(ASTNode* node, ASTNode** out_node);
+
 void ASTNode_print(ASTNode* node, int depth); 
 
 char* ASTNode_forAll(ASTNode* root, ASTNodeVisitor visit, void* args); 
@@ -132,45 +168,67 @@ int ASTOperatorNode_OperatorIsMul(ASTNode* node);
 
 int ASTOperatorNode_OperatorIsDiv(ASTNode* node);
 
-char* ASTNode_getChildByPath(ASTNode* in_node, String* path, String** rest_str,
-    ASTNode** out_node); 
+int ASTSymbolNode_IsParameter(ASTNode* node);
+
+int ASTSymbolNode_IsExternal(ASTNode* node);
+
+int ASTSymbolNode_IsGlobalValue(ASTNode* node);
+
+int ASTSymbolNode_IsGlobalLambda(ASTNode* node);
+
+int ASTDeclarationNode_IsLambda(ASTNode* node);
+
+int ASTDeclarationNode_IsValue(ASTNode* node);
+
+char* ASTNode_getChildByPath(ASTNode* in_node, StrView path, StrView* rest, ASTNode** out_node); 
 
-char* ASTNode_getAttributeByPath(ASTNode* node, String* path, void** attribute); 
+char* ASTNode_getAttributeByPath(ASTNode* node, StrView path, void** attribute); 
 
 char* ASTNode_renderTemplate(ASTNode* node, struct TemplateConfig_s* config, String** out_string); 
 char* ASTNode_writeOut(FILE* out_file, struct TemplateConfig_s* config, ASTNode* node);
 
 void ASTModuleNode_print(ASTNode* node, int depth);
 void ASTModuleNode_cleanUp(ASTNode* node);
+char* ASTModuleNode_clone(ASTNode* source, ASTNode* node);
 
 void ASTDeclarationNode_print(ASTNode* node, int depth);
 void ASTDeclarationNode_cleanUp(ASTNode* node);
+char* ASTDeclarationNode_clone(ASTNode* source, ASTNode* node);
 
 void ASTParameterNode_print(ASTNode* node, int depth);
 void ASTParameterNode_cleanUp(ASTNode* node);
+char* ASTParameterNode_clone(ASTNode* source, ASTNode* node);
 
 void ASTParameterListNode_print(ASTNode* node, int depth);
 void ASTParameterListNode_cleanUp(ASTNode* node);
+char* ASTParameterListNode_clone(ASTNode* source, ASTNode* node);
 
 void ASTSymbolNode_print(ASTNode* node, int depth);
 void ASTSymbolNode_cleanUp(ASTNode* node);
+char* ASTSymbolNode_clone(ASTNode* source, ASTNode* node);
 
 void ASTOperatorNode_print(ASTNode* node, int depth);
 void ASTOperatorNode_cleanUp(ASTNode* node);
+char* ASTOperatorNode_clone(ASTNode* source, ASTNode* node);
 
 void ASTLambdaNode_print(ASTNode* node, int depth);
 void ASTLambdaNode_cleanUp(ASTNode* node);
+char* ASTLambdaNode_clone(ASTNode* source, ASTNode* node);
 
 void ASTInvocationNode_print(ASTNode* node, int depth);
 void ASTInvocationNode_cleanUp(ASTNode* node);
+char* ASTInvocationNode_clone(ASTNode* source, ASTNode* node);
 
 void ASTArgumentListNode_print(ASTNode* node, int depth);
 void ASTArgumentListNode_cleanUp(ASTNode* node);
+char* ASTArgumentListNode_clone(ASTNode* source, ASTNode* node);
 
 void ASTStringLiteralNode_print(ASTNode* node, int depth);
 void ASTStringLiteralNode_cleanUp(ASTNode* node);
+char* ASTStringLiteralNode_clone(ASTNode* source, ASTNode* node);
 
 void ASTNumberLiteralNode_print(ASTNode* node, int depth);
 void ASTNumberLiteralNode_cleanUp(ASTNode* node);
+char* ASTNumberLiteralNode_clone(ASTNode* source, ASTNode* node);
 
 #endif
@@ -0,0 +1,319 @@
+#include "batch.h"
+#include "libyc.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+//Every worker starts with a contiguous run of inputs, takes work from the
+//back of its own run and steals from the front of someone else's when it
+//runs dry, so one slow file never leaves the other workers idle
+typedef struct BatchQueue_s {
+    pthread_mutex_t lock;
+    int front;
+    int back;
+} BatchQueue;
+
+typedef struct BatchWorker_s {
+    pthread_t thread;
+    struct Batch_s* batch;
+    int index;
+} BatchWorker;
+
+typedef struct Batch_s {
+    VEC(CharPtr)* inputs;
+    BatchOptions* options;
+    BatchQueue* queues;
+    char** errors;
+    char** outNames;
+    int workerCount;
+} Batch;
+
+typedef struct BatchOutput_s {
+    char* name;
+    int input;
+} BatchOutput;
+
+//Names starting with @ are response files listing further inputs separated
+//by whitespace
+char* Batch_addInput(VEC(CharPtr)* inputs, char* name) {
+
+    char* error;
+    char buffer[4096];
+    FILE* response_file;
+
+    if(name[0] != '@') return Vec_CharPtr_add(inputs, name);
+
+    if((response_file = fopen(&name[1], "r")) == 0) return "Unable to open response file";
+
+    while(fscanf(response_file, "%4095s", buffer) == 1) {
+
+        char* input = strdup(buffer);
+
+        if(input == 0 || (error = Vec_CharPtr_add(inputs, input)) != 0) {
+
+            free(input);
+            fclose(response_file);
+
+            return "Failed to allocate space for a response file entry";
+        }
+    }
+
+    fclose(response_file);
+
+    return 0;
+}
+
+int BatchQueue_take(Batch* batch, int worker, int* input) {
+
+    BatchQueue* own = &batch->queues[worker];
+
+    pthread_mutex_lock(&own->lock);
+
+    if(own->front < own->back) {
+
+        *input = --own->back;
+        pthread_mutex_unlock(&own->lock);
+
+        return 1;
+    }
+
+    pthread_mutex_unlock(&own->lock);
+
+    for(int i = 1; i < batch->workerCount; i++) {
+
+        BatchQueue* victim = &batch->queues[(worker + i) % batch->workerCount];
+
+        pthread_mutex_lock(&victim->lock);
+
+        if(victim->front < victim->back) {
+
+            *input = victim->front++;
+            pthread_mutex_unlock(&victim->lock);
+
+            return 1;
+        }
+
+        pthread_mutex_unlock(&victim->lock);
+    }
+
+    return 0;
+}
+
+char* Batch_readFile(char* name, char** source, size_t* length) {
+
+    FILE* in_file = fopen(name, "r");
+    long size;
+
+    if(in_file == 0) return "Unable to open input file";
+
+    if(fseek(in_file, 0, SEEK_END) != 0 || (size = ftell(in_file)) < 0 || fseek(in_file, 0, SEEK_SET) != 0) {
+
+        fclose(in_file);
+
+        return "Unable to determine input file size";
+    }
+
+    if((*source = (char*)malloc(size + 1)) == 0) {
+
+        fclose(in_file);
+
+        return "Failed to allocate space for module source";
+    }
+
+    *length = fread(*source, 1, size, in_file);
+    fclose(in_file);
+
+    return 0;
+}
+
+//Outputs go next to their input as <input>.c, or into the output directory
+//under the input's base name
+char* Batch_outputName(Batch* batch, char* in_name, char** out_name) {
+
+    char* extension = batch->options->assembly ? ".s" : ".c";
+    char* base = in_name;
+    char* slash = strrchr(in_name, '/');
+    char* dir = batch->options->outDir;
+
+    if(dir != 0 && slash != 0) base = slash + 1;
+
+    *out_name = (char*)malloc((dir == 0 ? 0 : strlen(dir) + 1) + strlen(base) + strlen(extension) + 1);
+
+    if(*out_name == 0) return "Failed to allocate space for an output file name";
+
+    sprintf(*out_name, "%s%s%s%s", dir == 0 ? "" : dir, dir == 0 ? "" : "/", base, extension);
+
+    return 0;
+}
+
+int BatchOutput_compare(const void* a, const void* b) {
+
+    BatchOutput* first = (BatchOutput*)a;
+    BatchOutput* second = (BatchOutput*)b;
+    int order = strcmp(first->name, second->name);
+
+    return order != 0 ? order : first->input - second->input;
+}
+
+//Names every output before any worker starts. Inputs that would write the
+//same file, such as a/x.y and b/x.y under -d, would race for it, so each of
+//them fails instead of leaving one input's output under both names
+char* Batch_nameOutputs(Batch* batch) {
+
+    char* error;
+    int count = batch->inputs->count;
+    BatchOutput* outputs = (BatchOutput*)malloc(count * sizeof(BatchOutput));
+
+    if(outputs == 0) return "Failed to allocate space for the output file names";
+
+    for(int i = 0; i < count; i++) {
+
+        if((error = Batch_outputName(batch, batch->inputs->data[i], &batch->outNames[i])) != 0) {
+
+            free(outputs);
+
+            return error;
+        }
+
+        outputs[i] = (BatchOutput){ batch->outNames[i], i };
+    }
+
+    qsort(outputs, count, sizeof(BatchOutput), BatchOutput_compare);
+
+    for(int i = 0; i < count; i++) {
+
+        int shared = (i > 0 && strcmp(outputs[i - 1].name, outputs[i].name) == 0) ||
+            (i + 1 < count && strcmp(outputs[i + 1].name, outputs[i].name) == 0);
+
+        if(shared) batch->errors[outputs[i].input] = "Another input writes the same output file";
+    }
+
+    free(outputs);
+
+    return 0;
+}
+
+char* Batch_compileOne(Batch* batch, YcContext* context, int input) {
+
+    char* error;
+    char* source;
+    char* out_name = batch->outNames[input];
+    size_t length;
+    FILE* out_file;
+
+    if((error = Batch_readFile(batch->inputs->data[input], &source, &length)) != 0) return error;
+
+    error = YcContext_render(context, source, length);
+
+    free(source);
+
+    if(error != 0) return error;
+
+    if((out_file = fopen(out_name, "w")) == 0) return "Unable to open output file";
+
+    if(fwrite(context->output->data, 1, context->output->length, out_file) != context->output->length) {
+
+        error = "Unable to write output file";
+    }
+
+    if(fclose(out_file) != 0 && error == 0) error = "Unable to write output file";
+
+    return error;
+}
+
+void* Batch_work(void* arg) {
+
+    BatchWorker* worker = (BatchWorker*)arg;
+    Batch* batch = worker->batch;
+    YcContext context;
+    char* error;
+    int input;
+
+    error = YcContext_init(&context, batch->options->optLevel, batch->options->assembly);
+
+    while(BatchQueue_take(batch, worker->index, &input)) {
+
+        //Inputs whose output collides already carry their error
+        if(batch->errors[input] != 0) continue;
+
+        batch->errors[input] = error != 0
+            ? error
+            : Batch_compileOne(batch, &context, input);
+    }
+
+    if(error == 0) YcContext_cleanUp(&context);
+
+    return 0;
+}
+
+//Failures are reported per input in input order once every worker is done,
+//so the output and exit status do not depend on scheduling
+char* Batch_run(VEC(CharPtr)* inputs, BatchOptions* options, int* failed_count) {
+
+    char* error;
+    Batch batch = { inputs, options, 0, 0, 0, options->threadCount };
+    BatchWorker* workers;
+
+    *failed_count = 0;
+
+    if(inputs->count == 0) return 0;
+
+    if((error = Yc_init()) != 0) return error;
+
+    if(batch.workerCount <= 0) batch.workerCount = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if(batch.workerCount <= 0) batch.workerCount = 1;
+    if(batch.workerCount > inputs->count) batch.workerCount = inputs->count;
+
+    batch.queues = (BatchQueue*)calloc(batch.workerCount, sizeof(BatchQueue));
+    batch.errors = (char**)calloc(inputs->count, sizeof(char*));
+    batch.outNames = (char**)calloc(inputs->count, sizeof(char*));
+    workers = (BatchWorker*)calloc(batch.workerCount, sizeof(BatchWorker));
+
+    if(batch.queues == 0 || batch.errors == 0 || batch.outNames == 0 || workers == 0 ||
+        (error = Batch_nameOutputs(&batch)) != 0) {
+
+        if(batch.outNames != 0) for(int i = 0; i < inputs->count; i++) free(batch.outNames[i]);
+
+        free(batch.queues);
+        free(batch.errors);
+        free(batch.outNames);
+        free(workers);
+
+        return error != 0 ? error : "Failed to allocate space for the batch";
+    }
+
+    for(int i = 0; i < batch.workerCount; i++) {
+
+        pthread_mutex_init(&batch.queues[i].lock, 0);
+        batch.queues[i].front = (int)((long)inputs->count * i / batch.workerCount);
+        batch.queues[i].back = (int)((long)inputs->count * (i + 1) / batch.workerCount);
+        workers[i] = (BatchWorker){ 0, &batch, i };
+    }
+
+    //The calling thread works too, so a single worker never spawns a thread
+    for(int i = 1; i < batch.workerCount; i++) pthread_create(&workers[i].thread, 0, Batch_work, &workers[i]);
+
+    Batch_work(&workers[0]);
+
+    for(int i = 1; i < batch.workerCount; i++) pthread_join(workers[i].thread, 0);
+
+    for(int i = 0; i < inputs->count; i++) {
+
+        if(batch.errors[i] == 0) continue;
+
+        printf("%s: %s\n", inputs->data[i], batch.errors[i]);
+        (*failed_count)++;
+    }
+
+    for(int i = 0; i < batch.workerCount; i++) pthread_mutex_destroy(&batch.queues[i].lock);
+    for(int i = 0; i < inputs->count; i++) free(batch.outNames[i]);
+
+    free(batch.queues);
+    free(batch.errors);
+    free(batch.outNames);
+    free(workers);
+
+    return 0;
+}
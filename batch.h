@@ -0,0 +1,17 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "vec.h"
+
+typedef struct BatchOptions_s {
+    char* outDir;
+    int threadCount;
+    int optLevel;
+    int assembly;
+} BatchOptions;
+
+char* Batch_addInput(VEC(CharPtr)* inputs, char* name);
+
+char* Batch_run(VEC(CharPtr)* inputs, BatchOptions* options, int* failed_count);
+
+#endif //BATCH_H
@@ -0,0 +1,161 @@
+#include "builtins.h"
+#include <stdio.h>
+#include <string.h>
+
+Builtin BuiltinList[] = {
+    { "printf",  Builtin_printf  },
+    { "puts",    Builtin_puts    },
+    { "putchar", Builtin_putchar }
+};
+
+const int BuiltinCount = sizeof(BuiltinList) / sizeof(BuiltinList[0]);
+
+int Builtin_lookUp(char* name, int length) {
+
+    for(int i = 0; i < BuiltinCount; i++) {
+
+        if(strlen(BuiltinList[i].name) == length && strncmp(BuiltinList[i].name, name, length) == 0) return i;
+    }
+
+    return -1;
+}
+
+//Measures the conversion starting at the '%' in format: flags, width,
+//precision, length and conversion character. Only conversions a Y int or
+//string can feed are accepted, with no length wider than an int. stars is
+//set to how many '*' widths and precisions take an argument of their own
+char* Builtin_printfConversion(char* format, size_t* length, int* stars) {
+
+    char* s = format + 1;
+
+    *stars = 0;
+
+    s += strspn(s, "-+ #0");
+
+    if(*s == '*') {
+
+        (*stars)++;
+        s++;
+    } else {
+
+        s += strspn(s, "0123456789");
+    }
+
+    if(*s == '.') {
+
+        if(*++s == '*') {
+
+            (*stars)++;
+            s++;
+        } else {
+
+            s += strspn(s, "0123456789");
+        }
+    }
+
+    if(*s == 'h') s += s[1] == 'h' ? 2 : 1;
+
+    if(*s == 0 || strchr("diouxXcs", *s) == 0) return "Unsupported conversion in printf format";
+
+    //A string or character takes no length modifier
+    if((*s == 's' || *s == 'c') && s[-1] == 'h') return "Unsupported conversion in printf format";
+
+    *length = s + 1 - format;
+
+    return 0;
+}
+
+//Hands each conversion of the format to the C library's printf one at a time
+//along with the arguments it consumes, checking their types on the way
+char* Builtin_printf(Value* args, int argc, Value* result) {
+
+    char spec[32];
+    char* error;
+    int stars[2];
+    int star_count;
+    size_t length;
+    int arg = 1;
+    int written = 0;
+
+    if(argc < 1 || args[0].type != ValueString) return "printf expects a format string";
+
+    for(char* s = args[0].string; *s != 0; ) {
+
+        char* start = s;
+
+        if(*s != '%') {
+
+            for(; *s != 0 && *s != '%'; s++);
+
+            written += fwrite(start, 1, s - start, stdout);
+
+            continue;
+        }
+
+        if(s[1] == '%') {
+
+            written += fwrite("%", 1, 1, stdout);
+            s += 2;
+
+            continue;
+        }
+
+        if((error = Builtin_printfConversion(start, &length, &star_count)) != 0) return error;
+
+        if(length >= sizeof(spec)) return "Unsupported conversion in printf format";
+
+        memcpy(spec, start, length);
+        spec[length] = 0;
+        s += length;
+
+        if(arg + star_count >= argc) return "Not enough arguments for printf format";
+
+        for(int i = 0; i < star_count; i++) {
+
+            if(args[arg].type != ValueInt) return "printf '*' given a non-integer argument";
+
+            stars[i] = args[arg++].integer;
+        }
+
+        if(s[-1] == 's') {
+
+            if(args[arg].type != ValueString) return "printf %s conversion given a non-string argument";
+
+            if(star_count == 0) written += printf(spec, args[arg++].string);
+            else if(star_count == 1) written += printf(spec, stars[0], args[arg++].string);
+            else written += printf(spec, stars[0], stars[1], args[arg++].string);
+        } else {
+
+            if(args[arg].type != ValueInt) return "printf integer conversion given a non-integer argument";
+
+            if(star_count == 0) written += printf(spec, args[arg++].integer);
+            else if(star_count == 1) written += printf(spec, stars[0], args[arg++].integer);
+            else written += printf(spec, stars[0], stars[1], args[arg++].integer);
+        }
+    }
+
+    result->type = ValueInt;
+    result->integer = written;
+
+    return 0;
+}
+
+char* Builtin_puts(Value* args, int argc, Value* result) {
+
+    if(argc != 1 || args[0].type != ValueString) return "puts expects a single string";
+
+    result->type = ValueInt;
+    result->integer = puts(args[0].string);
+
+    return 0;
+}
+
+char* Builtin_putchar(Value* args, int argc, Value* result) {
+
+    if(argc != 1 || args[0].type != ValueInt) return "putchar expects a single integer";
+
+    result->type = ValueInt;
+    result->integer = putchar(args[0].integer);
+
+    return 0;
+}
@@ -0,0 +1,40 @@
+#ifndef BUILTINS_H
+#define BUILTINS_H
+
+struct ASTNode_s;
+
+typedef enum {
+    ValueNone,
+    ValueInt,
+    ValueString,
+    ValueLambda
+} ValueType;
+
+typedef struct Value_s {
+    ValueType type;
+    union {
+        int integer;
+        char* string;
+        struct ASTNode_s* lambda;
+    };
+} Value;
+
+typedef char* (*BuiltinFunction)(Value*, int, Value*);
+
+typedef struct Builtin_s {
+    char* name;
+    BuiltinFunction function;
+} Builtin;
+
+extern Builtin BuiltinList[];
+extern const int BuiltinCount;
+
+int Builtin_lookUp(char* name, int length);
+
+char* Builtin_printf(Value* args, int argc, Value* result);
+
+char* Builtin_puts(Value* args, int argc, Value* result);
+
+char* Builtin_putchar(Value* args, int argc, Value* result);
+
+#endif //BUILTINS_H
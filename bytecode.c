@@ -0,0 +1,562 @@
+#include "bytecode.h"
+#include "resolve.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define VM_REGISTER_COUNT 65536
+#define VM_FRAME_COUNT 10000
+#define VM_MAX_FRAME_SIZE 256
+
+const char* BytecodeOpName[] = {
+    "loadi",
+    "loadk",
+    "loadg",
+    "storeg",
+    "move",
+    "add",
+    "sub",
+    "mul",
+    "div",
+    "addi",
+    "subi",
+    "muli",
+    "call",
+    "callb",
+    "ret",
+    "halt"
+};
+
+typedef struct BytecodeCompiler_s {
+    BytecodeProgram* program;
+    BytecodeFunction* function;
+    int nextRegister;
+} BytecodeCompiler;
+
+char* BytecodeCompiler_emit(BytecodeCompiler* compiler, BytecodeOp op, int a, int b, int c) {
+
+    return Vec_Instruction_add(&compiler->program->code, (Instruction){ op, a, b, c });
+}
+
+char* BytecodeCompiler_addConstant(BytecodeCompiler* compiler, Value value, int* index) {
+
+    *index = compiler->program->constants.count;
+
+    return Vec_Value_add(&compiler->program->constants, value);
+}
+
+char* BytecodeCompiler_allocate(BytecodeCompiler* compiler, int count, int* reg) {
+
+    *reg = compiler->nextRegister;
+    compiler->nextRegister += count;
+
+    if(compiler->nextRegister > VM_MAX_FRAME_SIZE) return "Expression needs too many registers";
+
+    if(compiler->nextRegister > compiler->function->frameSize) {
+
+        compiler->function->frameSize = compiler->nextRegister;
+    }
+
+    return 0;
+}
+
+char* BytecodeCompiler_compileExpression(BytecodeCompiler* compiler, ASTNode* node, int destination);
+
+//Parameters already live in registers, everything else is computed into a temporary
+char* BytecodeCompiler_compileOperand(BytecodeCompiler* compiler, ASTNode* node, int* reg) {
+
+    char* error;
+
+    if(node->type == Symbol && node->SN_KIND == (void*)SymbolParameter) {
+
+        *reg = (int)(size_t)node->SN_SLOT;
+
+        return 0;
+    }
+
+    if((error = BytecodeCompiler_allocate(compiler, 1, reg)) != 0) return error;
+
+    return BytecodeCompiler_compileExpression(compiler, node, *reg);
+}
+
+char* BytecodeCompiler_compileOperator(BytecodeCompiler* compiler, ASTNode* node, int destination) {
+
+    char* error;
+    int left, right;
+    int saved = compiler->nextRegister;
+    ASTOperatorType op = (ASTOperatorType)(size_t)node->ON_OPERATOR;
+    ASTNode* left_expr = node->ON_LEFT_EXPR;
+    ASTNode* right_expr = node->ON_RIGHT_EXPR;
+
+    static const BytecodeOp register_ops[] = {
+        OpAddRegisters, OpSubtractRegisters, OpMultiplyRegisters, OpDivideRegisters
+    };
+
+    static const BytecodeOp immediate_ops[] = {
+        OpAddImmediate, OpSubtractImmediate, OpMultiplyImmediate
+    };
+
+    if(op == OpInvalid) return "Unknown operator";
+
+    //Addition and multiplication commute, so a literal on the left can become the immediate
+    if(left_expr->type == NumberLiteral && right_expr->type != NumberLiteral && (op == OpAdd || op == OpMultiply)) {
+
+        left_expr = node->ON_RIGHT_EXPR;
+        right_expr = node->ON_LEFT_EXPR;
+    }
+
+    if((error = BytecodeCompiler_compileOperand(compiler, left_expr, &left)) != 0) return error;
+
+    if(right_expr->type == NumberLiteral && op != OpDivide) {
+
+        error = BytecodeCompiler_emit(compiler, immediate_ops[op], destination, left,
+            (int)(long)right_expr->NLN_NUMBER);
+    } else if((error = BytecodeCompiler_compileOperand(compiler, right_expr, &right)) == 0) {
+
+        error = BytecodeCompiler_emit(compiler, register_ops[op], destination, left, right);
+    }
+
+    compiler->nextRegister = saved;
+
+    return error;
+}
+
+//Arguments are computed into consecutive registers which become the callee's
+//parameter registers, so calls never copy their arguments
+char* BytecodeCompiler_compileInvocation(BytecodeCompiler* compiler, ASTNode* node, int destination) {
+
+    char* error;
+    int base;
+    int saved = compiler->nextRegister;
+    ASTNode* symbol = node->IN_SYMBOL;
+    ASTNode* args = node->IN_ARGS;
+
+    if((error = BytecodeCompiler_allocate(compiler, args->childCount, &base)) != 0) return error;
+
+    for(int i = 0; i < args->childCount; i++) {
+
+        if((error = BytecodeCompiler_compileExpression(compiler, args->children[i], base + i)) != 0) {
+
+            return error;
+        }
+    }
+
+    compiler->nextRegister = saved;
+
+    if(symbol->SN_KIND == (void*)SymbolExternal) {
+
+        String* name = (String*)symbol->SN_TEXT;
+        int builtin = Builtin_lookUp(name->data, name->length);
+
+        if(builtin < 0) return "Invoked symbol is not declared and is not a builtin";
+
+        return BytecodeCompiler_emit(compiler, OpCallBuiltin, destination, base, builtin | (args->childCount << 16));
+    }
+
+    if(symbol->SN_KIND != (void*)SymbolGlobal) return "Calls through parameters are not supported by the bytecode compiler";
+
+    int function = compiler->program->globalFunctions[(size_t)symbol->SN_SLOT];
+
+    if(function < 0) return "Invoked symbol is not declared as a lambda";
+
+    if(compiler->program->functions[function].paramCount != args->childCount) {
+
+        return "Wrong number of arguments in lambda invocation";
+    }
+
+    return BytecodeCompiler_emit(compiler, OpCall, destination, base, function);
+}
+
+char* BytecodeCompiler_compileExpression(BytecodeCompiler* compiler, ASTNode* node, int destination) {
+
+    char* error;
+    int constant;
+    Value value;
+
+    switch(node->type) {
+
+        case NumberLiteral:
+            return BytecodeCompiler_emit(compiler, OpLoadInt, destination, 0, (int)(long)node->NLN_NUMBER);
+
+        case StringLiteral:
+            if(node->SLN_VALUE == 0 &&
+                (error = String_decodeEscapes((String*)node->SLN_STRING, (char**)&node->SLN_VALUE)) != 0) {
+
+                return error;
+            }
+
+            value.type = ValueString;
+            value.string = (char*)node->SLN_VALUE;
+
+            if((error = BytecodeCompiler_addConstant(compiler, value, &constant)) != 0) return error;
+
+            return BytecodeCompiler_emit(compiler, OpLoadConstant, destination, 0, constant);
+
+        case Symbol:
+            if(node->SN_KIND == (void*)SymbolParameter) {
+
+                return BytecodeCompiler_emit(compiler, OpMove, destination, (int)(size_t)node->SN_SLOT, 0);
+            }
+
+            if(node->SN_KIND == (void*)SymbolGlobal) {
+
+                return BytecodeCompiler_emit(compiler, OpLoadGlobal, destination, 0, (int)(size_t)node->SN_SLOT);
+            }
+
+            return "Builtins can only be invoked";
+
+        case Operator:
+            return BytecodeCompiler_compileOperator(compiler, node, destination);
+
+        case Invocation:
+            return BytecodeCompiler_compileInvocation(compiler, node, destination);
+
+        default:
+            return "Expression is not supported by the bytecode compiler";
+    }
+}
+
+char* BytecodeCompiler_compileFunction(BytecodeCompiler* compiler, BytecodeFunction* function) {
+
+    char* error;
+    int result;
+
+    compiler->function = function;
+    compiler->nextRegister = function->paramCount;
+    function->frameSize = function->paramCount;
+    function->codeStart = compiler->program->code.count;
+
+    if((error = BytecodeCompiler_allocate(compiler, 1, &result)) != 0) return error;
+
+    if((error = BytecodeCompiler_compileExpression(compiler, function->lambda->LN_EXPR, result)) != 0) return error;
+
+    return BytecodeCompiler_emit(compiler, OpReturn, result, 0, 0);
+}
+
+//The module's top level becomes a parameterless main function that runs any
+//non-lambda initializers followed by the top-level expressions
+char* BytecodeCompiler_compileMain(BytecodeCompiler* compiler, ASTNode* module, BytecodeFunction* function) {
+
+    char* error;
+    int temporary;
+
+    compiler->function = function;
+    compiler->nextRegister = 0;
+    function->codeStart = compiler->program->code.count;
+
+    if((error = BytecodeCompiler_allocate(compiler, 1, &temporary)) != 0) return error;
+
+    for(int i = 0, slot = 0; i < module->childCount; i++) {
+
+        ASTNode* statement = module->children[i];
+
+        if(statement->type != Declaration) continue;
+
+        if(compiler->program->globalFunctions[slot] < 0 && statement->DN_INITIALIZER != 0) {
+
+            if((error = BytecodeCompiler_compileExpression(compiler, statement->DN_INITIALIZER, temporary)) != 0) return error;
+            if((error = BytecodeCompiler_emit(compiler, OpStoreGlobal, 0, temporary, slot)) != 0) return error;
+        }
+
+        slot++;
+    }
+
+    for(int i = 0; i < module->childCount; i++) {
+
+        if(module->children[i]->type == Declaration) continue;
+
+        if((error = BytecodeCompiler_compileExpression(compiler, module->children[i], temporary)) != 0) return error;
+    }
+
+    return BytecodeCompiler_emit(compiler, OpHalt, 0, 0, 0);
+}
+
+char* BytecodeProgram_compile(BytecodeProgram* program, ASTNode* module) {
+
+    char* error;
+    PassStats stats = { 0, 0 };
+    BytecodeCompiler compiler = { program };
+
+    memset(program, 0, sizeof(BytecodeProgram));
+
+    if((error = Module_resolveSymbols(module, &stats)) != 0) return error;
+
+    program->globalCount = Module_globalCount(module);
+    program->globalFunctions = (int*)malloc((program->globalCount + 1) * sizeof(int));
+    program->globals = (Value*)calloc(program->globalCount + 1, sizeof(Value));
+    program->functions = (BytecodeFunction*)calloc(program->globalCount + 1, sizeof(BytecodeFunction));
+    program->registers = (Value*)malloc(VM_REGISTER_COUNT * sizeof(Value));
+    program->frames = (VMFrame*)malloc(VM_FRAME_COUNT * sizeof(VMFrame));
+    program->registerCount = VM_REGISTER_COUNT;
+    program->frameCount = VM_FRAME_COUNT;
+
+    if(
+        program->globalFunctions == 0 || program->globals == 0 || program->functions == 0 ||
+        program->registers == 0 || program->frames == 0
+    ) {
+
+        BytecodeProgram_cleanUp(program);
+
+        return "Failed to allocate space for a bytecode program";
+    }
+
+    //Every declared lambda gets its function index up front so calls can be resolved directly
+    for(int i = 0, slot = 0; i < module->childCount; i++) {
+
+        ASTNode* statement = module->children[i];
+
+        if(statement->type != Declaration) continue;
+
+        program->globalFunctions[slot] = -1;
+
+        if(statement->DN_INITIALIZER != 0 && statement->DN_INITIALIZER->type == Lambda) {
+
+            BytecodeFunction* function = &program->functions[program->functionCount];
+
+            function->lambda = statement->DN_INITIALIZER;
+            function->paramCount = function->lambda->LN_PARAMS->childCount;
+
+            program->globals[slot].type = ValueLambda;
+            program->globals[slot].lambda = function->lambda;
+            program->globalFunctions[slot] = program->functionCount++;
+        }
+
+        slot++;
+    }
+
+    for(int i = 0; i < program->functionCount; i++) {
+
+        if((error = BytecodeCompiler_compileFunction(&compiler, &program->functions[i])) != 0) {
+
+            BytecodeProgram_cleanUp(program);
+
+            return error;
+        }
+    }
+
+    program->mainFunction = program->functionCount++;
+
+    if((error = BytecodeCompiler_compileMain(&compiler, module, &program->functions[program->mainFunction])) != 0) {
+
+        BytecodeProgram_cleanUp(program);
+
+        return error;
+    }
+
+    return 0;
+}
+
+void BytecodeProgram_print(BytecodeProgram* program, FILE* out_file) {
+
+    for(int i = 0; i < program->functionCount; i++) {
+
+        BytecodeFunction* function = &program->functions[i];
+        int end = i + 1 < program->functionCount ? program->functions[i + 1].codeStart : program->code.count;
+
+        fprintf(out_file, "function %i (%i params, %i registers)%s\n",
+            i, function->paramCount, function->frameSize, i == program->mainFunction ? " main" : "");
+
+        for(int j = function->codeStart; j < end; j++) {
+
+            Instruction* instruction = &program->code.data[j];
+
+            fprintf(out_file, "    %4i  %-6s r%i, %i, %i\n", j, BytecodeOpName[instruction->op],
+                instruction->a, instruction->b, instruction->c);
+        }
+    }
+}
+
+void BytecodeProgram_cleanUp(BytecodeProgram* program) {
+
+    Vec_Instruction_cleanUp(&program->code);
+    Vec_Value_cleanUp(&program->constants);
+    free(program->functions);
+    free(program->globalFunctions);
+    free(program->globals);
+    free(program->registers);
+    free(program->frames);
+}
+
+//Dispatch uses a computed goto table where the compiler supports it so every
+//handler ends in its own indirect jump, falling back to a plain switch otherwise
+#ifdef __GNUC__
+#define VM_NEXT() goto *dispatch_table[(instruction = pc++)->op]
+#define VM_BEGIN_DISPATCH() VM_NEXT(); {
+#define VM_CASE(op) label_##op:
+#define VM_END_DISPATCH() }
+#else
+#define VM_NEXT() goto dispatch
+#define VM_BEGIN_DISPATCH() dispatch: switch((instruction = pc++)->op) {
+#define VM_CASE(op) case op:
+#define VM_END_DISPATCH() }
+#endif
+
+char* VM_execute(BytecodeProgram* program, int function, Value* result) {
+
+    char* error;
+    Instruction* code = program->code.data;
+    Instruction* pc = code + program->functions[function].codeStart;
+    Instruction* instruction;
+    BytecodeFunction* callee;
+    Value* base = program->registers;
+    Value* registers_end = program->registers + program->registerCount;
+    Value* constants = program->constants.data;
+    Value* globals = program->globals;
+    VMFrame* frames = program->frames;
+    int depth = 0;
+    int divisor;
+
+    if(program->functions[function].frameSize > program->registerCount) return "Register stack overflow";
+
+#ifdef __GNUC__
+    static void* dispatch_table[] = {
+        &&label_OpLoadInt,
+        &&label_OpLoadConstant,
+        &&label_OpLoadGlobal,
+        &&label_OpStoreGlobal,
+        &&label_OpMove,
+        &&label_OpAddRegisters,
+        &&label_OpSubtractRegisters,
+        &&label_OpMultiplyRegisters,
+        &&label_OpDivideRegisters,
+        &&label_OpAddImmediate,
+        &&label_OpSubtractImmediate,
+        &&label_OpMultiplyImmediate,
+        &&label_OpCall,
+        &&label_OpCallBuiltin,
+        &&label_OpReturn,
+        &&label_OpHalt
+    };
+#endif
+
+    VM_BEGIN_DISPATCH()
+
+        VM_CASE(OpLoadInt)
+            base[instruction->a].type = ValueInt;
+            base[instruction->a].integer = instruction->c;
+            VM_NEXT();
+
+        VM_CASE(OpLoadConstant)
+            base[instruction->a] = constants[instruction->c];
+            VM_NEXT();
+
+        VM_CASE(OpLoadGlobal)
+            base[instruction->a] = globals[instruction->c];
+            VM_NEXT();
+
+        VM_CASE(OpStoreGlobal)
+            globals[instruction->c] = base[instruction->b];
+            VM_NEXT();
+
+        VM_CASE(OpMove)
+            base[instruction->a] = base[instruction->b];
+            VM_NEXT();
+
+        VM_CASE(OpAddRegisters)
+            if(base[instruction->b].type != ValueInt || base[instruction->c].type != ValueInt) goto type_error;
+            base[instruction->a].type = ValueInt;
+            base[instruction->a].integer = (int)((unsigned int)base[instruction->b].integer + (unsigned int)base[instruction->c].integer);
+            VM_NEXT();
+
+        VM_CASE(OpSubtractRegisters)
+            if(base[instruction->b].type != ValueInt || base[instruction->c].type != ValueInt) goto type_error;
+            base[instruction->a].type = ValueInt;
+            base[instruction->a].integer = (int)((unsigned int)base[instruction->b].integer - (unsigned int)base[instruction->c].integer);
+            VM_NEXT();
+
+        VM_CASE(OpMultiplyRegisters)
+            if(base[instruction->b].type != ValueInt || base[instruction->c].type != ValueInt) goto type_error;
+            base[instruction->a].type = ValueInt;
+            base[instruction->a].integer = (int)((unsigned int)base[instruction->b].integer * (unsigned int)base[instruction->c].integer);
+            VM_NEXT();
+
+        VM_CASE(OpDivideRegisters)
+            if(base[instruction->b].type != ValueInt || base[instruction->c].type != ValueInt) goto type_error;
+            divisor = base[instruction->c].integer;
+            if(divisor == 0) return "Division by zero";
+            base[instruction->a].integer = divisor == -1
+                ? (int)(0u - (unsigned int)base[instruction->b].integer)
+                : base[instruction->b].integer / divisor;
+            base[instruction->a].type = ValueInt;
+            VM_NEXT();
+
+        VM_CASE(OpAddImmediate)
+            if(base[instruction->b].type != ValueInt) goto type_error;
+            base[instruction->a].type = ValueInt;
+            base[instruction->a].integer = (int)((unsigned int)base[instruction->b].integer + (unsigned int)instruction->c);
+            VM_NEXT();
+
+        VM_CASE(OpSubtractImmediate)
+            if(base[instruction->b].type != ValueInt) goto type_error;
+            base[instruction->a].type = ValueInt;
+            base[instruction->a].integer = (int)((unsigned int)base[instruction->b].integer - (unsigned int)instruction->c);
+            VM_NEXT();
+
+        VM_CASE(OpMultiplyImmediate)
+            if(base[instruction->b].type != ValueInt) goto type_error;
+            base[instruction->a].type = ValueInt;
+            base[instruction->a].integer = (int)((unsigned int)base[instruction->b].integer * (unsigned int)instruction->c);
+            VM_NEXT();
+
+        VM_CASE(OpCall)
+            if(depth == program->frameCount) return "Maximum recursion depth exceeded";
+
+            callee = &program->functions[instruction->c];
+            frames[depth].returnPc = pc;
+            frames[depth].base = base;
+            frames[depth].destination = instruction->a;
+            depth++;
+
+            base += instruction->b;
+            if(base + callee->frameSize > registers_end) return "Register stack overflow";
+
+            pc = code + callee->codeStart;
+            VM_NEXT();
+
+        VM_CASE(OpCallBuiltin)
+            if((error = BuiltinList[instruction->c & 0xffff].function(
+                &base[instruction->b], instruction->c >> 16, &base[instruction->a])) != 0) return error;
+            VM_NEXT();
+
+        VM_CASE(OpReturn)
+            if(depth == 0) {
+
+                *result = base[instruction->a];
+
+                return 0;
+            }
+
+            depth--;
+            frames[depth].base[frames[depth].destination] = base[instruction->a];
+            base = frames[depth].base;
+            pc = frames[depth].returnPc;
+            VM_NEXT();
+
+        VM_CASE(OpHalt)
+            result->type = ValueNone;
+
+            return 0;
+    VM_END_DISPATCH()
+
+    return "Invalid bytecode instruction";
+
+type_error:
+    return "Operands of an operator must be integers";
+}
+
+char* VM_run(BytecodeProgram* program) {
+
+    Value result;
+
+    return VM_execute(program, program->mainFunction, &result);
+}
+
+char* VM_call(BytecodeProgram* program, int function, Value* args, Value* result) {
+
+    if(function < 0 || function >= program->functionCount) return "Invalid bytecode function";
+
+    if(program->functions[function].paramCount > program->registerCount) return "Register stack overflow";
+
+    for(int i = 0; i < program->functions[function].paramCount; i++) program->registers[i] = args[i];
+
+    return VM_execute(program, function, result);
+}
@@ -0,0 +1,82 @@
+#ifndef BYTECODE_H
+#define BYTECODE_H
+
+#include "ast.h"
+#include "builtins.h"
+#include <stdio.h>
+
+typedef enum {
+    OpLoadInt,
+    OpLoadConstant,
+    OpLoadGlobal,
+    OpStoreGlobal,
+    OpMove,
+    OpAddRegisters,
+    OpSubtractRegisters,
+    OpMultiplyRegisters,
+    OpDivideRegisters,
+    OpAddImmediate,
+    OpSubtractImmediate,
+    OpMultiplyImmediate,
+    OpCall,
+    OpCallBuiltin,
+    OpReturn,
+    OpHalt,
+    BytecodeOpCount
+} BytecodeOp;
+
+//a is always the destination register, b a source register or the first
+//register of a call's arguments, and c a third register, immediate value,
+//constant, global, function or builtin index depending on the op. Builtin
+//calls pack the argument count into the upper half of c
+typedef struct Instruction_s {
+    unsigned char op;
+    unsigned char a;
+    unsigned short b;
+    int c;
+} Instruction;
+
+VEC_DECLARE(Instruction)
+VEC_DECLARE(Value)
+
+typedef struct BytecodeFunction_s {
+    ASTNode* lambda;
+    int paramCount;
+    int frameSize;
+    int codeStart;
+} BytecodeFunction;
+
+typedef struct VMFrame_s {
+    Instruction* returnPc;
+    Value* base;
+    int destination;
+} VMFrame;
+
+typedef struct BytecodeProgram_s {
+    VEC(Instruction) code;
+    VEC(Value) constants;
+    BytecodeFunction* functions;
+    int functionCount;
+    int mainFunction;
+    int* globalFunctions;
+    Value* globals;
+    int globalCount;
+    Value* registers;
+    int registerCount;
+    VMFrame* frames;
+    int frameCount;
+} BytecodeProgram;
+
+extern const char* BytecodeOpName[];
+
+char* BytecodeProgram_compile(BytecodeProgram* program, ASTNode* module);
+
+void BytecodeProgram_print(BytecodeProgram* program, FILE* out_file);
+
+void BytecodeProgram_cleanUp(BytecodeProgram* program);
+
+char* VM_run(BytecodeProgram* program);
+
+char* VM_call(BytecodeProgram* program, int function, Value* args, Value* result);
+
+#endif //BYTECODE_H
@@ -0,0 +1,493 @@
+#include "callgraph.h"
+#include "analysis.h"
+#include <stdlib.h>
+
+#define CALLGRAPH_HASH_SEED 14695981039346656037ull
+#define CALLGRAPH_HASH_PRIME 1099511628211ull
+
+//The first declaration of every top-level name and its node, if it declares
+//a lambda. Open addressing on the name's hash
+typedef struct CallGraphName_s {
+    String* name;
+    CallGraphNode* node;
+} CallGraphName;
+
+typedef struct CallGraphNames_s {
+    CallGraphName* entries;
+    size_t capacity;
+} CallGraphNames;
+
+size_t CallGraphNames_index(CallGraphNames* names, String* name) {
+
+    unsigned long long hash = CALLGRAPH_HASH_SEED;
+    size_t index;
+
+    for(size_t i = 0; i < name->length; i++) hash = (hash ^ (unsigned char)name->data[i]) * CALLGRAPH_HASH_PRIME;
+
+    for(index = (size_t)hash & (names->capacity - 1); names->entries[index].name != 0;
+        index = (index + 1) & (names->capacity - 1)) {
+
+        if(String_equals(names->entries[index].name, name)) break;
+    }
+
+    return index;
+}
+
+//Nodes have to be complete, the table points into them
+char* CallGraphNames_build(CallGraphNames* names, CallGraph* graph, ASTNode* module) {
+
+    int lambda_index = 0;
+
+    names->capacity = 16;
+
+    while(names->capacity < (size_t)module->childCount * 2) names->capacity *= 2;
+
+    if((names->entries = (CallGraphName*)calloc(names->capacity, sizeof(CallGraphName))) == 0) {
+
+        return "Unable to allocate space for the call graph's names";
+    }
+
+    for(int i = 0; i < module->childCount; i++) {
+
+        ASTNode* statement = module->children[i];
+        CallGraphNode* node = 0;
+        size_t index;
+
+        if(statement->type != Declaration) continue;
+
+        if(statement->DN_INITIALIZER != 0 && statement->DN_INITIALIZER->type == Lambda) {
+
+            node = &graph->nodes.data[lambda_index++];
+        }
+
+        index = CallGraphNames_index(names, (String*)statement->DN_SYMBOL->SN_TEXT);
+
+        if(names->entries[index].name != 0) continue;
+
+        names->entries[index].name = (String*)statement->DN_SYMBOL->SN_TEXT;
+        names->entries[index].node = node;
+    }
+
+    return 0;
+}
+
+CallGraphNode* CallGraph_findNode(CallGraphNames* names, ASTNode* lambda, String* name) {
+
+    if(lambda != 0 && ASTLambdaNode_findParameter(lambda, name) >= 0) return 0;
+
+    return names->entries[CallGraphNames_index(names, name)].node;
+}
+
+int CallGraph_listContains(VEC(CallGraphNodePtr)* list, CallGraphNode* entry) {
+
+    for(int i = 0; i < list->count; i++) if(list->data[i] == entry) return 1;
+
+    return 0;
+}
+
+//Adds an edge for every invocation or other reference to a declared lambda
+//found under node, in source order and without duplicates
+char* CallGraph_collectEdges(CallGraphNames* names, ASTNode* lambda, ASTNode* node, VEC(CallGraphNodePtr)* edges) {
+
+    char* error;
+    CallGraphNode* target;
+
+    if(node == 0) return 0;
+
+    if(node->type == Lambda) lambda = node;
+
+    if(node->type == Symbol) {
+
+        target = CallGraph_findNode(names, lambda, (String*)node->SN_TEXT);
+
+        if(target != 0 && !CallGraph_listContains(edges, target)) return Vec_CallGraphNodePtr_add(edges, target);
+
+        return 0;
+    }
+
+    for(int i = 0; i < node->childCount; i++) {
+
+        if((error = CallGraph_collectEdges(names, lambda, node->children[i], edges)) != 0) {
+
+            return error;
+        }
+    }
+
+    return 0;
+}
+
+char* CallGraph_build(CallGraph* graph, ASTNode* module) {
+
+    char* error;
+    CallGraphNames names;
+
+    Vec_CallGraphNode_init(&graph->nodes, 0);
+    Vec_CallGraphNodePtr_init(&graph->roots, 0);
+    graph->sccCount = 0;
+
+    for(int i = 0; i < module->childCount; i++) {
+
+        ASTNode* statement = module->children[i];
+        CallGraphNode node = { 0 };
+
+        if(statement->type != Declaration) continue;
+
+        if(statement->DN_INITIALIZER == 0 || statement->DN_INITIALIZER->type != Lambda) continue;
+
+        node.declaration = statement;
+        node.lambda = statement->DN_INITIALIZER;
+        node.index = -1;
+        Vec_CallGraphNodePtr_init(&node.callees, 0);
+
+        if((error = Vec_CallGraphNode_add(&graph->nodes, node)) != 0) {
+
+            CallGraph_cleanUp(graph);
+
+            return error;
+        }
+    }
+
+    if((error = CallGraphNames_build(&names, graph, module)) != 0) {
+
+        CallGraph_cleanUp(graph);
+
+        return error;
+    }
+
+    for(int i = 0; i < graph->nodes.count && error == 0; i++) {
+
+        CallGraphNode* node = &graph->nodes.data[i];
+
+        error = CallGraph_collectEdges(&names, 0, node->lambda, &node->callees);
+    }
+
+    //Whatever runs at the top level uses the lambdas it reaches, value
+    //initializers included
+    for(int i = 0; i < module->childCount && error == 0; i++) {
+
+        ASTNode* statement = module->children[i];
+
+        if(statement->type == Declaration) {
+
+            if(statement->DN_INITIALIZER == 0 || statement->DN_INITIALIZER->type == Lambda) continue;
+
+            statement = statement->DN_INITIALIZER;
+        }
+
+        error = CallGraph_collectEdges(&names, 0, statement, &graph->roots);
+    }
+
+    free(names.entries);
+
+    if(error != 0) CallGraph_cleanUp(graph);
+
+    return error;
+}
+
+typedef struct TarjanState_s {
+    int nextIndex;
+    VEC(CallGraphNodePtr) stack;
+} TarjanState;
+
+char* CallGraph_strongConnect(CallGraph* graph, TarjanState* state, CallGraphNode* node) {
+
+    char* error;
+
+    node->index = node->lowLink = state->nextIndex++;
+    node->onStack = 1;
+
+    if((error = Vec_CallGraphNodePtr_add(&state->stack, node)) != 0) return error;
+
+    for(int i = 0; i < node->callees.count; i++) {
+
+        CallGraphNode* callee = node->callees.data[i];
+
+        if(callee->index < 0) {
+
+            if((error = CallGraph_strongConnect(graph, state, callee)) != 0) return error;
+
+            if(callee->lowLink < node->lowLink) node->lowLink = callee->lowLink;
+        } else if(callee->onStack && callee->index < node->lowLink) {
+
+            node->lowLink = callee->index;
+        }
+    }
+
+    if(node->lowLink != node->index) return 0;
+
+    CallGraphNode* member;
+
+    do {
+
+        member = state->stack.data[--state->stack.count];
+        member->onStack = 0;
+        member->scc = graph->sccCount;
+    } while(member != node);
+
+    graph->sccCount++;
+
+    return 0;
+}
+
+//Tarjan's algorithm; numbers every node's strongly connected component and
+//lists each component's members
+char* CallGraph_findSCCs(CallGraph* graph) {
+
+    char* error = 0;
+    TarjanState state = { 0 };
+    CallGraphNode** last;
+
+    Vec_CallGraphNodePtr_init(&state.stack, 0);
+
+    for(int i = 0; i < graph->nodes.count && error == 0; i++) {
+
+        CallGraphNode* node = &graph->nodes.data[i];
+
+        if(node->index < 0) error = CallGraph_strongConnect(graph, &state, node);
+    }
+
+    Vec_CallGraphNodePtr_cleanUp(&state.stack);
+
+    if(error != 0) return error;
+
+    if((last = (CallGraphNode**)calloc(graph->sccCount + 1, sizeof(CallGraphNode*))) == 0) {
+
+        return "Unable to allocate space for the call graph's components";
+    }
+
+    for(int i = 0; i < graph->nodes.count; i++) {
+
+        CallGraphNode* node = &graph->nodes.data[i];
+
+        if(last[node->scc] != 0) last[node->scc]->sccNext = node;
+
+        node->sccFirst = last[node->scc] != 0 ? last[node->scc]->sccFirst : node;
+        node->sccNext = 0;
+        last[node->scc] = node;
+    }
+
+    free(last);
+
+    return 0;
+}
+
+int CallGraphNode_isRecursive(CallGraph* graph, CallGraphNode* node) {
+
+    return node->sccFirst->sccNext != 0 || CallGraph_listContains(&node->callees, node);
+}
+
+String* CallGraphNode_name(CallGraphNode* node) {
+
+    return (String*)node->declaration->DN_SYMBOL->SN_TEXT;
+}
+
+char* CallGraph_writeDot(CallGraph* graph, FILE* out_file) {
+
+    fprintf(out_file, "digraph callgraph {\n    \"<main>\" [shape=box];\n");
+
+    for(int i = 0; i < graph->nodes.count; i++) {
+
+        CallGraphNode* node = &graph->nodes.data[i];
+        String* name = CallGraphNode_name(node);
+
+        fprintf(out_file, "    \"%.*s\" [label=\"%.*s\\nLambda%i scc %i\"%s];\n",
+            (int)name->length, name->data, (int)name->length, name->data,
+            (int)(size_t)node->lambda->LN_ID, node->scc,
+            node->lambda->LN_COLD ? " style=dashed" : "");
+    }
+
+    for(int i = 0; i < graph->roots.count; i++) {
+
+        String* name = CallGraphNode_name(graph->roots.data[i]);
+
+        fprintf(out_file, "    \"<main>\" -> \"%.*s\";\n", (int)name->length, name->data);
+    }
+
+    for(int i = 0; i < graph->nodes.count; i++) {
+
+        CallGraphNode* node = &graph->nodes.data[i];
+        String* name = CallGraphNode_name(node);
+
+        for(int j = 0; j < node->callees.count; j++) {
+
+            String* callee_name = CallGraphNode_name(node->callees.data[j]);
+
+            fprintf(out_file, "    \"%.*s\" -> \"%.*s\";\n",
+                (int)name->length, name->data, (int)callee_name->length, callee_name->data);
+        }
+    }
+
+    fprintf(out_file, "}\n");
+
+    return 0;
+}
+
+char* CallGraph_writeJson(CallGraph* graph, FILE* out_file) {
+
+    fprintf(out_file, "{\n  \"nodes\": [");
+
+    for(int i = 0; i < graph->nodes.count; i++) {
+
+        CallGraphNode* node = &graph->nodes.data[i];
+        String* name = CallGraphNode_name(node);
+
+        fprintf(out_file, "%s\n    { \"name\": \"%.*s\", \"lambda\": %i, \"scc\": %i, \"recursive\": %s, \"cold\": %s }",
+            i == 0 ? "" : ",", (int)name->length, name->data, (int)(size_t)node->lambda->LN_ID, node->scc,
+            CallGraphNode_isRecursive(graph, node) ? "true" : "false",
+            node->lambda->LN_COLD ? "true" : "false");
+    }
+
+    fprintf(out_file, "\n  ],\n  \"roots\": [");
+
+    for(int i = 0; i < graph->roots.count; i++) {
+
+        String* name = CallGraphNode_name(graph->roots.data[i]);
+
+        fprintf(out_file, "%s\"%.*s\"", i == 0 ? "" : ", ", (int)name->length, name->data);
+    }
+
+    fprintf(out_file, "],\n  \"edges\": [");
+
+    int first = 1;
+
+    for(int i = 0; i < graph->nodes.count; i++) {
+
+        CallGraphNode* node = &graph->nodes.data[i];
+        String* name = CallGraphNode_name(node);
+
+        for(int j = 0; j < node->callees.count; j++) {
+
+            String* callee_name = CallGraphNode_name(node->callees.data[j]);
+
+            fprintf(out_file, "%s\n    { \"from\": \"%.*s\", \"to\": \"%.*s\" }", first ? "" : ",",
+                (int)name->length, name->data, (int)callee_name->length, callee_name->data);
+
+            first = 0;
+        }
+    }
+
+    fprintf(out_file, "\n  ]\n}\n");
+
+    return 0;
+}
+
+void CallGraph_cleanUp(CallGraph* graph) {
+
+    for(int i = 0; i < graph->nodes.count; i++) {
+
+        CallGraphNode* node = &graph->nodes.data[i];
+
+        Vec_CallGraphNodePtr_cleanUp(&node->callees);
+    }
+
+    Vec_CallGraphNode_cleanUp(&graph->nodes);
+    Vec_CallGraphNodePtr_cleanUp(&graph->roots);
+}
+
+//Places a whole strongly connected component, then everything it calls, so
+//callers and callees end up next to each other in the emitted text
+char* CallGraph_place(CallGraph* graph, CallGraphNode* node, VEC(CallGraphNodePtr)* order) {
+
+    char* error;
+
+    if(node->placed) return 0;
+
+    for(CallGraphNode* member = node->sccFirst; member != 0; member = member->sccNext) {
+
+        member->placed = 1;
+        member->order = (int)order->count;
+
+        if((error = Vec_CallGraphNodePtr_add(order, member)) != 0) return error;
+    }
+
+    for(CallGraphNode* member = node->sccFirst; member != 0; member = member->sccNext) {
+
+        for(int j = 0; j < member->callees.count; j++) {
+
+            if((error = CallGraph_place(graph, member->callees.data[j], order)) != 0) {
+
+                return error;
+            }
+        }
+    }
+
+    return 0;
+}
+
+int CallGraphNode_compareOrder(const void* a, const void* b) {
+
+    return (*(CallGraphNode**)a)->order - (*(CallGraphNode**)b)->order;
+}
+
+//Reorders the module's lambda declarations depth-first from the lambdas the
+//top-level code uses, and marks the ones that are never reached from there
+//as cold. A lambda is assigned where its declaration runs, so declarations
+//only trade places within a run of lambda declarations, never across a
+//statement that might call them
+char* Module_layOutLambdas(ASTNode* module, PassStats* stats) {
+
+    char* error;
+    CallGraph graph;
+    VEC(CallGraphNodePtr) order;
+
+    if((error = CallGraph_build(&graph, module)) != 0) return error;
+
+    Vec_CallGraphNodePtr_init(&order, 0);
+
+    if((error = CallGraph_findSCCs(&graph)) != 0) {
+
+        CallGraph_cleanUp(&graph);
+
+        return error;
+    }
+
+    for(int i = 0; i < graph.roots.count && error == 0; i++) {
+
+        error = CallGraph_place(&graph, graph.roots.data[i], &order);
+    }
+
+    for(int i = 0; i < graph.nodes.count; i++) {
+
+        CallGraphNode* node = &graph.nodes.data[i];
+
+        stats->nodesVisited++;
+
+        node->lambda->LN_COLD = (void*)(size_t)!node->placed;
+        stats->nodesChanged += !node->placed;
+    }
+
+    for(int i = 0; i < graph.nodes.count && error == 0; i++) {
+
+        error = CallGraph_place(&graph, &graph.nodes.data[i], &order);
+    }
+
+    //Nodes were built in declaration order, so order can hold each run's
+    //nodes while they are sorted by where they were placed
+    for(int i = 0, j = 0; i < module->childCount && error == 0; i++) {
+
+        int start = i;
+        int first = j;
+
+        while(i < module->childCount && ASTDeclarationNode_IsLambda(module->children[i])) {
+
+            order.data[j] = &graph.nodes.data[j];
+            i++;
+            j++;
+        }
+
+        qsort(&order.data[first], j - first, sizeof(CallGraphNode*), CallGraphNode_compareOrder);
+
+        for(int k = start; k < i; k++) {
+
+            ASTNode* statement = module->children[k];
+
+            module->children[k] = order.data[first + k - start]->declaration;
+            stats->nodesChanged += module->children[k] != statement;
+        }
+    }
+
+    Vec_CallGraphNodePtr_cleanUp(&order);
+    CallGraph_cleanUp(&graph);
+
+    return error;
+}
@@ -0,0 +1,56 @@
+#ifndef CALLGRAPH_H
+#define CALLGRAPH_H
+
+#include "ast.h"
+#include "vec.h"
+#include <stdio.h>
+
+typedef struct CallGraphNode_s* CallGraphNodePtr;
+
+VEC_DECLARE(CallGraphNodePtr)
+
+//sccFirst and sccNext list the members of a node's strongly connected
+//component in module order
+typedef struct CallGraphNode_s {
+    ASTNode* declaration;
+    ASTNode* lambda;
+    VEC(CallGraphNodePtr) callees;
+    int index;
+    int lowLink;
+    int onStack;
+    int scc;
+    struct CallGraphNode_s* sccFirst;
+    struct CallGraphNode_s* sccNext;
+    int placed;
+    int order;
+} CallGraphNode;
+
+VEC_DECLARE(CallGraphNode)
+
+//roots are the lambdas referenced from the module's top-level expressions
+//and the initializers of its other declarations.
+//Nodes are stored inline and edges point into nodes, which stops growing once
+//the graph is built
+typedef struct CallGraph_s {
+    VEC(CallGraphNode) nodes;
+    VEC(CallGraphNodePtr) roots;
+    int sccCount;
+} CallGraph;
+
+char* CallGraph_build(CallGraph* graph, ASTNode* module);
+
+char* CallGraph_findSCCs(CallGraph* graph);
+
+char* CallGraph_place(CallGraph* graph, CallGraphNode* node, VEC(CallGraphNodePtr)* order);
+
+int CallGraphNode_isRecursive(CallGraph* graph, CallGraphNode* node);
+
+char* CallGraph_writeDot(CallGraph* graph, FILE* out_file);
+
+char* CallGraph_writeJson(CallGraph* graph, FILE* out_file);
+
+void CallGraph_cleanUp(CallGraph* graph);
+
+char* Module_layOutLambdas(ASTNode* module, PassStats* stats);
+
+#endif //CALLGRAPH_H
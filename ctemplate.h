@@ -15,41 +15,132 @@ TemplateConfig CTemplateConfig = {
     "", //StringLiteral
     "", //NumberLiteral
     },
-    17,
+    32,
     {
         {
             "module",
-            "{{er`{{c`pred`{{t`lambda_type_declaration`}}`}}`}}\n"
+            "{{t`module_types`}}\n"
             "{{tc`global_declarations`}}\n"
-            "{{er`{{c`pred`{{t`lambda_body`}}`}}`}}\n"
+            "{{t`module_bodies`}}\n"
             "#include <stdio.h>\n"
             "int main(int argc, char* argv[]) {\n"
             "{{tc`global_assignments`}}\n"
             "{{tc`global_expressions`}}\n"
-            "}\n", 0, 
+            "}\n", 0, 0
+        },
+        {
+            "module_types",
+            "{{er`{{c`pred`{{t`lambda_type_declaration`}}`}}`}}", 0,
+            ASTNode_IsLambda
+        },
+        {
+            "module_bodies",
+            "{{er`{{c`pred`{{t`lambda_body`}}`}}`}}", 0,
+            ASTNode_IsLambda
+        },
+        {
+            "split_header",
+            "#include <stdio.h>\n"
+            "{{er`{{c`pred`{{t`lambda_type_declaration`}}`}}`}}\n"
+            "{{tc`global_extern_declarations`}}\n"
+            "{{er`{{c`pred`{{t`lambda_prototype`}}`}}`}}", 0,
             ASTNode_IsLambda
-        }, 
+        },
+        {
+            "split_main",
+            "{{tc`global_declarations`}}\n"
+            "int main(int argc, char* argv[]) {\n"
+            "{{tc`global_assignments`}}\n"
+            "{{tc`global_expressions`}}\n"
+            "}\n", 0, 0
+        },
+        {
+            "global_extern_declarations",
+            "{{e`{{t`global_lambda_extern`}}{{t`global_value_extern`}}\n`}}", 0, 0
+        },
+        {
+            "global_lambda_extern",
+            "{{c`pred`extern Lambda_{{sc1a7}}Type {{sc0a0}};`}}", 0,
+            ASTDeclarationNode_IsLambda
+        },
+        {
+            "global_value_extern",
+            "{{c`pred`extern int {{sc0a0}};`}}", 0,
+            ASTDeclarationNode_IsValue
+        },
+        {
+            "lambda_prototype",
+            "int Lambda_{{sa7}}({{ec0`{{c`!first`, `}}int`}});\n", 0, 0
+        },
         {
             "global_assignments",
-            "{{e`{{c`pred`{{sc0a0}} = Lambda{{ic1a0}};`}}\n`}}", 0,
-            ASTNode_IsDeclaration
-        }, 
+            "{{e`{{t`global_lambda_assignment`}}{{t`global_value_assignment`}}\n`}}", 0, 0
+        },
+        {
+            "global_lambda_assignment",
+            "{{c`pred`{{sc0a0}} = Lambda_{{sc1a7}};`}}", 0,
+            ASTDeclarationNode_IsLambda
+        },
+        {
+            "global_value_assignment",
+            "{{c`pred`{{sc0a0}} = {{tc1`expression`}};`}}", 0,
+            ASTDeclarationNode_IsValue
+        },
         {
             "global_declarations",
-            "{{e`{{c`pred`Lambda{{ic1a0}}Type {{sc0a0}};`}}\n`}}", 0,
-            ASTNode_IsDeclaration
-        }, 
+            "{{e`{{t`global_lambda_declaration`}}{{t`global_value_declaration`}}\n`}}", 0, 0
+        },
+        {
+            "global_lambda_declaration",
+            "{{c`pred`Lambda_{{sc1a7}}Type {{sc0a0}};`}}", 0,
+            ASTDeclarationNode_IsLambda
+        },
+        {
+            "global_value_declaration",
+            "{{c`pred`int {{sc0a0}};`}}", 0,
+            ASTDeclarationNode_IsValue
+        },
         {
             "global_expressions",
             "{{e`{{t`expression`}};`}}", 0, 0
         },
         {
             "lambda_body",
-            "int Lambda{{ia0}}({{ec0`{{c`!first`, `}}int {{sc0a0}}`}}) { return {{tc1`expression`}}; }\n", 0, 0
+            "{{c`a1`{{t`memo_lambda_body`}}`}}"
+            "{{c`!a1`{{c`a5`__attribute__((cold)) `}}int Lambda_{{sa7}}({{ec0`{{c`!first`, `}}int {{sc0a0}}`}}) { return {{tc1`expression`}}; }\n`}}", 0, 0
+        },
+        {
+            "memo_lambda_body",
+            "typedef struct { int memo_valid; int memo_value;{{ec0` int k_{{sc0a0}};`}} } Lambda_{{sa7}}MemoEntry;\n"
+            "static Lambda_{{sa7}}MemoEntry Lambda_{{sa7}}Memo[{{ia3}}];\n"
+            "static int Lambda_{{sa7}}Body({{ec0`{{c`!first`, `}}int {{sc0a0}}`}}) { return {{tc1`expression`}}; }\n"
+            "{{c`a5`__attribute__((cold)) `}}int Lambda_{{sa7}}({{ec0`{{c`!first`, `}}int {{sc0a0}}`}}) {\n"
+            "{{c`a2`{{t`memo_direct_index`}}`}}{{c`!a2`{{t`memo_hashed_index`}}`}}"
+            "    Lambda_{{sa7}}MemoEntry* memo_entry = &Lambda_{{sa7}}Memo[memo_index];\n"
+            "    if(!memo_entry->memo_valid{{ec0` || memo_entry->k_{{sc0a0}} != {{sc0a0}}`}}) {\n"
+            "        int memo_value = Lambda_{{sa7}}Body({{ec0`{{c`!first`, `}}{{sc0a0}}`}});\n"
+            "        memo_entry = &Lambda_{{sa7}}Memo[memo_index];\n"
+            "        memo_entry->memo_valid = 1;\n"
+            "        memo_entry->memo_value = memo_value;\n"
+            "{{ec0`        memo_entry->k_{{sc0a0}} = {{sc0a0}};\n`}}"
+            "    }\n"
+            "    return memo_entry->memo_value;\n"
+            "}\n", 0, 0
+        },
+        {
+            "memo_direct_index",
+            "    if((unsigned int){{sc0c0c0a0}} >= {{ia3}}u) return Lambda_{{sa7}}Body({{sc0c0c0a0}});\n"
+            "    unsigned int memo_index = (unsigned int){{sc0c0c0a0}};\n", 0, 0
+        },
+        {
+            "memo_hashed_index",
+            "    unsigned int memo_index = 2166136261u;\n"
+            "{{ec0`    memo_index = (memo_index ^ (unsigned int){{sc0a0}}) * 16777619u;\n`}}"
+            "    memo_index &= {{ia3}}u - 1u;\n", 0, 0
         },
         {
             "lambda_type_declaration",
-            "typedef int (*Lambda{{ia0}}Type)({{ec0`{{c`!first`, `}}int`}});\n", 0, 0
+            "typedef int (*Lambda_{{sa7}}Type)({{ec0`{{c`!first`, `}}int`}});\n", 0, 0
         },
         {
             "expression",
@@ -0,0 +1,653 @@
+#include "document.h"
+#include "parse.h"
+#include "scanner.h"
+#include "helpers.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define DOCUMENT_HASH_SEED 14695981039346656037ull
+#define DOCUMENT_HASH_PRIME 1099511628211ull
+#define DOCUMENT_BLOCK_STATEMENTS 256
+
+unsigned long long Document_hashText(char* text, size_t length) {
+
+    unsigned long long hash = DOCUMENT_HASH_SEED;
+
+    for(size_t i = 0; i < length; i++) hash = (hash ^ (unsigned char)text[i]) * DOCUMENT_HASH_PRIME;
+
+    return hash;
+}
+
+char* Document_findLambda(ASTNode* node, void* args) {
+
+    return ASTNode_IsLambda(node) ? "Found a lambda" : 0;
+}
+
+void DocumentStatement_cleanUp(DocumentStatement* statement) {
+
+    if(statement->node != 0) ASTNode_cleanUp(statement->node);
+
+    for(int i = 0; i < STREAM_SECTION_COUNT; i++) {
+
+        if(statement->sections[i] != 0) String_cleanUp(statement->sections[i]);
+    }
+
+    free(statement->text);
+}
+
+int DocumentStatement_needsRender(DocumentStatement* statement) {
+
+    return statement->node != 0 && statement->renderedCopy != statement->copy;
+}
+
+//Trades everything parsing and rendering produced, the text is the same
+void DocumentStatement_swap(DocumentStatement* a, DocumentStatement* b) {
+
+    DocumentStatement saved = *a;
+
+    a->node = b->node;
+    a->error = b->error;
+    a->anonymous = b->anonymous;
+    a->copy = b->copy;
+    a->renderedCopy = b->renderedCopy;
+    memcpy(a->sections, b->sections, sizeof(a->sections));
+
+    b->node = saved.node;
+    b->error = saved.error;
+    b->anonymous = saved.anonymous;
+    b->copy = saved.copy;
+    b->renderedCopy = saved.renderedCopy;
+    memcpy(b->sections, saved.sections, sizeof(b->sections));
+}
+
+//Text that does not parse is kept with its error until an edit fixes it
+char* DocumentStatement_parse(DocumentStatement* statement) {
+
+    ScannerSource scanner;
+
+    Scanner_init(&scanner, statement->text, statement->length);
+    ScannerSkipWhitespace(&scanner);
+
+    if(ScannerAtEnd(&scanner)) return 0;
+
+    if((statement->error = Statement_tryParse(&scanner, &statement->node, 0)) != 0) {
+
+        statement->node = 0;
+
+        return 0;
+    }
+
+    ScannerSkipWhitespace(&scanner);
+
+    if(!ScannerAtEnd(&scanner)) {
+
+        ASTNode_cleanUp(statement->node);
+
+        statement->node = 0;
+        statement->error = "Statement did not end at its ';'";
+
+        return 0;
+    }
+
+    //Only lambdas outside a declaration are named after the statement text
+    statement->anonymous = statement->node->type != Declaration &&
+        ASTNode_forAll(statement->node, Document_findLambda, 0) != 0;
+
+    return 0;
+}
+
+void DocumentBlock_update(DocumentBlock* block) {
+
+    block->sourceLength = 0;
+    block->dirty = 0;
+    block->errors = 0;
+    block->anonymous = 0;
+
+    memset(block->outputLengths, 0, sizeof(block->outputLengths));
+
+    for(size_t i = 0; i < block->statements.count; i++) {
+
+        DocumentStatement* statement = &block->statements.data[i];
+
+        block->sourceLength += statement->length;
+        block->dirty += DocumentStatement_needsRender(statement);
+        block->errors += statement->error != 0;
+        block->anonymous += statement->anonymous;
+
+        if(statement->renderedCopy < 0) continue;
+
+        for(int j = 0; j < STREAM_SECTION_COUNT; j++) block->outputLengths[j] += statement->sections[j]->length;
+    }
+}
+
+//A statement's place in the blocks and where its text starts in the source.
+//Blocks are never empty, so past the last statement block is the block count
+typedef struct DocumentCursor_s {
+    size_t block;
+    size_t index;
+    size_t start;
+} DocumentCursor;
+
+DocumentStatement* DocumentCursor_statement(Document* document, DocumentCursor* cursor) {
+
+    if(cursor->block >= document->blocks.count) return 0;
+
+    return &document->blocks.data[cursor->block].statements.data[cursor->index];
+}
+
+void DocumentCursor_next(Document* document, DocumentCursor* cursor) {
+
+    DocumentBlock* block = &document->blocks.data[cursor->block];
+
+    cursor->start += block->statements.data[cursor->index].length;
+
+    if(++cursor->index < block->statements.count) return;
+
+    cursor->block++;
+    cursor->index = 0;
+}
+
+int DocumentCursor_equals(DocumentCursor* a, DocumentCursor* b) {
+
+    return a->block == b->block && a->index == b->index;
+}
+
+//Finds the statement holding offset, the last one when offset is the end
+void Document_seek(Document* document, size_t offset, DocumentCursor* cursor) {
+
+    VEC(DocumentBlock)* blocks = &document->blocks;
+    DocumentBlock* block;
+
+    *cursor = (DocumentCursor){ 0, 0, 0 };
+
+    if(blocks->count == 0) return;
+
+    while(cursor->block + 1 < blocks->count && cursor->start + blocks->data[cursor->block].sourceLength <= offset) {
+
+        cursor->start += blocks->data[cursor->block++].sourceLength;
+    }
+
+    block = &blocks->data[cursor->block];
+
+    while(cursor->index + 1 < block->statements.count && cursor->start + block->statements.data[cursor->index].length <= offset) {
+
+        cursor->start += block->statements.data[cursor->index++].length;
+    }
+}
+
+size_t Document_sourceLength(Document* document) {
+
+    size_t length = 0;
+
+    for(size_t i = 0; i < document->blocks.count; i++) length += document->blocks.data[i].sourceLength;
+
+    return length;
+}
+
+char* Document_cut(VEC(DocumentStatement)* statements, char* text, size_t length) {
+
+    char* error;
+    DocumentStatement statement = { length };
+
+    statement.hash = Document_hashText(text, length);
+    statement.renderedCopy = -1;
+
+    if((statement.text = (char*)malloc(length == 0 ? 1 : length)) == 0) return "Unable to allocate space for statement text";
+
+    memcpy(statement.text, text, length);
+
+    if((error = Vec_DocumentStatement_add(statements, statement)) != 0) free(statement.text);
+
+    return error;
+}
+
+//Swaps the statements from first up to boundary for replacements. Only the
+//blocks those statements sit in are rebuilt, split into blocks of at most
+//DOCUMENT_BLOCK_STATEMENTS. Nothing changes when it fails
+char* Document_splice(Document* document, DocumentCursor* first, DocumentCursor* boundary,
+    VEC(DocumentStatement)* replacements) {
+
+    char* error;
+    VEC(DocumentBlock)* blocks = &document->blocks;
+    VEC(DocumentStatement) statements;
+    VEC(DocumentBlock) rebuilt;
+    size_t from = first->block;
+    size_t to = boundary->block + (boundary->block < blocks->count && boundary->index > 0);
+    size_t count;
+
+    if(to <= from && from < blocks->count) to = from + 1;
+
+    Vec_DocumentStatement_init(&statements, 0);
+    Vec_DocumentBlock_init(&rebuilt, 0);
+
+    error = from < blocks->count ? Vec_DocumentStatement_append(&statements, blocks->data[from].statements.data, first->index) : 0;
+
+    if(error == 0) error = Vec_DocumentStatement_append(&statements, replacements->data, replacements->count);
+
+    if(error == 0 && boundary->block + 1 == to) {
+
+        DocumentBlock* last = &blocks->data[boundary->block];
+
+        error = Vec_DocumentStatement_append(&statements, &last->statements.data[boundary->index],
+            last->statements.count - boundary->index);
+    }
+
+    count = (statements.count + DOCUMENT_BLOCK_STATEMENTS - 1) / DOCUMENT_BLOCK_STATEMENTS;
+
+    for(size_t i = 0, taken = 0; i < count && error == 0; i++) {
+
+        DocumentBlock block;
+        size_t size = (statements.count - taken) / (count - i);
+
+        Vec_DocumentStatement_init(&block.statements, 0);
+
+        if((error = Vec_DocumentStatement_append(&block.statements, &statements.data[taken], size)) != 0 ||
+            (error = Vec_DocumentBlock_add(&rebuilt, block)) != 0) {
+
+            Vec_DocumentStatement_cleanUp(&block.statements);
+
+            break;
+        }
+
+        DocumentBlock_update(&rebuilt.data[i]);
+        taken += size;
+    }
+
+    if(error == 0 && rebuilt.count > to - from) error = Vec_DocumentBlock_reserve(blocks, rebuilt.count - (to - from));
+
+    Vec_DocumentStatement_cleanUp(&statements);
+
+    if(error != 0) {
+
+        for(size_t i = 0; i < rebuilt.count; i++) Vec_DocumentStatement_cleanUp(&rebuilt.data[i].statements);
+
+        Vec_DocumentBlock_cleanUp(&rebuilt);
+
+        return error;
+    }
+
+    for(DocumentCursor cursor = *first; !DocumentCursor_equals(&cursor, boundary); DocumentCursor_next(document, &cursor)) {
+
+        DocumentStatement_cleanUp(DocumentCursor_statement(document, &cursor));
+    }
+
+    for(size_t i = from; i < to; i++) Vec_DocumentStatement_cleanUp(&blocks->data[i].statements);
+
+    memmove(&blocks->data[from + rebuilt.count], &blocks->data[to], (blocks->count - to) * sizeof(DocumentBlock));
+
+    if(rebuilt.count != 0) memcpy(&blocks->data[from], rebuilt.data, rebuilt.count * sizeof(DocumentBlock));
+
+    blocks->count = blocks->count - (to - from) + rebuilt.count;
+
+    Vec_DocumentBlock_cleanUp(&rebuilt);
+
+    return 0;
+}
+
+//Statements are cut at the top-level ';' Scanner_findStatementEnd finds,
+//which is where the parser ends every statement that parses. The new text
+//starts at the statement holding the edit and takes in the statements after
+//it only as long as the cuts have not landed on the start of one past the
+//edit. Everything from there on is untouched and keeps its nodes, rendered
+//sections and blocks
+char* Document_edit(Document* document, size_t offset, size_t removed, char* inserted, size_t inserted_length) {
+
+    char* error = 0;
+    size_t length = Document_sourceLength(document);
+    size_t end = offset + removed;
+    size_t position = 0;
+    size_t prefix;
+    String text;
+    VEC(DocumentStatement) replacements;
+    VEC(VoidPtr) reused;
+    DocumentCursor first;
+    DocumentCursor boundary;
+    DocumentCursor append;
+    DocumentCursor old;
+    DocumentStatement* statement;
+    int renumber = 0;
+
+    if(offset > length || removed > length - offset) return "Edit lies outside of the document";
+
+    Document_seek(document, offset, &first);
+    String_init(&text);
+    Vec_DocumentStatement_init(&replacements, 0);
+    Vec_VoidPtr_init(&reused, 0);
+
+    if((statement = DocumentCursor_statement(document, &first)) != 0) {
+
+        error = String_appendBytes(&text, statement->text, offset - first.start);
+    }
+
+    if(error == 0) error = String_appendBytes(&text, inserted, inserted_length);
+
+    prefix = text.length;
+
+    //Statements starting inside the edit are cut again, the one the edit ends
+    //in lends the text after it
+    for(boundary = first; error == 0 && (statement = DocumentCursor_statement(document, &boundary)) != 0 &&
+        boundary.start < end; DocumentCursor_next(document, &boundary)) {
+
+        if(boundary.start + statement->length > end) {
+
+            error = String_appendBytes(&text, &statement->text[end - boundary.start], boundary.start + statement->length - end);
+        }
+    }
+
+    //An untouched statement starts at boundary.start - end + prefix of text
+    append = boundary;
+
+    while(error == 0) {
+
+        size_t statement_end;
+
+        while((statement = DocumentCursor_statement(document, &boundary)) != 0 && boundary.start - end + prefix < position) {
+
+            DocumentCursor_next(document, &boundary);
+        }
+
+        if(statement != 0 && boundary.start - end + prefix == position) break;
+
+        if(position == text.length && DocumentCursor_statement(document, &append) == 0) break;
+
+        if(Scanner_findStatementEnd(&text.data[position], text.length - position, &statement_end) == 0) {
+
+            error = Document_cut(&replacements, &text.data[position], statement_end + 1);
+            position += statement_end + 1;
+        } else if((statement = DocumentCursor_statement(document, &append)) != 0) {
+
+            error = String_appendBytes(&text, statement->text, statement->length);
+            DocumentCursor_next(document, &append);
+        } else {
+
+            error = Document_cut(&replacements, &text.data[position], text.length - position);
+            position = text.length;
+        }
+    }
+
+    String_release(&text);
+
+    //Statements whose text came through the edit unchanged keep what they
+    //had, the rest are parsed
+    old = first;
+    document->parsedCount = 0;
+
+    for(size_t i = 0; i < replacements.count && error == 0; i++) {
+
+        DocumentStatement* replacement = &replacements.data[i];
+        DocumentStatement* candidate = DocumentCursor_equals(&old, &boundary) ? 0 : DocumentCursor_statement(document, &old);
+
+        if(candidate != 0 && candidate->hash == replacement->hash && candidate->length == replacement->length &&
+            memcmp(candidate->text, replacement->text, candidate->length) == 0) {
+
+            error = Vec_VoidPtr_add(&reused, candidate);
+            DocumentCursor_next(document, &old);
+
+            continue;
+        }
+
+        document->parsedCount++;
+
+        if((error = Vec_VoidPtr_add(&reused, 0)) == 0) error = DocumentStatement_parse(replacement);
+
+        renumber |= replacement->anonymous;
+    }
+
+    for(size_t i = 0; i < reused.count; i++) if(reused.data[i] != 0) DocumentStatement_swap(&replacements.data[i], reused.data[i]);
+
+    //Dropping an anonymous statement can change the copy numbers after it
+    for(old = first; error == 0 && !DocumentCursor_equals(&old, &boundary); DocumentCursor_next(document, &old)) {
+
+        statement = DocumentCursor_statement(document, &old);
+        renumber |= statement->node != 0 && statement->anonymous;
+    }
+
+    if(error == 0 && (error = Document_splice(document, &first, &boundary, &replacements)) != 0) {
+
+        for(size_t i = 0; i < reused.count; i++) if(reused.data[i] != 0) DocumentStatement_swap(&replacements.data[i], reused.data[i]);
+    }
+
+    if(error != 0) for(size_t i = 0; i < replacements.count; i++) DocumentStatement_cleanUp(&replacements.data[i]);
+
+    if(error == 0) document->renumber |= renumber;
+
+    Vec_DocumentStatement_cleanUp(&replacements);
+    Vec_VoidPtr_cleanUp(&reused);
+
+    return error;
+}
+
+char* Document_open(Document* document, TemplateConfig* config, char* source, size_t length) {
+
+    char* error;
+
+    Vec_DocumentBlock_init(&document->blocks, 0);
+
+    document->renumber = 0;
+    document->parsedCount = 0;
+    document->renderedCount = 0;
+
+    if((error = Stream_getTemplates(config, document->templates)) != 0 ||
+        (error = Document_edit(document, 0, 0, source, length)) != 0) {
+
+        Document_cleanUp(document);
+
+        return error;
+    }
+
+    return 0;
+}
+
+//Identical statements with anonymous lambdas are told apart by how many
+//came before them
+typedef struct DocumentCopies_s {
+    unsigned long long hash;
+    long count;
+} DocumentCopies;
+
+long DocumentCopies_next(DocumentCopies* copies, size_t capacity, unsigned long long hash) {
+
+    size_t index = (size_t)hash & (capacity - 1);
+
+    while(copies[index].count != 0 && copies[index].hash != hash) index = (index + 1) & (capacity - 1);
+
+    copies[index].hash = hash;
+
+    return copies[index].count++;
+}
+
+//Numbers the copies of each statement with anonymous lambdas again, only
+//needed after an edit added or dropped one
+char* Document_renumber(Document* document) {
+
+    char* error;
+    size_t capacity = 1;
+    DocumentCopies* copies;
+
+    for(size_t i = 0; i < document->blocks.count; i++) capacity += document->blocks.data[i].anonymous;
+
+    if((error = size_grow(capacity * 2, sizeof(DocumentCopies), &capacity)) != 0) return error;
+
+    if((copies = (DocumentCopies*)calloc(capacity, sizeof(DocumentCopies))) == 0) {
+
+        return "Unable to allocate space for anonymous statement copies";
+    }
+
+    for(size_t i = 0; i < document->blocks.count; i++) {
+
+        DocumentBlock* block = &document->blocks.data[i];
+
+        if(block->anonymous == 0) continue;
+
+        block->dirty = 0;
+
+        for(size_t k = 0; k < block->statements.count; k++) {
+
+            DocumentStatement* statement = &block->statements.data[k];
+
+            if(statement->anonymous) statement->copy = DocumentCopies_next(copies, capacity, statement->hash);
+
+            block->dirty += DocumentStatement_needsRender(statement);
+        }
+    }
+
+    free(copies);
+
+    document->renumber = 0;
+
+    return 0;
+}
+
+char* Document_renderStatement(Document* document, DocumentBlock* block, DocumentStatement* statement) {
+
+    char* error = 0;
+    char owner[48];
+    unsigned int hash = (unsigned int)(statement->hash ^ (statement->hash >> 32));
+
+    for(int j = 0; j < STREAM_SECTION_COUNT && statement->renderedCopy >= 0; j++) {
+
+        block->outputLengths[j] -= statement->sections[j]->length;
+    }
+
+    statement->renderedCopy = -1;
+
+    for(int j = 0; j < STREAM_SECTION_COUNT && error == 0; j++) {
+
+        if(statement->sections[j] == 0 && (statement->sections[j] = String_new(0)) == 0) {
+
+            error = "Unable to allocate memory for a rendered statement";
+        } else {
+
+            statement->sections[j]->length = 0;
+        }
+    }
+
+    if(statement->copy == 0) sprintf(owner, "anonymous_%08x", hash);
+    else sprintf(owner, "anonymous_%08x_%ld", hash, statement->copy);
+
+    if(error == 0) error = Stream_renderStatement(document->templates, statement->node, owner, statement->sections);
+
+    document->renderedCount++;
+
+    if(error != 0) return error;
+
+    statement->renderedCopy = statement->copy;
+    block->dirty--;
+
+    for(int j = 0; j < STREAM_SECTION_COUNT; j++) block->outputLengths[j] += statement->sections[j]->length;
+
+    return 0;
+}
+
+//Re-renders the statements that are new since the last render and the ones
+//whose anonymous lambdas changed copy number, skipping blocks with neither
+char* Document_render(Document* document) {
+
+    char* error;
+
+    document->renderedCount = 0;
+
+    for(size_t i = 0; i < document->blocks.count; i++) {
+
+        DocumentBlock* block = &document->blocks.data[i];
+
+        if(block->errors == 0) continue;
+
+        for(size_t k = 0; k < block->statements.count; k++) {
+
+            if(block->statements.data[k].error != 0) return block->statements.data[k].error;
+        }
+    }
+
+    if(document->renumber && (error = Document_renumber(document)) != 0) return error;
+
+    for(size_t i = 0; i < document->blocks.count; i++) {
+
+        DocumentBlock* block = &document->blocks.data[i];
+
+        for(size_t k = 0; k < block->statements.count && block->dirty != 0; k++) {
+
+            DocumentStatement* statement = &block->statements.data[k];
+
+            if(DocumentStatement_needsRender(statement) &&
+                (error = Document_renderStatement(document, block, statement)) != 0) return error;
+        }
+    }
+
+    return 0;
+}
+
+size_t Document_outputLength(Document* document) {
+
+    size_t length = strlen(STREAM_SUFFIX);
+
+    for(int j = 0; j < STREAM_SECTION_COUNT; j++) length += strlen(StreamSectionPrefixes[j]);
+
+    for(size_t i = 0; i < document->blocks.count; i++) {
+
+        for(int j = 0; j < STREAM_SECTION_COUNT; j++) length += document->blocks.data[i].outputLengths[j];
+    }
+
+    return length;
+}
+
+char* Document_write(Document* document, DocumentWriter write, void* args) {
+
+    char* error;
+
+    for(int j = 0; j < STREAM_SECTION_COUNT; j++) {
+
+        if((error = write(StrView_fromCString(StreamSectionPrefixes[j]), args)) != 0) return error;
+
+        for(size_t i = 0; i < document->blocks.count; i++) {
+
+            DocumentBlock* block = &document->blocks.data[i];
+
+            if(block->outputLengths[j] == 0) continue;
+
+            for(size_t k = 0; k < block->statements.count; k++) {
+
+                DocumentStatement* statement = &block->statements.data[k];
+
+                if(statement->renderedCopy < 0 || statement->sections[j]->length == 0) continue;
+
+                if((error = write(String_view(statement->sections[j]), args)) != 0) return error;
+            }
+        }
+    }
+
+    return write(StrView_fromCString(STREAM_SUFFIX), args);
+}
+
+char* Document_copySource(Document* document, String* source) {
+
+    char* error;
+
+    if((error = String_reserve(source, Document_sourceLength(document))) != 0) return error;
+
+    for(size_t i = 0; i < document->blocks.count; i++) {
+
+        DocumentBlock* block = &document->blocks.data[i];
+
+        for(size_t k = 0; k < block->statements.count; k++) {
+
+            String_appendBytes(source, block->statements.data[k].text, block->statements.data[k].length);
+        }
+    }
+
+    return 0;
+}
+
+void Document_cleanUp(Document* document) {
+
+    for(size_t i = 0; i < document->blocks.count; i++) {
+
+        DocumentBlock* block = &document->blocks.data[i];
+
+        for(size_t k = 0; k < block->statements.count; k++) DocumentStatement_cleanUp(&block->statements.data[k]);
+
+        Vec_DocumentStatement_cleanUp(&block->statements);
+    }
+
+    Vec_DocumentBlock_cleanUp(&document->blocks);
+}
@@ -0,0 +1,79 @@
+#ifndef DOCUMENT_H
+#define DOCUMENT_H
+
+#include "ast.h"
+#include "stream.h"
+#include "string.h"
+#include "template.h"
+#include "vec.h"
+#include <stddef.h>
+
+//One top-level statement and the text up to and including its ';', leading
+//whitespace and comments included. The statements of a document tile its
+//source, the last one may be blank or unfinished. copy tells identical
+//statements with anonymous lambdas apart, renderedCopy is the copy its
+//sections were rendered for, -1 if they are not rendered
+typedef struct DocumentStatement_s {
+    size_t length;
+    unsigned long long hash;
+    char* text;
+    ASTNode* node;
+    char* error;
+    int anonymous;
+    long copy;
+    long renderedCopy;
+    String* sections[STREAM_SECTION_COUNT];
+} DocumentStatement;
+
+VEC_DECLARE(DocumentStatement)
+
+//A run of consecutive statements and their totals. Finding an offset or
+//sizing the output walks blocks rather than statements, and since nothing
+//holds an absolute offset an edit only rewrites the blocks it touches
+typedef struct DocumentBlock_s {
+    VEC(DocumentStatement) statements;
+    size_t sourceLength;
+    size_t outputLengths[STREAM_SECTION_COUNT];
+    size_t dirty;
+    size_t errors;
+    size_t anonymous;
+} DocumentBlock;
+
+VEC_DECLARE(DocumentBlock)
+
+//Takes one piece of the rendered module, returning an error stops the write
+typedef char* (*DocumentWriter)(StrView chunk, void* args);
+
+//A source kept open for editing. Edits only reparse the statements whose
+//text they change and renders only re-render those. The output has the
+//sections yc --stream writes, but lambdas outside declarations are named
+//after their statement's text rather than its position, so inserting a
+//statement renames nothing after it
+typedef struct Document_s {
+    Template* templates[STREAM_SECTION_COUNT];
+    VEC(DocumentBlock) blocks;
+    int renumber;
+    size_t parsedCount;
+    size_t renderedCount;
+} Document;
+
+char* Document_open(Document* document, TemplateConfig* config, char* source, size_t length);
+
+//Applies the edit entirely or, when it returns an error, not at all
+char* Document_edit(Document* document, size_t offset, size_t removed, char* inserted, size_t inserted_length);
+
+char* Document_render(Document* document);
+
+size_t Document_outputLength(Document* document);
+
+//Hands the output of the last render to write one section prefix or rendered
+//statement section at a time. The pieces stay the document's
+char* Document_write(Document* document, DocumentWriter write, void* args);
+
+size_t Document_sourceLength(Document* document);
+
+char* Document_copySource(Document* document, String* source);
+
+void Document_cleanUp(Document* document);
+
+#endif //DOCUMENT_H
@@ -0,0 +1,100 @@
+#include "eval.h"
+#include "analysis.h"
+#include <limits.h>
+
+//Evaluates the pure integer subset of the language: number literals, operators,
+//parameters of the enclosing lambda and invocations of pure lambdas. Arithmetic
+//wraps at 32 bits like the int the C backend renders. Every visited node costs
+//one step and every invocation one level of depth, and running out of either
+//fails the evaluation so callers can leave the expression to run at runtime
+char* ASTNode_evaluate(DeclarationIndex* index, ASTNode* lambda, int* args, ASTNode* node,
+    EvalBudget* budget, int depth, int* result) {
+
+    char* error;
+    int left, right, parameter;
+    long value;
+    ASTNode* callee;
+
+    if(budget->steps-- <= 0) return "Evaluation step budget exceeded";
+
+    switch(node->type) {
+
+        case NumberLiteral:
+            value = (long)node->NLN_NUMBER;
+
+            if(value > INT_MAX || value < INT_MIN) return "Number literal does not fit in an int";
+
+            *result = (int)value;
+
+            return 0;
+
+        case Symbol:
+            if(lambda == 0) return "Symbol is not bound to a constant";
+
+            if((parameter = ASTLambdaNode_findParameter(lambda, (String*)node->SN_TEXT)) < 0) {
+
+                return "Symbol is not bound to a parameter";
+            }
+
+            *result = args[parameter];
+
+            return 0;
+
+        case Operator:
+            if((error = ASTNode_evaluate(index, lambda, args, node->ON_LEFT_EXPR, budget, depth, &left)) != 0) return error;
+            if((error = ASTNode_evaluate(index, lambda, args, node->ON_RIGHT_EXPR, budget, depth, &right)) != 0) return error;
+
+            switch((ASTOperatorType)(size_t)node->ON_OPERATOR) {
+
+                case OpAdd:
+                    *result = (int)((unsigned int)left + (unsigned int)right);
+                    return 0;
+
+                case OpSubtract:
+                    *result = (int)((unsigned int)left - (unsigned int)right);
+                    return 0;
+
+                case OpMultiply:
+                    *result = (int)((unsigned int)left * (unsigned int)right);
+                    return 0;
+
+                case OpDivide:
+                    if(right == 0 || (left == INT_MIN && right == -1)) return "Division has no defined result";
+
+                    *result = left / right;
+                    return 0;
+
+                default:
+                    return "Unknown operator";
+            }
+
+        case Invocation: {
+
+            if(lambda != 0 && ASTLambdaNode_findParameter(lambda, (String*)node->IN_SYMBOL->SN_TEXT) >= 0) {
+
+                return "Invoked symbol is a parameter";
+            }
+
+            if((error = DeclarationIndex_findLambda(index, (String*)node->IN_SYMBOL->SN_TEXT, &callee)) != 0) return error;
+
+            if(!ASTLambdaNode_IsPure(callee)) return "Invoked lambda is not pure";
+
+            if(callee->LN_PARAMS->childCount != node->IN_ARGS->childCount) return "Wrong number of arguments";
+
+            if(depth >= budget->depth) return "Evaluation recursion budget exceeded";
+
+            int call_args[node->IN_ARGS->childCount + 1];
+
+            for(int i = 0; i < node->IN_ARGS->childCount; i++) {
+
+                if((error = ASTNode_evaluate(index, lambda, args, node->IN_ARGS->children[i],
+                    budget, depth, &call_args[i])) != 0) return error;
+            }
+
+            return ASTNode_evaluate(index, callee, call_args, callee->LN_EXPR, budget, depth + 1, result);
+        }
+
+        default:
+            return "Expression is outside of the evaluable subset";
+    }
+}
@@ -0,0 +1,15 @@
+#ifndef EVAL_H
+#define EVAL_H
+
+#include "analysis.h"
+#include "ast.h"
+
+typedef struct EvalBudget_s {
+    long steps;
+    int depth;
+} EvalBudget;
+
+char* ASTNode_evaluate(DeclarationIndex* index, ASTNode* lambda, int* args, ASTNode* node,
+    EvalBudget* budget, int depth, int* result);
+
+#endif //EVAL_H
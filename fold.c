@@ -0,0 +1,75 @@
+#include "fold.h"
+#include "eval.h"
+
+int ASTNode_isFoldable(ASTNode* node) {
+
+    if(node->type == Operator) {
+
+        return node->ON_LEFT_EXPR->type == NumberLiteral && node->ON_RIGHT_EXPR->type == NumberLiteral;
+    }
+
+    if(node->type != Invocation) return 0;
+
+    for(int i = 0; i < node->IN_ARGS->childCount; i++) {
+
+        if(node->IN_ARGS->children[i]->type != NumberLiteral) return 0;
+    }
+
+    return 1;
+}
+
+//Folds the children first so that nested calls like add(inc(1), 2) collapse
+//from the inside out, then replaces the node in its parent's slot with a
+//number literal if the evaluator manages to compute it within budget
+char* ASTNode_foldSlot(DeclarationIndex* index, ASTNode** slot, FoldOptions* options, PassStats* stats) {
+
+    char* error;
+    int value;
+    ASTNode* node = *slot;
+    ASTNode* literal;
+
+    if(node == 0) return 0;
+
+    stats->nodesVisited++;
+
+    for(int i = 0; i < node->childCount; i++) {
+
+        if((error = ASTNode_foldSlot(index, &node->children[i], options, stats)) != 0) return error;
+    }
+
+    if(!ASTNode_isFoldable(node)) return 0;
+
+    EvalBudget budget = { options->maxSteps, options->maxDepth };
+
+    if(ASTNode_evaluate(index, 0, 0, node, &budget, 0, &value) != 0) return 0;
+
+    if((error = ASTNode_create(&literal, NumberLiteral, 0, 1)) != 0) return error;
+
+    literal->NLN_NUMBER = (void*)(long)value;
+
+    ASTNode_cleanUp(node);
+
+    *slot = literal;
+    stats->nodesChanged++;
+
+    return 0;
+}
+
+//Folding never replaces a declaration, only what is under it, so the index
+//stays valid for the whole pass
+char* Module_foldConstants(ASTNode* module, FoldOptions* options, PassStats* stats) {
+
+    char* error = 0;
+    DeclarationIndex index;
+
+    if((error = DeclarationIndex_build(&index, module)) != 0) return error;
+
+    for(int i = 0; i < module->childCount && error == 0; i++) {
+
+        error = ASTNode_foldSlot(&index, &module->children[i], options, stats);
+    }
+
+    DeclarationIndex_cleanUp(&index);
+
+    return error;
+}
@@ -0,0 +1,16 @@
+#ifndef FOLD_H
+#define FOLD_H
+
+#include "analysis.h"
+#include "ast.h"
+
+typedef struct FoldOptions_s {
+    long maxSteps;
+    int maxDepth;
+} FoldOptions;
+
+char* ASTNode_foldSlot(DeclarationIndex* index, ASTNode** slot, FoldOptions* options, PassStats* stats);
+
+char* Module_foldConstants(ASTNode* module, FoldOptions* options, PassStats* stats);
+
+#endif //FOLD_H
@@ -1,4 +1,5 @@
 #include "helpers.h"
+#include <stdint.h>
 
 void print_indent(int depth) {
     
@@ -15,6 +16,26 @@ char* cstr_skip_whitespace(char** s, char* end, int expect_more) {
     return expect_more ? "Hit the end of a cstr while skipping whitespace" : 0;
 }
 
+//Rounds needed up to the next power of two, failing instead of wrapping when
+//that many elements would not fit in the address space
+char* size_grow(size_t needed, size_t element_size, size_t* capacity) {
+
+    size_t grown = 1;
+
+    if(needed > 1) {
+
+        if(needed - 1 > (SIZE_MAX >> 1)) return "Requested size is too large";
+
+        grown = (size_t)1 << (sizeof(size_t) * 8 - __builtin_clzl(needed - 1));
+    }
+
+    if(grown > SIZE_MAX / element_size) return "Requested size is too large";
+
+    *capacity = grown;
+
+    return 0;
+}
+
 void skip_whitespace(FILE* in_file) {
     
     char c = 0;
@@ -5,5 +5,6 @@
 
 void print_indent(int depth);
 char* cstr_skip_whitespace(char** s, char* end, int expect_more);
+char* size_grow(size_t needed, size_t element_size, size_t* capacity);
 
 #endif //HELPERS_H
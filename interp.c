@@ -0,0 +1,230 @@
+#include "interp.h"
+#include "resolve.h"
+#include "jit.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+//Links external symbols to builtins and decodes string literals ahead of time
+//so evaluation never has to look at symbol or literal text
+char* Interpreter_prepare(ASTNode* node, void* unused) {
+
+    char* error;
+
+    if(node->type == Symbol && node->SN_KIND == (void*)SymbolExternal) {
+
+        String* name = (String*)node->SN_TEXT;
+
+        node->SN_SLOT = (void*)(size_t)Builtin_lookUp(name->data, name->length);
+    }
+
+    if(node->type == StringLiteral && node->SLN_VALUE == 0) {
+
+        if((error = String_decodeEscapes((String*)node->SLN_STRING, (char**)&node->SLN_VALUE)) != 0) {
+
+            return error;
+        }
+    }
+
+    return 0;
+}
+
+char* Interpreter_init(Interpreter* interpreter, ASTNode* module) {
+
+    char* error;
+    PassStats stats = { 0, 0 };
+
+    interpreter->module = module;
+    interpreter->jit = 0;
+    interpreter->depth = 0;
+    interpreter->maxDepth = 10000;
+    interpreter->globalCount = Module_globalCount(module);
+    interpreter->globals = (Value*)calloc(interpreter->globalCount + 1, sizeof(Value));
+
+    if(interpreter->globals == 0) return "Failed to allocate space for interpreter globals";
+
+    if((error = Module_resolveSymbols(module, &stats)) != 0) return error;
+
+    return ASTNode_forAll(module, Interpreter_prepare, 0);
+}
+
+char* Interpreter_invoke(Interpreter* interpreter, ASTNode* node, Value* frame, Value* result) {
+
+    char* error;
+    ASTNode* symbol = node->IN_SYMBOL;
+    ASTNode* args = node->IN_ARGS;
+    Value callee;
+    Value arg_values[args->childCount + 1];
+
+    for(int i = 0; i < args->childCount; i++) {
+
+        if((error = Interpreter_evaluate(interpreter, args->children[i], frame, &arg_values[i])) != 0) {
+
+            return error;
+        }
+    }
+
+    if(symbol->SN_KIND == (void*)SymbolExternal) {
+
+        int builtin = (int)(size_t)symbol->SN_SLOT;
+
+        if(builtin < 0) return "Invoked symbol is not declared and is not a builtin";
+
+        return BuiltinList[builtin].function(arg_values, args->childCount, result);
+    }
+
+    if((error = Interpreter_evaluate(interpreter, symbol, frame, &callee)) != 0) return error;
+
+    if(callee.type != ValueLambda) return "Invoked symbol is not a lambda";
+
+    return Interpreter_call(interpreter, callee.lambda, arg_values, args->childCount, result);
+}
+
+char* Interpreter_evaluate(Interpreter* interpreter, ASTNode* node, Value* frame, Value* result) {
+
+    char* error;
+    Value left, right;
+
+    switch(node->type) {
+
+        case NumberLiteral:
+            result->type = ValueInt;
+            result->integer = (int)(long)node->NLN_NUMBER;
+
+            return 0;
+
+        case StringLiteral:
+            result->type = ValueString;
+            result->string = (char*)node->SLN_VALUE;
+
+            return 0;
+
+        case Symbol:
+            if(node->SN_KIND == (void*)SymbolParameter) {
+
+                *result = frame[(size_t)node->SN_SLOT];
+
+                return 0;
+            }
+
+            if(node->SN_KIND == (void*)SymbolGlobal) {
+
+                *result = interpreter->globals[(size_t)node->SN_SLOT];
+
+                return 0;
+            }
+
+            return "Builtins can only be invoked";
+
+        case Lambda:
+            result->type = ValueLambda;
+            result->lambda = node;
+
+            return 0;
+
+        case Operator:
+            if((error = Interpreter_evaluate(interpreter, node->ON_LEFT_EXPR, frame, &left)) != 0) return error;
+            if((error = Interpreter_evaluate(interpreter, node->ON_RIGHT_EXPR, frame, &right)) != 0) return error;
+
+            if(left.type != ValueInt || right.type != ValueInt) return "Operands of an operator must be integers";
+
+            result->type = ValueInt;
+
+            switch((ASTOperatorType)(size_t)node->ON_OPERATOR) {
+
+                case OpAdd:
+                    result->integer = (int)((unsigned int)left.integer + (unsigned int)right.integer);
+                    return 0;
+
+                case OpSubtract:
+                    result->integer = (int)((unsigned int)left.integer - (unsigned int)right.integer);
+                    return 0;
+
+                case OpMultiply:
+                    result->integer = (int)((unsigned int)left.integer * (unsigned int)right.integer);
+                    return 0;
+
+                case OpDivide:
+                    if(right.integer == 0) return "Division by zero";
+
+                    result->integer = (right.integer == -1) ? (int)(0u - (unsigned int)left.integer) : left.integer / right.integer;
+                    return 0;
+
+                default:
+                    return "Unknown operator";
+            }
+
+        case Invocation:
+            return Interpreter_invoke(interpreter, node, frame, result);
+
+        default:
+            return "Node cannot be evaluated";
+    }
+}
+
+char* Interpreter_call(Interpreter* interpreter, ASTNode* lambda, Value* args, int argc, Value* result) {
+
+    char* error;
+
+    if(argc != lambda->LN_PARAMS->childCount) return "Wrong number of arguments in lambda invocation";
+
+    if(interpreter->depth >= interpreter->maxDepth) return "Maximum recursion depth exceeded";
+
+    //Lambdas the JIT compiled take over as long as every argument is an integer
+    if(interpreter->jit != 0 && lambda->LN_NATIVE != 0) {
+
+        int int_args[JIT_MAX_PARAMS];
+        int i;
+
+        for(i = 0; i < argc && args[i].type == ValueInt; i++) int_args[i] = args[i].integer;
+
+        if(i == argc) {
+
+            result->type = ValueInt;
+
+            return Jit_invoke(interpreter->jit, lambda->LN_NATIVE, int_args, argc, &result->integer);
+        }
+    }
+
+    interpreter->depth++;
+    error = Interpreter_evaluate(interpreter, lambda->LN_EXPR, args, result);
+    interpreter->depth--;
+
+    return error;
+}
+
+//Binds every declaration before running any top-level expression, matching
+//the generated C where main assigns all globals first
+char* Interpreter_run(Interpreter* interpreter) {
+
+    char* error;
+    Value result;
+    ASTNode* module = interpreter->module;
+
+    for(int i = 0, slot = 0; i < module->childCount; i++) {
+
+        ASTNode* statement = module->children[i];
+
+        if(statement->type != Declaration) continue;
+
+        if(statement->DN_INITIALIZER != 0 && (error = Interpreter_evaluate(
+            interpreter, statement->DN_INITIALIZER, 0, &interpreter->globals[slot])) != 0) return error;
+
+        slot++;
+    }
+
+    for(int i = 0; i < module->childCount; i++) {
+
+        if(module->children[i]->type == Declaration) continue;
+
+        if((error = Interpreter_evaluate(interpreter, module->children[i], 0, &result)) != 0) return error;
+    }
+
+    fflush(stdout);
+
+    return 0;
+}
+
+void Interpreter_cleanUp(Interpreter* interpreter) {
+
+    free(interpreter->globals);
+}
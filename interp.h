@@ -0,0 +1,28 @@
+#ifndef INTERP_H
+#define INTERP_H
+
+#include "ast.h"
+#include "builtins.h"
+
+struct Jit_s;
+
+typedef struct Interpreter_s {
+    ASTNode* module;
+    struct Jit_s* jit;
+    Value* globals;
+    int globalCount;
+    int depth;
+    int maxDepth;
+} Interpreter;
+
+char* Interpreter_init(Interpreter* interpreter, ASTNode* module);
+
+char* Interpreter_run(Interpreter* interpreter);
+
+char* Interpreter_evaluate(Interpreter* interpreter, ASTNode* node, Value* frame, Value* result);
+
+char* Interpreter_call(Interpreter* interpreter, ASTNode* lambda, Value* args, int argc, Value* result);
+
+void Interpreter_cleanUp(Interpreter* interpreter);
+
+#endif //INTERP_H
@@ -0,0 +1,627 @@
+#include "jit.h"
+#include "vec.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) && defined(__linux__)
+#include <sys/mman.h>
+#include <unistd.h>
+#define JIT_SUPPORTED 1
+#else
+#define JIT_SUPPORTED 0
+#endif
+
+#define REG_RAX 0
+#define REG_RCX 1
+#define REG_RDX 2
+#define REG_RBP 5
+#define REG_RSI 6
+#define REG_RDI 7
+#define REG_R8  8
+#define REG_R9  9
+#define REG_R11 11
+
+#define JIT_STACK_BYTES (1 << 20)
+#define JIT_TARGET_OVERFLOW -1
+
+typedef int (*JitTrampoline)(void* code, int* args);
+
+//System V argument registers in parameter order
+static const int JitArgumentRegisters[JIT_MAX_PARAMS] = { REG_RDI, REG_RSI, REG_RDX, REG_RCX, REG_R8, REG_R9 };
+
+typedef struct JitFixup_s {
+    size_t position;
+    int target;
+} JitFixup;
+
+typedef unsigned char Byte;
+
+VEC_DECLARE(Byte)
+VEC_DECLARE(JitFixup)
+
+typedef struct JitBuffer_s {
+    VEC(Byte) bytes;
+    size_t overflowStub;
+    VEC(JitFixup) fixups;
+    int failed;
+} JitBuffer;
+
+//An operand is either a register or the stack slot a parameter was spilled to
+typedef struct JitOperand_s {
+    int isSlot;
+    int index;
+} JitOperand;
+
+void JitBuffer_emit(JitBuffer* buffer, const unsigned char* bytes, size_t count) {
+
+    if(buffer->failed) return;
+
+    if(Vec_Byte_append(&buffer->bytes, bytes, count) != 0) buffer->failed = 1;
+}
+
+void JitBuffer_emitByte(JitBuffer* buffer, unsigned char byte) {
+
+    JitBuffer_emit(buffer, &byte, 1);
+}
+
+void JitBuffer_emitInt(JitBuffer* buffer, int value) {
+
+    unsigned char bytes[4] = {
+        (unsigned char)value, (unsigned char)(value >> 8), (unsigned char)(value >> 16), (unsigned char)(value >> 24)
+    };
+
+    JitBuffer_emit(buffer, bytes, 4);
+}
+
+//Emits a 32-bit operation in the ModRM form, with reg in the reg field and
+//the operand in the r/m field
+void JitBuffer_emitModRM(JitBuffer* buffer, const unsigned char* opcode, size_t opcodeLength, int reg, JitOperand operand) {
+
+    int rm = operand.isSlot ? REG_RBP : operand.index;
+    unsigned char rex = 0x40 | ((reg >> 3) << 2) | (rm >> 3);
+
+    if(rex != 0x40) JitBuffer_emitByte(buffer, rex);
+
+    JitBuffer_emit(buffer, opcode, opcodeLength);
+
+    if(operand.isSlot) {
+
+        JitBuffer_emitByte(buffer, 0x40 | ((reg & 7) << 3) | REG_RBP);
+        JitBuffer_emitByte(buffer, (unsigned char)(-8 * (operand.index + 1)));
+    } else {
+
+        JitBuffer_emitByte(buffer, 0xc0 | ((reg & 7) << 3) | (rm & 7));
+    }
+}
+
+void JitBuffer_emitPointer(JitBuffer* buffer, void* pointer) {
+
+    size_t value = (size_t)pointer;
+
+    JitBuffer_emitInt(buffer, (int)value);
+    JitBuffer_emitInt(buffer, (int)(value >> 32));
+}
+
+//Emits a rel32 displacement to a lambda or the overflow stub, patched once
+//every lambda has been placed
+void JitBuffer_emitTarget(JitBuffer* buffer, int target) {
+
+    if(buffer->failed) return;
+
+    if(Vec_JitFixup_add(&buffer->fixups, (JitFixup){ buffer->bytes.count, target }) != 0) {
+
+        buffer->failed = 1;
+
+        return;
+    }
+
+    JitBuffer_emitInt(buffer, 0);
+}
+
+void JitBuffer_emitCall(JitBuffer* buffer, int target) {
+
+    JitBuffer_emitByte(buffer, 0xe8);
+    JitBuffer_emitTarget(buffer, target);
+}
+
+void JitBuffer_emitPop(JitBuffer* buffer, int reg) {
+
+    if(reg >= 8) JitBuffer_emitByte(buffer, 0x41);
+
+    JitBuffer_emitByte(buffer, 0x58 | (reg & 7));
+}
+
+//The trampoline takes the entry point and six argument slots, records where
+//the stack was and arms the limit. The overflow stub unwinds straight back to
+//the trampoline's caller, leaving overflowed set
+void Jit_compileTrampoline(Jit* jit, JitBuffer* buffer) {
+
+    static const unsigned char enter[] = {
+        0x55,                                   //push rbp
+        0x48, 0x89, 0x20,                       //mov [rax], rsp
+        0x48, 0xc7, 0x40, 0x10, 0, 0, 0, 0,     //mov qword [rax + 16], 0
+        0x4c, 0x8d, 0x9c, 0x24                  //lea r11, [rsp - JIT_STACK_BYTES]
+    };
+    static const unsigned char load_args[] = {
+        0x4c, 0x89, 0x58, 0x08,                 //mov [rax + 8], r11
+        0x48, 0x89, 0xf8,                       //mov rax, rdi
+        0x49, 0x89, 0xf3,                       //mov r11, rsi
+        0x41, 0x8b, 0x3b,                       //mov edi, [r11]
+        0x41, 0x8b, 0x73, 0x04,                 //mov esi, [r11 + 4]
+        0x41, 0x8b, 0x53, 0x08,                 //mov edx, [r11 + 8]
+        0x41, 0x8b, 0x4b, 0x0c,                 //mov ecx, [r11 + 12]
+        0x45, 0x8b, 0x43, 0x10,                 //mov r8d, [r11 + 16]
+        0x45, 0x8b, 0x4b, 0x14,                 //mov r9d, [r11 + 20]
+        0xff, 0xd0                              //call rax
+    };
+    static const unsigned char disarm[] = {
+        0x49, 0xc7, 0x43, 0x08, 0, 0, 0, 0,     //mov qword [r11 + 8], 0
+        0x5d,                                   //pop rbp
+        0xc3                                    //ret
+    };
+    static const unsigned char unwind[] = {
+        0x48, 0x8b, 0x20,                       //mov rsp, [rax]
+        0x48, 0xc7, 0x40, 0x10, 1, 0, 0, 0      //mov qword [rax + 16], 1
+    };
+
+    jit->trampolineOffset = (long)buffer->bytes.count;
+
+    JitBuffer_emitByte(buffer, 0x48);           //mov rax, state
+    JitBuffer_emitByte(buffer, 0xb8);
+    JitBuffer_emitPointer(buffer, jit->state);
+    JitBuffer_emit(buffer, enter, sizeof(enter));
+    JitBuffer_emitInt(buffer, -JIT_STACK_BYTES);
+    JitBuffer_emit(buffer, load_args, sizeof(load_args));
+    JitBuffer_emitByte(buffer, 0x49);           //mov r11, state
+    JitBuffer_emitByte(buffer, 0xbb);
+    JitBuffer_emitPointer(buffer, jit->state);
+    JitBuffer_emit(buffer, disarm, sizeof(disarm));
+
+    buffer->overflowStub = buffer->bytes.count;
+
+    JitBuffer_emitByte(buffer, 0x48);           //mov rax, state
+    JitBuffer_emitByte(buffer, 0xb8);
+    JitBuffer_emitPointer(buffer, jit->state);
+    JitBuffer_emit(buffer, unwind, sizeof(unwind));
+    JitBuffer_emitByte(buffer, 0x49);           //mov r11, rax
+    JitBuffer_emitByte(buffer, 0x89);
+    JitBuffer_emitByte(buffer, 0xc3);
+    JitBuffer_emit(buffer, disarm, sizeof(disarm));
+}
+
+JitLambda* Jit_findGlobalLambda(Jit* jit, ASTNode* symbol) {
+
+    if(symbol->type != Symbol || symbol->SN_KIND != (void*)SymbolGlobal) return 0;
+
+    size_t slot = (size_t)symbol->SN_SLOT;
+
+    if(slot >= (size_t)jit->lambdaCount || jit->lambdas[slot].lambda == 0) return 0;
+
+    return &jit->lambdas[slot];
+}
+
+//Anything that could produce a non-integer, reach a builtin or trap on
+//division is left to the interpreter
+int Jit_canCompile(Jit* jit, ASTNode* node) {
+
+    JitLambda* callee;
+
+    switch(node->type) {
+
+        case NumberLiteral:
+            return 1;
+
+        case Symbol:
+            return node->SN_KIND == (void*)SymbolParameter;
+
+        case Operator:
+            if((ASTOperatorType)(size_t)node->ON_OPERATOR == OpInvalid) return 0;
+
+            if(
+                (ASTOperatorType)(size_t)node->ON_OPERATOR == OpDivide &&
+                (node->ON_RIGHT_EXPR->type != NumberLiteral || (int)(long)node->ON_RIGHT_EXPR->NLN_NUMBER == 0)
+            ) return 0;
+
+            return Jit_canCompile(jit, node->ON_LEFT_EXPR) && Jit_canCompile(jit, node->ON_RIGHT_EXPR);
+
+        case Invocation:
+            callee = Jit_findGlobalLambda(jit, node->IN_SYMBOL);
+
+            if(callee == 0 || callee->offset < 0 || callee->paramCount != node->IN_ARGS->childCount) return 0;
+
+            for(int i = 0; i < node->IN_ARGS->childCount; i++) {
+
+                if(!Jit_canCompile(jit, node->IN_ARGS->children[i])) return 0;
+            }
+
+            return 1;
+
+        default:
+            return 0;
+    }
+}
+
+int Jit_needsFrame(ASTNode* node) {
+
+    if(node->type == Invocation) return 1;
+
+    if(node->type == Operator && (ASTOperatorType)(size_t)node->ON_OPERATOR == OpDivide) return 1;
+
+    for(int i = 0; i < node->childCount; i++) {
+
+        if(node->children[i] != 0 && Jit_needsFrame(node->children[i])) return 1;
+    }
+
+    return 0;
+}
+
+JitOperand Jit_parameterOperand(ASTNode* symbol, int framed) {
+
+    int index = (int)(size_t)symbol->SN_SLOT;
+    JitOperand operand = { framed, framed ? index : JitArgumentRegisters[index] };
+
+    return operand;
+}
+
+//Leaves the value of node in eax
+void Jit_compileExpression(Jit* jit, JitBuffer* buffer, ASTNode* node, int framed) {
+
+    static const unsigned char mov_load[] = { 0x8b };
+    static const unsigned char mov_store[] = { 0x89 };
+    static const unsigned char add[] = { 0x03 };
+    static const unsigned char sub[] = { 0x2b };
+    static const unsigned char imul[] = { 0x0f, 0xaf };
+    static const unsigned char group3[] = { 0xf7 };
+    JitOperand eax = { 0, REG_RAX };
+    JitOperand r11 = { 0, REG_R11 };
+    ASTNode* right;
+    int immediate;
+
+    switch(node->type) {
+
+        case NumberLiteral:
+            JitBuffer_emitByte(buffer, 0xb8);
+            JitBuffer_emitInt(buffer, (int)(long)node->NLN_NUMBER);
+
+            return;
+
+        case Symbol:
+            JitBuffer_emitModRM(buffer, mov_load, 1, REG_RAX, Jit_parameterOperand(node, framed));
+
+            return;
+
+        case Operator:
+            right = node->ON_RIGHT_EXPR;
+
+            Jit_compileExpression(jit, buffer, node->ON_LEFT_EXPR, framed);
+
+            if((ASTOperatorType)(size_t)node->ON_OPERATOR == OpDivide) {
+
+                immediate = (int)(long)right->NLN_NUMBER;
+
+                //Matches the interpreter's wrapping result for INT_MIN / -1 instead of trapping
+                if(immediate == -1) {
+
+                    JitBuffer_emitModRM(buffer, group3, 1, 3, eax);
+
+                    return;
+                }
+
+                JitBuffer_emitByte(buffer, 0x41);
+                JitBuffer_emitByte(buffer, 0xb8 | (REG_R11 & 7));
+                JitBuffer_emitInt(buffer, immediate);
+                JitBuffer_emitByte(buffer, 0x99);
+                JitBuffer_emitModRM(buffer, group3, 1, 7, r11);
+
+                return;
+            }
+
+            if(right->type == NumberLiteral) {
+
+                immediate = (int)(long)right->NLN_NUMBER;
+
+                switch((ASTOperatorType)(size_t)node->ON_OPERATOR) {
+
+                    case OpAdd: JitBuffer_emitByte(buffer, 0x05); break;
+                    case OpSubtract: JitBuffer_emitByte(buffer, 0x2d); break;
+                    default: JitBuffer_emitByte(buffer, 0x69); JitBuffer_emitByte(buffer, 0xc0); break;
+                }
+
+                JitBuffer_emitInt(buffer, immediate);
+
+                return;
+            }
+
+            JitOperand operand;
+
+            if(right->type == Symbol) {
+
+                operand = Jit_parameterOperand(right, framed);
+            } else {
+
+                JitBuffer_emitByte(buffer, 0x50);
+                Jit_compileExpression(jit, buffer, right, framed);
+                JitBuffer_emitModRM(buffer, mov_store, 1, REG_RAX, r11);
+                JitBuffer_emitByte(buffer, 0x58);
+
+                operand = r11;
+            }
+
+            switch((ASTOperatorType)(size_t)node->ON_OPERATOR) {
+
+                case OpAdd: JitBuffer_emitModRM(buffer, add, 1, REG_RAX, operand); break;
+                case OpSubtract: JitBuffer_emitModRM(buffer, sub, 1, REG_RAX, operand); break;
+                default: JitBuffer_emitModRM(buffer, imul, 2, REG_RAX, operand); break;
+            }
+
+            return;
+
+        case Invocation:
+            //Arguments go through the stack so evaluating one can't clobber another
+            for(int i = 0; i < node->IN_ARGS->childCount; i++) {
+
+                Jit_compileExpression(jit, buffer, node->IN_ARGS->children[i], framed);
+                JitBuffer_emitByte(buffer, 0x50);
+            }
+
+            for(int i = (int)node->IN_ARGS->childCount - 1; i >= 0; i--) {
+
+                JitBuffer_emitPop(buffer, JitArgumentRegisters[i]);
+            }
+
+            JitBuffer_emitCall(buffer, (int)(size_t)node->IN_SYMBOL->SN_SLOT);
+
+            return;
+
+        default:
+            buffer->failed = 1;
+
+            return;
+    }
+}
+
+//Leaf lambdas read their parameters straight from the argument registers.
+//Lambdas that call or divide spill them to the frame first since both clobber
+//argument registers, and check the stack limit since only they can recurse.
+//Generated code never calls into C, so it doesn't keep the stack 16-byte aligned
+void Jit_compileLambda(Jit* jit, JitBuffer* buffer, JitLambda* entry) {
+
+    static const unsigned char mov_store[] = { 0x89 };
+    static const unsigned char prologue[] = { 0x55, 0x48, 0x89, 0xe5, 0x48, 0x83, 0xec };
+    static const unsigned char check_limit[] = { 0x49, 0x3b, 0x23, 0x0f, 0x82 };
+    int framed = Jit_needsFrame(entry->lambda->LN_EXPR);
+
+    entry->offset = (long)buffer->bytes.count;
+
+    if(framed) {
+
+        //mov r11, &stackLimit; cmp rsp, [r11]; jb overflow
+        JitBuffer_emitByte(buffer, 0x49);
+        JitBuffer_emitByte(buffer, 0xbb);
+        JitBuffer_emitPointer(buffer, &jit->state->stackLimit);
+        JitBuffer_emit(buffer, check_limit, sizeof(check_limit));
+        JitBuffer_emitTarget(buffer, JIT_TARGET_OVERFLOW);
+
+        JitBuffer_emit(buffer, prologue, sizeof(prologue));
+        JitBuffer_emitByte(buffer, (unsigned char)(((entry->paramCount * 8) + 15) & ~15));
+
+        for(int i = 0; i < entry->paramCount; i++) {
+
+            JitOperand slot = { 1, i };
+
+            JitBuffer_emitModRM(buffer, mov_store, 1, JitArgumentRegisters[i], slot);
+        }
+    }
+
+    Jit_compileExpression(jit, buffer, entry->lambda->LN_EXPR, framed);
+
+    if(framed) JitBuffer_emitByte(buffer, 0xc9);
+
+    JitBuffer_emitByte(buffer, 0xc3);
+}
+
+char* Jit_init(Jit* jit, ASTNode* module) {
+
+    char* error;
+    JitBuffer buffer = { 0 };
+    int changed = 1;
+
+    memset(jit, 0, sizeof(Jit));
+
+    if((error = Interpreter_init(&jit->interpreter, module)) != 0) return error;
+
+    if(!JIT_SUPPORTED) return "The JIT is only supported on x86-64 Linux";
+
+    jit->lambdaCount = jit->interpreter.globalCount;
+    jit->lambdas = (JitLambda*)calloc(jit->lambdaCount + 1, sizeof(JitLambda));
+
+    jit->state = (JitState*)calloc(1, sizeof(JitState));
+
+    if(jit->lambdas == 0 || jit->state == 0) return "Failed to allocate space for JIT lambdas";
+
+    for(int i = 0, slot = 0; i < module->childCount; i++) {
+
+        ASTNode* statement = module->children[i];
+
+        if(statement->type != Declaration) continue;
+
+        JitLambda* entry = &jit->lambdas[slot++];
+
+        entry->name = (String*)statement->DN_SYMBOL->SN_TEXT;
+        entry->offset = -1;
+
+        if(statement->DN_INITIALIZER == 0 || statement->DN_INITIALIZER->type != Lambda) continue;
+
+        entry->lambda = statement->DN_INITIALIZER;
+        entry->paramCount = entry->lambda->LN_PARAMS->childCount;
+
+        if(entry->paramCount <= JIT_MAX_PARAMS) entry->offset = 0;
+    }
+
+    //Start from every candidate and drop lambdas until the remaining set only calls itself
+    while(changed) {
+
+        changed = 0;
+
+        for(int i = 0; i < jit->lambdaCount; i++) {
+
+            JitLambda* entry = &jit->lambdas[i];
+
+            if(entry->offset < 0 || Jit_canCompile(jit, entry->lambda->LN_EXPR)) continue;
+
+            entry->offset = -1;
+            changed = 1;
+        }
+    }
+
+    for(int i = 0; i < jit->lambdaCount; i++) jit->compiledCount += jit->lambdas[i].offset >= 0;
+
+    if(jit->compiledCount == 0) return 0;
+
+    Jit_compileTrampoline(jit, &buffer);
+
+    for(int i = 0; i < jit->lambdaCount; i++) {
+
+        if(jit->lambdas[i].offset < 0) continue;
+
+        Jit_compileLambda(jit, &buffer, &jit->lambdas[i]);
+    }
+
+    if(buffer.failed) {
+
+        Vec_Byte_cleanUp(&buffer.bytes);
+        Vec_JitFixup_cleanUp(&buffer.fixups);
+
+        return "Failed to allocate space for JIT code";
+    }
+
+    for(int i = 0; i < buffer.fixups.count; i++) {
+
+        JitFixup* fixup = &buffer.fixups.data[i];
+        long target = fixup->target == JIT_TARGET_OVERFLOW ? (long)buffer.overflowStub : jit->lambdas[fixup->target].offset;
+        int displacement = (int)(target - (long)(fixup->position + 4));
+
+        memcpy(&buffer.bytes.data[fixup->position], &displacement, 4);
+    }
+
+    Vec_JitFixup_cleanUp(&buffer.fixups);
+
+#if JIT_SUPPORTED
+    //Pages are only ever writable or executable, never both
+    long page_size = sysconf(_SC_PAGESIZE);
+
+    jit->codeSize = (buffer.bytes.count + page_size - 1) & ~(size_t)(page_size - 1);
+    jit->code = (unsigned char*)mmap(0, jit->codeSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if(jit->code == MAP_FAILED) {
+
+        jit->code = 0;
+        Vec_Byte_cleanUp(&buffer.bytes);
+
+        return "Failed to map memory for JIT code";
+    }
+
+    memcpy(jit->code, buffer.bytes.data, buffer.bytes.count);
+    Vec_Byte_cleanUp(&buffer.bytes);
+
+    if(mprotect(jit->code, jit->codeSize, PROT_READ | PROT_EXEC) != 0) return "Failed to make JIT code executable";
+#endif
+
+    for(int i = 0; i < jit->lambdaCount; i++) {
+
+        if(jit->lambdas[i].offset >= 0) jit->lambdas[i].lambda->LN_NATIVE = jit->code + jit->lambdas[i].offset;
+    }
+
+    jit->interpreter.jit = jit;
+
+    return 0;
+}
+
+JitLambda* Jit_findLambda(Jit* jit, char* name) {
+
+    size_t length = strlen(name);
+
+    for(int i = 0; i < jit->lambdaCount; i++) {
+
+        String* entry_name = jit->lambdas[i].name;
+
+        if(
+            jit->lambdas[i].lambda != 0 && entry_name->length == length &&
+            strncmp(entry_name->data, name, length) == 0
+        ) return &jit->lambdas[i];
+    }
+
+    return 0;
+}
+
+//Returns the native entry point, to be cast to the JitFunction type matching
+//paramCount, or 0 if the lambda doesn't exist or wasn't compiled. Calling it
+//directly skips the stack limit, so unbounded recursion overflows the stack
+//the same way the generated C does
+void* Jit_lookUp(Jit* jit, char* name, int* paramCount) {
+
+    JitLambda* entry = Jit_findLambda(jit, name);
+
+    if(entry == 0 || entry->offset < 0) return 0;
+
+    if(paramCount != 0) *paramCount = entry->paramCount;
+
+    return jit->code + entry->offset;
+}
+
+char* Jit_call(Jit* jit, char* name, int* args, int argc, int* result) {
+
+    char* error;
+    JitLambda* entry = Jit_findLambda(jit, name);
+    Value values[argc + 1];
+    Value value;
+
+    if(entry == 0) return "No lambda is declared with that name";
+
+    if(entry->paramCount != argc) return "Wrong number of arguments in lambda invocation";
+
+    if(entry->offset >= 0) return Jit_invoke(jit, jit->code + entry->offset, args, argc, result);
+
+    for(int i = 0; i < argc; i++) {
+
+        values[i].type = ValueInt;
+        values[i].integer = args[i];
+    }
+
+    if((error = Interpreter_call(&jit->interpreter, entry->lambda, values, argc, &value)) != 0) return error;
+
+    if(value.type != ValueInt) return "Lambda did not return an integer";
+
+    *result = value.integer;
+
+    return 0;
+}
+
+char* Jit_invoke(Jit* jit, void* code, int* args, int argc, int* result) {
+
+    int slots[JIT_MAX_PARAMS] = { 0 };
+
+    for(int i = 0; i < argc && i < JIT_MAX_PARAMS; i++) slots[i] = args[i];
+
+    *result = ((JitTrampoline)(jit->code + jit->trampolineOffset))(code, slots);
+
+    if(jit->state->overflowed) return "Maximum recursion depth exceeded";
+
+    return 0;
+}
+
+void Jit_cleanUp(Jit* jit) {
+
+    for(int i = 0; i < jit->lambdaCount; i++) {
+
+        if(jit->lambdas[i].lambda != 0) jit->lambdas[i].lambda->LN_NATIVE = 0;
+    }
+
+#if JIT_SUPPORTED
+    if(jit->code != 0) munmap(jit->code, jit->codeSize);
+#endif
+
+    free(jit->lambdas);
+    free(jit->state);
+    Interpreter_cleanUp(&jit->interpreter);
+}
@@ -0,0 +1,64 @@
+#ifndef JIT_H
+#define JIT_H
+
+#include "ast.h"
+#include "interp.h"
+#include <stddef.h>
+
+#define JIT_MAX_PARAMS 6
+
+typedef int (*JitFunction0)(void);
+typedef int (*JitFunction1)(int);
+typedef int (*JitFunction2)(int, int);
+typedef int (*JitFunction3)(int, int, int);
+typedef int (*JitFunction4)(int, int, int, int);
+typedef int (*JitFunction5)(int, int, int, int, int);
+typedef int (*JitFunction6)(int, int, int, int, int, int);
+
+//Native recursion is bounded by a stack limit that only applies to calls made
+//through Jit_call or the interpreter, which enter through a trampoline that
+//can unwind back to the caller when the limit is hit
+typedef struct JitState_s {
+    void* savedStack;
+    void* stackLimit;
+    long overflowed;
+} JitState;
+
+typedef struct JitLambda_s {
+    String* name;
+    ASTNode* lambda;
+    int paramCount;
+    long offset;
+} JitLambda;
+
+//Lambdas bound to globals whose bodies only do integer arithmetic and call
+//other such lambdas are compiled to native code, everything else is left to
+//the interpreter. An offset of -1 marks a lambda that was not compiled
+typedef struct Jit_s {
+    Interpreter interpreter;
+    JitState* state;
+    JitLambda* lambdas;
+    int lambdaCount;
+    int compiledCount;
+    unsigned char* code;
+    size_t codeSize;
+    long trampolineOffset;
+} Jit;
+
+char* Jit_init(Jit* jit, ASTNode* module);
+
+JitLambda* Jit_findLambda(Jit* jit, char* name);
+
+//Leaf lambdas read their parameters straight from registers, anything that
+//calls or divides spills them to a frame and checks the stack limit
+int Jit_needsFrame(ASTNode* node);
+
+void* Jit_lookUp(Jit* jit, char* name, int* paramCount);
+
+char* Jit_call(Jit* jit, char* name, int* args, int argc, int* result);
+
+char* Jit_invoke(Jit* jit, void* code, int* args, int argc, int* result);
+
+void Jit_cleanUp(Jit* jit);
+
+#endif //JIT_H
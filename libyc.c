@@ -0,0 +1,117 @@
+#include "libyc.h"
+#include "parsecache.h"
+#include "resolve.h"
+#include "ctemplate.h"
+#include "asmtemplate.h"
+#include <pthread.h>
+#include <string.h>
+
+static pthread_once_t yc_init_once = PTHREAD_ONCE_INIT;
+static char* yc_init_error = 0;
+
+void Yc_compileTemplates() {
+
+    if((yc_init_error = TemplateConfig_compileAll(&CTemplateConfig)) != 0) return;
+
+    yc_init_error = TemplateConfig_compileAll(&AsmTemplateConfig);
+}
+
+//Templates are compiled lazily on first use everywhere else, which would race
+//between threads, so the library compiles them all exactly once up front
+char* Yc_init() {
+
+    pthread_once(&yc_init_once, Yc_compileTemplates);
+
+    return yc_init_error;
+}
+
+char* YcContext_init(YcContext* context, int opt_level, int assembly) {
+
+    char* error;
+
+    if((error = Yc_init()) != 0) return error;
+
+    context->passContext = (PassContext){ { 100000, 64 }, { 4 }, { 0, 1 << 20, 0 } };
+    context->passContext.memoize.automatic = opt_level >= 2;
+    context->templateConfig = assembly ? &AsmTemplateConfig : &CTemplateConfig;
+    context->labels = (TemplateLabelTable){ 0, 0, 0, 0 };
+
+    PassManager_init(&context->passManager);
+
+    if((context->output = String_new(0)) == 0) return "Unable to allocate memory for compiler output";
+
+    if((error = PassManager_usePreset(&context->passManager, opt_level)) != 0 ||
+        (context->passContext.memoize.automatic && (error = PassManager_addPass(&context->passManager, "memoize")) != 0)) {
+
+        YcContext_cleanUp(context);
+
+        return error;
+    }
+
+    return 0;
+}
+
+//Leaves the rendered module in context->output until the next render
+char* YcContext_render(YcContext* context, char* source, size_t source_length) {
+
+    char* error;
+    ASTNode* module = 0;
+    Template* template;
+    PassStats resolve_stats = { 0, 0 };
+    ParseOptions parse_options = { 0, 1 };
+
+    context->output->length = 0;
+
+    if((error = ParseCache_parseSource(source, source_length, &parse_options, &module)) != 0) {
+
+        if(module != 0) ASTNode_cleanUp(module);
+
+        return error;
+    }
+
+    context->passManager.validAnalyses.count = 0;
+
+    error = PassManager_run(&context->passManager, module, &context->passContext);
+
+    if(error == 0 && context->templateConfig == &AsmTemplateConfig) error = Module_resolveSymbols(module, &resolve_stats);
+
+    if(error == 0) error = Template_getCompiled(context->templateConfig,
+        StrView_fromCString(context->templateConfig->baseTemplateName[Module]), &template);
+
+    if(error == 0) error = Template_renderCompiledInto(template, module, context->output, &context->labels);
+
+    ASTNode_cleanUp(module);
+
+    return error;
+}
+
+//Writes the rendered module and a terminating zero to out_buffer. When it
+//does not fit, out_length still reports how many characters it needs
+char* YcContext_compile(YcContext* context, char* source, size_t source_length,
+    char* out_buffer, size_t out_capacity, size_t* out_length) {
+
+    char* error;
+
+    *out_length = 0;
+
+    if((error = YcContext_render(context, source, source_length)) != 0) return error;
+
+    *out_length = context->output->length;
+
+    if(out_capacity < *out_length + 1) return "Output buffer is too small for the compiled module";
+
+    memcpy(out_buffer, context->output->data, *out_length);
+    out_buffer[*out_length] = 0;
+
+    return 0;
+}
+
+void YcContext_cleanUp(YcContext* context) {
+
+    PassManager_cleanUp(&context->passManager);
+    TemplateLabelTable_cleanUp(&context->labels);
+
+    if(context->output != 0) String_cleanUp(context->output);
+
+    context->output = 0;
+}
@@ -0,0 +1,36 @@
+#ifndef LIBYC_H
+#define LIBYC_H
+
+#include "ast.h"
+#include "pass.h"
+#include "template.h"
+#include "string.h"
+#include <stddef.h>
+
+//Everything one compilation needs lives in its context, so each thread can
+//own a context and compile independently. Compiled templates are shared and
+//are only read once Yc_init has run
+typedef struct YcContext_s {
+    PassManager passManager;
+    PassContext passContext;
+    TemplateConfig* templateConfig;
+    TemplateLabelTable labels;
+    String* output;
+} YcContext;
+
+//Defined once in the library, see ctemplate.h and asmtemplate.h
+extern TemplateConfig CTemplateConfig;
+extern TemplateConfig AsmTemplateConfig;
+
+char* Yc_init();
+
+char* YcContext_init(YcContext* context, int opt_level, int assembly);
+
+char* YcContext_render(YcContext* context, char* source, size_t source_length);
+
+char* YcContext_compile(YcContext* context, char* source, size_t source_length,
+    char* out_buffer, size_t out_capacity, size_t* out_length);
+
+void YcContext_cleanUp(YcContext* context);
+
+#endif //LIBYC_H
@@ -5,23 +5,73 @@
 #include "ast.h"
 #include "parse.h"
 #include "template.h"
-#include "ctemplate.h"
+#include "pass.h"
+#include "callgraph.h"
+#include "interp.h"
+#include "bytecode.h"
+#include "jit.h"
+#include "libyc.h"
+#include "resolve.h"
+#include "run.h"
+#include "parsecache.h"
+#include "server.h"
+#include "batch.h"
+#include "split.h"
+#include "stream.h"
 
 #define MODE_WRITE_C  0
 #define MODE_DUMP_AST 1
+#define MODE_RUN      2
+#define MODE_BYTECODE 3
+#define MODE_DISASSEMBLE 4
+#define MODE_JIT      5
+#define MODE_EXECUTE  6
 
-int main(int argc, char* argv[]) {
+#define SERVER_DEFAULT_WORKERS 4
+#define SERVER_PARSE_CACHE_ENTRIES 64
+
+int Driver_run(int argc, char* argv[]) {
 
     if(argc < 2) {
 
-        printf("Usage: yc <in_file.y> [-o out_file | -t out_file.c]\n");
+        printf("Usage: yc --serve=socket [--workers=n]\n"
+            "       yc --client=socket <normal arguments>\n"
+            "       yc <in_file.y | @response_file>... [-d out_dir] [--threads=n] [-S] [-O0 | -O1 | -O2]\n"
+            "       yc <in_file.y | -> [-o out_file | -t out_file.c] [-S | --split=n | --split=each | --stream [--spill-bytes=n]] [-a | -r | -b | -B | -j | -x] [-O0 | -O1 | -O2] [--passes=name,...]\n"
+            "          [--lazy | --parse-threads=n] [--parse-stats] [--pass-stats] [-m] [--memoize=name,...] [--memo-bytes=n] [--eval-steps=n]\n"
+            "          [--eval-depth=n] [--spec-limit=n] [--callgraph=out.dot | --callgraph=out.json]\n"
+            "          [--cc=compiler] [--cflags=flags] [--cache-dir=dir] [--no-cache] [-- program args...]\n");
 
         return 0;
     }
 
     int mode = MODE_WRITE_C;
     char* in_name = 0;
-    char* out_name = "out.c";
+    char* out_name = 0;
+    TemplateConfig* template_config = &CTemplateConfig;
+    RunOptions run_options;
+    int program_argc = 0;
+    char** program_argv = 0;
+    int exit_status = 0;
+    char* error_message;
+    char* callgraph_name = 0;
+    int opt_level = 0;
+    char* pass_names = 0;
+    VEC(CharPtr) inputs;
+    BatchOptions batch_options = { 0, 0, 0, 0 };
+    int batch = 0;
+    int split_count = 0;
+    int stream = 0;
+    ParseOptions parse_options = { 0, 1 };
+    ParseStats parse_stats = { 0 };
+    size_t spill_bytes = STREAM_DEFAULT_SPILL_BYTES;
+    int failed_count;
+    PassManager pass_manager;
+    PassContext pass_context = { { 100000, 64 }, { 4 }, { 0, 1 << 20, 0 } };
+
+    PassManager_init(&pass_manager);
+    RunOptions_init(&run_options);
+    Vec_CharPtr_init(&inputs, 0);
 
     for(int i = 1; i < argc; i++) {
 
@@ -39,9 +89,254 @@ int main(int argc, char* argv[]) {
             continue;
         }
 
-        in_name = argv[i];
+        if(strcmp(argv[i], "-r") == 0) {
+
+            mode = MODE_RUN;
+
+            continue;
+        }
+
+        if(strcmp(argv[i], "-b") == 0) {
+
+            mode = MODE_BYTECODE;
+
+            continue;
+        }
+
+        if(strcmp(argv[i], "--") == 0) {
+
+            program_argc = argc - i - 1;
+            program_argv = &argv[i + 1];
+
+            break;
+        }
+
+        if(strcmp(argv[i], "-x") == 0) {
+
+            mode = MODE_EXECUTE;
+
+            continue;
+        }
+
+        if(strncmp(argv[i], "--cc=", strlen("--cc=")) == 0) {
+
+            run_options.compiler = &argv[i][strlen("--cc=")];
+
+            continue;
+        }
+
+        if(strncmp(argv[i], "--cflags=", strlen("--cflags=")) == 0) {
+
+            run_options.flags = &argv[i][strlen("--cflags=")];
+
+            continue;
+        }
+
+        if(strncmp(argv[i], "--cache-dir=", strlen("--cache-dir=")) == 0) {
+
+            run_options.cacheDir = &argv[i][strlen("--cache-dir=")];
+
+            continue;
+        }
+
+        if(strcmp(argv[i], "--no-cache") == 0) {
+
+            run_options.useCache = 0;
+
+            continue;
+        }
+
+        if(strcmp(argv[i], "-S") == 0) {
+
+            template_config = &AsmTemplateConfig;
+
+            continue;
+        }
+
+        if(strcmp(argv[i], "-j") == 0) {
+
+            mode = MODE_JIT;
+
+            continue;
+        }
+
+        if(strcmp(argv[i], "-B") == 0) {
+
+            mode = MODE_DISASSEMBLE;
+
+            continue;
+        }
+
+        if(argv[i][0] == '-' && argv[i][1] == 'O' && argv[i][2] != 0 && argv[i][3] == 0) {
+
+            opt_level = argv[i][2] - '0';
+
+            continue;
+        }
+
+        if(strncmp(argv[i], "--passes=", strlen("--passes=")) == 0) {
+
+            pass_names = &argv[i][strlen("--passes=")];
+
+            continue;
+        }
+
+        if(strcmp(argv[i], "--parse-stats") == 0) {
+
+            parse_options.stats = &parse_stats;
+
+            continue;
+        }
+
+        if(strcmp(argv[i], "--pass-stats") == 0) {
+
+            pass_manager.printStats = 1;
+
+            continue;
+        }
+
+        if(strncmp(argv[i], "--callgraph=", strlen("--callgraph=")) == 0) {
+
+            callgraph_name = &argv[i][strlen("--callgraph=")];
+
+            continue;
+        }
+
+        if(strcmp(argv[i], "-m") == 0) {
+
+            pass_context.memoize.automatic = 1;
+
+            continue;
+        }
+
+        if(strncmp(argv[i], "--memoize=", strlen("--memoize=")) == 0) {
+
+            pass_context.memoize.names = &argv[i][strlen("--memoize=")];
+
+            continue;
+        }
+
+        if(strncmp(argv[i], "--memo-bytes=", strlen("--memo-bytes=")) == 0) {
+
+            pass_context.memoize.tableBytes = strtoull(&argv[i][strlen("--memo-bytes=")], 0, 0);
+
+            continue;
+        }
+
+        if(strncmp(argv[i], "--eval-steps=", strlen("--eval-steps=")) == 0) {
+
+            pass_context.fold.maxSteps = strtol(&argv[i][strlen("--eval-steps=")], 0, 0);
+
+            continue;
+        }
+
+        if(strncmp(argv[i], "--eval-depth=", strlen("--eval-depth=")) == 0) {
+
+            pass_context.fold.maxDepth = strtol(&argv[i][strlen("--eval-depth=")], 0, 0);
+
+            continue;
+        }
+
+        if(strncmp(argv[i], "--spec-limit=", strlen("--spec-limit=")) == 0) {
+
+            pass_context.specialize.maxClones = strtol(&argv[i][strlen("--spec-limit=")], 0, 0);
+
+            continue;
+        }
+
+        if(argc >= (i + 2) && strcmp(argv[i], "-d") == 0) {
+
+            batch_options.outDir = argv[++i];
+            batch = 1;
+
+            continue;
+        }
+
+        if(strcmp(argv[i], "--stream") == 0) {
+
+            stream = 1;
+
+            continue;
+        }
+
+        if(strcmp(argv[i], "--lazy") == 0) {
+
+            parse_options.lazy = 1;
+
+            continue;
+        }
+
+        if(strncmp(argv[i], "--parse-threads=", strlen("--parse-threads=")) == 0) {
+
+            parse_options.threadCount = strtol(&argv[i][strlen("--parse-threads=")], 0, 0);
+
+            continue;
+        }
+
+        if(strncmp(argv[i], "--spill-bytes=", strlen("--spill-bytes=")) == 0) {
+
+            spill_bytes = strtoull(&argv[i][strlen("--spill-bytes=")], 0, 0);
+
+            continue;
+        }
+
+        if(strncmp(argv[i], "--split=", strlen("--split=")) == 0) {
+
+            split_count = strcmp(&argv[i][strlen("--split=")], "each") == 0
+                ? SPLIT_EACH
+                : strtol(&argv[i][strlen("--split=")], 0, 0);
+
+            continue;
+        }
+
+        if(strncmp(argv[i], "--threads=", strlen("--threads=")) == 0) {
+
+            batch_options.threadCount = strtol(&argv[i][strlen("--threads=")], 0, 0);
+
+            continue;
+        }
+
+        if(argv[i][0] == '@') batch = 1;
+
+        if((error_message = Batch_addInput(&inputs, argv[i])) != 0) {
+
+            printf("Invalid input %s: %s\n", argv[i], error_message);
+
+            PassManager_cleanUp(&pass_manager);
+            Vec_CharPtr_cleanUp(&inputs);
+
+            return 1;
+        }
+    }
+
+    //Several inputs, a response file or an output directory compile every
+    //input to its own output file on a pool of threads
+    if(batch || inputs.count > 1) {
+
+        batch_options.optLevel = opt_level;
+        batch_options.assembly = template_config == &AsmTemplateConfig;
+
+        error_message = mode != MODE_WRITE_C || out_name != 0 || pass_names != 0
+            ? "Batch compilation only writes output files and takes -O levels"
+            : Batch_run(&inputs, &batch_options, &failed_count);
+
+        PassManager_cleanUp(&pass_manager);
+        Vec_CharPtr_cleanUp(&inputs);
+
+        if(error_message != 0) {
+
+            printf("Batch compilation failed: %s\n", error_message);
+
+            return 1;
+        }
+
+        return failed_count != 0;
     }
 
+    in_name = inputs.count == 0 ? 0 : inputs.data[0];
+
+    Vec_CharPtr_cleanUp(&inputs);
+
     if(in_name == 0) {
 
         printf("No input file specified!");
@@ -49,30 +344,153 @@ int main(int argc, char* argv[]) {
         return 0;
     }
 
-    FILE* in_file = fopen(in_name, "r");
+    error_message = pass_names != 0
+        ? PassManager_usePipeline(&pass_manager, pass_names)
+        : PassManager_usePreset(&pass_manager, opt_level);
+
+    if(pass_names == 0 && opt_level >= 2) pass_context.memoize.automatic = 1;
+
+    if(
+        error_message == 0 &&
+        (pass_context.memoize.automatic || pass_context.memoize.names != 0) &&
+        !PassManager_hasPass(&pass_manager, "memoize")
+    ) error_message = PassManager_addPass(&pass_manager, "memoize");
+
+    if(error_message != 0) {
+
+        printf("Invalid optimization settings: %s\n", error_message);
+
+        PassManager_cleanUp(&pass_manager);
+
+        return 1;
+    }
+
+    //Streaming renders each statement as soon as it is parsed, which leaves no
+    //whole module for the optimization passes to work on
+    if(stream) {
+
+        FILE* in_file = fopen(in_name, "r");
+        FILE* out_file = 0;
+
+        if(mode != MODE_WRITE_C || template_config != &CTemplateConfig || split_count != 0 ||
+            pass_manager.pipeline.count != 0) {
+
+            error_message = "Streaming only writes unoptimized C to a single file";
+        } else if(in_file == 0) {
+
+            error_message = "Unable to open input file";
+        } else if((out_file = fopen(out_name == 0 ? "out.c" : out_name, "w")) == 0) {
+
+            error_message = "Unable to open output file";
+        } else {
+
+            error_message = Module_streamCompile(in_file, template_config, out_file, spill_bytes);
+        }
+
+        if(in_file != 0) fclose(in_file);
+        if(out_file != 0) fclose(out_file);
+
+        PassManager_cleanUp(&pass_manager);
+
+        if(error_message != 0) {
+
+            printf("Streaming compilation failed: %s\n", error_message);
+
+            return 1;
+        }
+
+        return 0;
+    }
+
+    FILE* in_file = strcmp(in_name, "-") == 0 ? stdin : fopen(in_name, "r");
 
     if(in_file == 0) {
 
         printf("Unable to open input file %s\n", in_name);
 
+        PassManager_cleanUp(&pass_manager);
+
         return 0;
     }
     
     ASTNode* module_ast;
-    Scanner scanner = NewScanner(in_file);
 
-    char* error_message = Module_tryParse(scanner, &module_ast, 0);
+    error_message = ParseCache_parse(in_file, &parse_options, &module_ast);
+
+    if(in_file != stdin) fclose(in_file);
+
+    if(parse_options.stats != 0) ParseStats_print(parse_options.stats);
 
     if(error_message) {
         
         printf("Compilation failed: %s\n", error_message);
 
         ASTNode_cleanUp(module_ast); 
+        PassManager_cleanUp(&pass_manager);
 
         return 1;
     }
 
-    if(mode == MODE_WRITE_C) {
+    error_message = PassManager_run(&pass_manager, module_ast, &pass_context);
+
+    PassManager_cleanUp(&pass_manager);
+
+    if(error_message != 0) {
+
+        printf("Optimization failed: %s\n", error_message);
+
+        ASTNode_cleanUp(module_ast);
+
+        return 1;
+    }
+
+    if(callgraph_name != 0) {
+
+        CallGraph graph;
+        FILE* callgraph_file = fopen(callgraph_name, "w");
+        size_t name_length = strlen(callgraph_name);
+        int json = name_length >= 5 && strcmp(&callgraph_name[name_length - 5], ".json") == 0;
+
+        if(callgraph_file == 0) {
+
+            printf("Unable to open call graph file %s\n", callgraph_name);
+        } else if((error_message = CallGraph_build(&graph, module_ast)) != 0) {
+
+            printf("Call graph construction failed: %s\n", error_message);
+            fclose(callgraph_file);
+        } else {
+
+            if((error_message = CallGraph_findSCCs(&graph)) == 0) {
+
+                error_message = json
+                    ? CallGraph_writeJson(&graph, callgraph_file)
+                    : CallGraph_writeDot(&graph, callgraph_file);
+            }
+
+            if(error_message != 0) printf("Writing call graph failed: %s\n", error_message);
+
+            CallGraph_cleanUp(&graph);
+            fclose(callgraph_file);
+        }
+    }
+
+    if(mode == MODE_WRITE_C && split_count != 0) {
+
+        if(out_name == 0) out_name = "out.c";
+
+        error_message = template_config == &AsmTemplateConfig
+            ? "Split output is only available for C"
+            : Module_writeSplit(module_ast, template_config, out_name, split_count);
+
+        if(error_message != 0)
+            printf("Writing out failed: %s\n", error_message);
+    }
+
+    if(mode == MODE_WRITE_C && split_count == 0) {
+
+        PassStats resolve_stats = { 0, 0 };
+
+        if(out_name == 0) out_name = template_config == &AsmTemplateConfig ? "out.s" : "out.c";
 
         //TODO: Actually parse command line args as described
         FILE* out_file = fopen(out_name, "w");
@@ -86,7 +504,11 @@ int main(int argc, char* argv[]) {
             return 0;
         }
 
-        error_message = ASTNode_writeOut(out_file, &CTemplateConfig, module_ast);
+        error_message = template_config == &AsmTemplateConfig
+            ? Module_resolveSymbols(module_ast, &resolve_stats)
+            : 0;
+
+        if(error_message == 0) error_message = ASTNode_writeOut(out_file, template_config, module_ast);
 
         if(error_message != 0)
             printf("Writing out failed: %s\n", error_message);
@@ -94,12 +516,165 @@ int main(int argc, char* argv[]) {
         fclose(out_file);
     }
 
+    if(mode == MODE_EXECUTE) {
+
+        PassStats resolve_stats = { 0, 0 };
+
+        if(template_config == &AsmTemplateConfig) {
+
+            run_options.language = "assembler";
+            error_message = Module_resolveSymbols(module_ast, &resolve_stats);
+        }
+
+        run_options.printTimes = pass_manager.printStats;
+
+        if(error_message == 0) error_message = Module_compileAndRun(module_ast, template_config, &run_options,
+            in_name, program_argc, program_argv, &exit_status);
+
+        if(error_message != 0) {
+
+            printf("Compile and run failed: %s\n", error_message);
+
+            ASTNode_cleanUp(module_ast);
+
+            return 1;
+        }
+    }
+
     if(mode == MODE_DUMP_AST) {
 
         ASTNode_print(module_ast, 0);
     }
 
+    if(mode == MODE_RUN) {
+
+        Interpreter interpreter;
+
+        if((error_message = Interpreter_init(&interpreter, module_ast)) == 0) {
+
+            error_message = Interpreter_run(&interpreter);
+        }
+
+        Interpreter_cleanUp(&interpreter);
+
+        if(error_message != 0) {
+
+            fflush(stdout);
+            printf("Runtime error: %s\n", error_message);
+
+            ASTNode_cleanUp(module_ast);
+
+            return 1;
+        }
+    }
+
+    if(mode == MODE_JIT) {
+
+        Jit jit;
+
+        if((error_message = Jit_init(&jit, module_ast)) == 0) {
+
+            if(pass_manager.printStats) printf("jit: compiled %i of %i globals\n", jit.compiledCount, jit.lambdaCount);
+
+            error_message = Interpreter_run(&jit.interpreter);
+        }
+
+        Jit_cleanUp(&jit);
+
+        if(error_message != 0) {
+
+            fflush(stdout);
+            printf("Runtime error: %s\n", error_message);
+
+            ASTNode_cleanUp(module_ast);
+
+            return 1;
+        }
+    }
+
+    if(mode == MODE_BYTECODE || mode == MODE_DISASSEMBLE) {
+
+        BytecodeProgram program;
+
+        if((error_message = BytecodeProgram_compile(&program, module_ast)) != 0) {
+
+            printf("Bytecode compilation failed: %s\n", error_message);
+
+            ASTNode_cleanUp(module_ast);
+
+            return 1;
+        }
+
+        if(mode == MODE_DISASSEMBLE) BytecodeProgram_print(&program, stdout);
+        else error_message = VM_run(&program);
+
+        BytecodeProgram_cleanUp(&program);
+
+        if(error_message != 0) {
+
+            fflush(stdout);
+            printf("Runtime error: %s\n", error_message);
+
+            ASTNode_cleanUp(module_ast);
+
+            return 1;
+        }
+    }
+
     ASTNode_cleanUp(module_ast);
 
-    return 0;
+    return exit_status;
+}
+
+//A server keeps templates compiled and parsed modules cached across requests,
+//a client forwards its command line to one and relays the result
+int main(int argc, char* argv[]) {
+
+    char* error_message;
+    int exit_status = 0;
+
+    if(argc >= 2 && strncmp(argv[1], "--serve=", strlen("--serve=")) == 0) {
+
+        int workers = SERVER_DEFAULT_WORKERS;
+
+        if(argc >= 3 && strncmp(argv[2], "--workers=", strlen("--workers=")) == 0) {
+
+            workers = strtol(&argv[2][strlen("--workers=")], 0, 0);
+        }
+
+        if(
+            (error_message = TemplateConfig_compileAll(&CTemplateConfig)) != 0 ||
+            (error_message = TemplateConfig_compileAll(&AsmTemplateConfig)) != 0
+        ) {
+
+            printf("Template compilation failed: %s\n", error_message);
+
+            return 1;
+        }
+
+        ParseCache_enable(SERVER_PARSE_CACHE_ENTRIES);
+
+        if((error_message = Server_run(&argv[1][strlen("--serve=")], workers, Driver_run)) != 0) {
+
+            printf("Server failed: %s\n", error_message);
+
+            return 1;
+        }
+
+        return 0;
+    }
+
+    if(argc >= 2 && strncmp(argv[1], "--client=", strlen("--client=")) == 0) {
+
+        if((error_message = Client_run(&argv[1][strlen("--client=")], argc - 2, &argv[2], &exit_status)) != 0) {
+
+            printf("Client failed: %s\n", error_message);
+
+            return 1;
+        }
+
+        return exit_status;
+    }
+
+    return Driver_run(argc, argv);
 }
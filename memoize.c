@@ -0,0 +1,105 @@
+#include "memoize.h"
+#include "analysis.h"
+#include <string.h>
+
+//Checks the comma separated list of lambda names given with --memoize=
+int MemoizeOptions_namesSymbol(MemoizeOptions* options, String* name) {
+
+    char* s = options->names;
+
+    while(s != 0 && *s != 0) {
+
+        char* end = strchr(s, ',');
+        int length = end == 0 ? strlen(s) : end - s;
+
+        if(length == name->length && strncmp(s, name->data, length) == 0) return 1;
+
+        s = end == 0 ? 0 : end + 1;
+    }
+
+    return 0;
+}
+
+//Memoized lambdas are wrapped with a table of { valid, value, keys... } entries.
+//Single-parameter lambdas index the table directly by their argument and skip
+//the cache for arguments outside of it, everything else is hashed into a
+//power-of-two sized table where a colliding entry simply gets replaced
+void ASTLambdaNode_sizeMemoTable(ASTNode* lambda, size_t table_bytes) {
+
+    size_t param_count = lambda->LN_PARAMS->childCount;
+    size_t entries = table_bytes / (sizeof(int) * (param_count + 2));
+
+    if(param_count == 1) {
+
+        lambda->LN_MEMO_DIRECT = (void*)1;
+    } else {
+
+        size_t power = 1;
+
+        while(power * 2 <= entries) power *= 2;
+
+        if(entries != 0) entries = power;
+
+        lambda->LN_MEMO_DIRECT = 0;
+    }
+
+    lambda->LN_MEMOIZE = (void*)(size_t)(entries != 0);
+    lambda->LN_MEMO_SIZE = (void*)entries;
+}
+
+char* Module_memoize(ASTNode* module, MemoizeOptions* options, PassStats* stats) {
+
+    char* error;
+    VEC(ASTNodePtr) selected;
+
+    Vec_ASTNodePtr_init(&selected, 0);
+
+    for(int i = 0; i < module->childCount; i++) {
+
+        ASTNode* statement = module->children[i];
+
+        if(statement->type != Declaration) continue;
+
+        ASTNode* lambda = statement->DN_INITIALIZER;
+        String* name = (String*)statement->DN_SYMBOL->SN_TEXT;
+
+        if(lambda == 0 || lambda->type != Lambda) continue;
+
+        stats->nodesVisited++;
+
+        if(MemoizeOptions_namesSymbol(options, name)) {
+
+            if(!ASTLambdaNode_IsPure(lambda)) {
+
+                Vec_ASTNodePtr_cleanUp(&selected);
+
+                return "Lambda marked for memoization is not pure";
+            }
+        } else if(!(options->automatic && ASTLambdaNode_IsPure(lambda) &&
+            ASTNode_invokesSymbol(lambda->LN_EXPR, name))) {
+
+            continue;
+        }
+
+        if((error = Vec_ASTNodePtr_add(&selected, lambda)) != 0) {
+
+            Vec_ASTNodePtr_cleanUp(&selected);
+
+            return error;
+        }
+    }
+
+    //The table budget is shared evenly between every memoized lambda
+    for(int i = 0; i < selected.count; i++) {
+
+        ASTNode* lambda = selected.data[i];
+
+        ASTLambdaNode_sizeMemoTable(lambda, options->tableBytes / selected.count);
+
+        stats->nodesChanged += lambda->LN_MEMOIZE != 0;
+    }
+
+    Vec_ASTNodePtr_cleanUp(&selected);
+
+    return 0;
+}
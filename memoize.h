@@ -0,0 +1,15 @@
+#ifndef MEMOIZE_H
+#define MEMOIZE_H
+
+#include "ast.h"
+#include <stddef.h>
+
+typedef struct MemoizeOptions_s {
+    int automatic;
+    size_t tableBytes;
+    char* names;
+} MemoizeOptions;
+
+char* Module_memoize(ASTNode* module, MemoizeOptions* options, PassStats* stats);
+
+#endif //MEMOIZE_H
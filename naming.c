@@ -0,0 +1,178 @@
+#include "naming.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NAMING_HASH_SEED 14695981039346656037ull
+#define NAMING_HASH_PRIME 1099511628211ull
+
+typedef struct NameSet_s {
+    String** names;
+    size_t capacity;
+    size_t count;
+} NameSet;
+
+unsigned long long Naming_hashBytes(unsigned long long hash, void* data, size_t length) {
+
+    for(size_t i = 0; i < length; i++) hash = (hash ^ ((unsigned char*)data)[i]) * NAMING_HASH_PRIME;
+
+    return hash;
+}
+
+unsigned long long Naming_hashView(unsigned long long hash, StrView view) {
+
+    return Naming_hashBytes(hash, view.data, view.length);
+}
+
+//Hashes what the lambda renders from: its shape, parameter and symbol names,
+//literals, operators and the attributes the templates test
+unsigned long long Naming_hashNode(unsigned long long hash, ASTNode* node) {
+
+    long value;
+
+    if(node == 0) return Naming_hashBytes(hash, "", 1);
+
+    hash = Naming_hashBytes(hash, &node->type, sizeof(node->type));
+    hash = Naming_hashBytes(hash, &node->childCount, sizeof(node->childCount));
+
+    if(node->type == Symbol) hash = Naming_hashView(hash, String_view((String*)node->SN_TEXT));
+    if(node->type == StringLiteral) hash = Naming_hashView(hash, String_view((String*)node->SLN_STRING));
+
+    if(node->type == NumberLiteral || node->type == Operator) {
+
+        value = (long)(node->type == NumberLiteral ? node->NLN_NUMBER : node->ON_OPERATOR);
+        hash = Naming_hashBytes(hash, &value, sizeof(value));
+    }
+
+    if(node->type == Lambda) {
+
+        void* rendered[] = { node->LN_MEMOIZE, node->LN_MEMO_DIRECT, node->LN_MEMO_SIZE, node->LN_COLD };
+
+        hash = Naming_hashBytes(hash, rendered, sizeof(rendered));
+    }
+
+    for(int i = 0; i < node->childCount; i++) hash = Naming_hashNode(hash, node->children[i]);
+
+    return hash;
+}
+
+//Open addressing on the name's hash, only used to keep names unique
+char* NameSet_add(NameSet* set, String* name, int* added) {
+
+    size_t index;
+
+    if(set->count * 2 >= set->capacity) {
+
+        NameSet grown = { 0, set->capacity == 0 ? 64 : set->capacity * 2, set->count };
+
+        if((grown.names = (String**)calloc(grown.capacity, sizeof(String*))) == 0) {
+
+            return "Failed to allocate space for lambda names";
+        }
+
+        for(size_t i = 0; i < set->capacity; i++) {
+
+            if(set->names[i] == 0) continue;
+
+            for(index = Naming_hashView(NAMING_HASH_SEED, String_view(set->names[i])) & (grown.capacity - 1);
+                grown.names[index] != 0; index = (index + 1) & (grown.capacity - 1));
+
+            grown.names[index] = set->names[i];
+        }
+
+        free(set->names);
+        *set = grown;
+    }
+
+    for(index = Naming_hashView(NAMING_HASH_SEED, String_view(name)) & (set->capacity - 1); set->names[index] != 0;
+        index = (index + 1) & (set->capacity - 1)) {
+
+        if(String_equals(set->names[index], name)) {
+
+            *added = 0;
+
+            return 0;
+        }
+    }
+
+    set->names[index] = name;
+    set->count++;
+    *added = 1;
+
+    return 0;
+}
+
+char* Naming_nameLambda(ASTNode* lambda, StrView owner, NameSet* set) {
+
+    char* error;
+    char buffer[40];
+    int added = 0;
+    unsigned long long hash = Naming_hashNode(Naming_hashView(NAMING_HASH_SEED, owner), lambda);
+    String* name;
+
+    if(lambda->LN_NAME != 0) String_cleanUp((String*)lambda->LN_NAME);
+
+    lambda->LN_NAME = 0;
+
+    //Lambdas identical in both owner and shape are told apart by tree order
+    for(int copy = 0; !added; copy++) {
+
+        if(copy == 0) sprintf(buffer, "_%08x", (unsigned int)(hash ^ (hash >> 32)));
+        else sprintf(buffer, "_%08x_%d", (unsigned int)(hash ^ (hash >> 32)), copy);
+
+        if((name = String_fromView(owner)) == 0) return "Failed to allocate space for a lambda name";
+
+        if((error = String_appendCString(name, buffer)) != 0) {
+
+            String_cleanUp(name);
+
+            return error;
+        }
+
+        if((error = NameSet_add(set, name, &added)) != 0 || !added) String_cleanUp(name);
+
+        if(error != 0) return error;
+    }
+
+    lambda->LN_NAME = name;
+
+    return 0;
+}
+
+char* Naming_visit(ASTNode* node, StrView owner, NameSet* set) {
+
+    char* error;
+
+    if(node == 0) return 0;
+
+    if(node->type == Declaration) owner = String_view((String*)node->DN_SYMBOL->SN_TEXT);
+
+    if(node->type == Lambda && (error = Naming_nameLambda(node, owner, set)) != 0) return error;
+
+    for(int i = 0; i < node->childCount; i++) {
+
+        if((error = Naming_visit(node->children[i], owner, set)) != 0) return error;
+    }
+
+    return 0;
+}
+
+//Names each lambda after the declaration it sits in and a hash of its body,
+//so editing one lambda leaves the rendered text of every other one unchanged
+char* Module_nameLambdas(ASTNode* module) {
+
+    return Module_nameLambdasAs(module, "anonymous");
+}
+
+//Lambdas outside any declaration are named after anonymous_owner instead
+char* Module_nameLambdasAs(ASTNode* module, char* anonymous_owner) {
+
+    char* error;
+    NameSet set = { 0, 0, 0 };
+
+    error = Naming_visit(module, StrView_fromCString(anonymous_owner), &set);
+
+    free(set.names);
+
+    return error;
+}
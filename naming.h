@@ -0,0 +1,10 @@
+#ifndef NAMING_H
+#define NAMING_H
+
+#include "ast.h"
+
+char* Module_nameLambdas(ASTNode* module);
+
+char* Module_nameLambdasAs(ASTNode* module, char* anonymous_owner);
+
+#endif //NAMING_H
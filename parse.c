@@ -2,8 +2,128 @@
 #include "helpers.h"
 #include "scanner.h"
 #include "debug.h"
+#include <pthread.h>
 #include <stdlib.h>
 
+//Sources are cut into about this many chunks per parser thread so a slow
+//chunk evens out, but never into chunks smaller than the minimum
+#define PARSE_CHUNKS_PER_THREAD 4
+#define PARSE_MIN_CHUNK_BYTES (256 * 1024)
+
+char* ParseRuleNames[PARSE_RULE_COUNT] = {
+    "NumberLiteral", "StringLiteral", "Symbol", "Value", "Operator", "Parameter", "ParameterList",
+    "Lambda", "ArgumentList", "Invocation", "Expression", "Declaration", "ExpressionStatement", "Statement"
+};
+
+//A lambda whose body has only been measured so far. Lazy module parses
+//collect them in source order and parse the ones something reaches
+typedef struct LazyBody_s {
+    ASTNode* lambda;
+    ASTNode* declaration;
+    StrView name;
+    size_t start;
+    size_t end;
+    int reached;
+} LazyBody;
+
+typedef LazyBody* LazyBodyPtr;
+
+VEC_DECLARE(LazyBody)
+VEC_DECLARE(LazyBodyPtr)
+
+//Everything a module parse keeps besides its position. Module_parse owns one
+//for the length of the call and hangs it off the scanner, so parses on other
+//threads or in other contexts never see it. Lambda ids restart with every
+//module so a long-running process numbers them the way a fresh one would
+typedef struct ParseState_s {
+    ParseStats* stats;
+    size_t nextLambdaId;
+    VEC(LazyBody)* lazyBodies;
+} ParseState;
+
+char* ParseStats_count(Scanner scanner, ParseRule rule, char* error) {
+
+    ParseStats* stats = scanner->parse == 0 ? 0 : scanner->parse->stats;
+
+    if(stats != 0) {
+
+        stats->attempts[rule]++;
+
+        if(error != 0) stats->failures[rule]++;
+    }
+
+    return error;
+}
+
+void ParseStats_add(ParseStats* stats, ParseStats* other) {
+
+    for(int i = 0; i < PARSE_RULE_COUNT; i++) {
+
+        stats->attempts[i] += other->attempts[i];
+        stats->failures[i] += other->failures[i];
+    }
+}
+
+void ParseStats_print(ParseStats* stats) {
+
+    for(int i = 0; i < PARSE_RULE_COUNT; i++) {
+
+        printf("%-20s %10ld attempted %10ld failed\n", ParseRuleNames[i], stats->attempts[i], stats->failures[i]);
+    }
+}
+
+//What a token can be from its first byte, the FIRST sets the parser picks
+//an alternative by instead of trying each in turn
+typedef enum ParseFirst_e {
+    FirstNone,
+    FirstDigit,
+    FirstQuote,
+    FirstSymbol,
+    FirstParen
+} ParseFirst;
+
+static const unsigned char ParseFirstOf[256] = {
+    ['0' ... '9'] = FirstDigit,
+    ['"'] = FirstQuote,
+    ['a' ... 'z'] = FirstSymbol,
+    ['A' ... 'Z'] = FirstSymbol,
+    ['_'] = FirstSymbol,
+    ['('] = FirstParen
+};
+
+ParseFirst Parse_peekFirst(Scanner scanner) {
+
+    return ScannerAtEnd(scanner) ? FirstNone : ParseFirstOf[(unsigned char)scanner->data[scanner->position]];
+}
+
+//The byte following the symbol the scanner is on, past any whitespace. A
+//'(' there makes the symbol a call
+char Parse_peekPastSymbol(Scanner scanner) {
+
+    size_t position = scanner->position;
+    char next;
+
+    scanner->position += 1 + Scanner_identifierLength(&scanner->data[position + 1], scanner->length - position - 1);
+
+    ScannerSkipWhitespace(scanner);
+
+    next = ScannerAtEnd(scanner) ? 0 : scanner->data[scanner->position];
+    scanner->position = position;
+
+    return next;
+}
+
+//Whether the symbol the scanner is on is the keyword
+int Parse_peekKeyword(Scanner scanner, char* keyword) {
+
+    size_t length = strlen(keyword);
+    size_t end = scanner->position + length;
+
+    return Parse_peekFirst(scanner) == FirstSymbol && end <= scanner->length &&
+        memcmp(&scanner->data[scanner->position], keyword, length) == 0 &&
+        (end == scanner->length || Scanner_identifierLength(&scanner->data[end], 1) == 0);
+}
+
 int characterIsDecimalNumeric(char c) {
 
     return c >= '0' && c <= '9';
@@ -67,15 +187,19 @@ char* Value_tryParse(Scanner scanner, ASTNode** node, int level) {
 
     DEBUG_INDENT_PRINT(level, "Trying to parse a value\n");
 
-    char* error;
+    ScannerSkipWhitespace(scanner);
 
-    if(NumberLiteral_tryParse(scanner, node, level + 1) == 0) return 0;
-    if(StringLiteral_tryParse(scanner, node, level + 1) == 0) return 0;
-    if((error = Symbol_tryParse(scanner, node, level + 1)) == 0) return 0;
+    switch(Parse_peekFirst(scanner)) {
 
-    return error;
+        case FirstDigit: return ParseStats_count(scanner, RuleNumberLiteral, NumberLiteral_tryParse(scanner, node, level + 1));
+        case FirstQuote: return ParseStats_count(scanner, RuleStringLiteral, StringLiteral_tryParse(scanner, node, level + 1));
+        case FirstSymbol: return ParseStats_count(scanner, RuleSymbol, Symbol_tryParse(scanner, node, level + 1));
+        default: return "Expected a number, a string or a symbol";
+    }
 }
 
+//The literal keeps the source spelling, escapes included, since that is what
+//gets emitted. Only the interpreters decode it, and only when they need to
 char* StringLiteral_tryParse(Scanner scanner, ASTNode** node, int level) {
 
     DEBUG_INDENT_PRINT(level, "Trying to parse a string literal\n");
@@ -83,51 +207,33 @@ char* StringLiteral_tryParse(Scanner scanner, ASTNode** node, int level) {
     ScannerBegin(scanner);
 
     char* error;
-    ScanResult sr = { 0 };
     String* string;
+    size_t start;
+    size_t end;
 
     ScannerSkipWhitespace(scanner);
     
     if(!ScannerNextIs(scanner, '"'))
         return "String literal did not begin with double-quotes";
 
-    string = String_new(0);
+    start = scanner->position;
+    end = start + Scanner_findStringEnd(&scanner->data[start], scanner->length - start);
 
-    if(!string) {
+    if(end >= scanner->length) {
 
         ScannerRollbackFull(scanner);
 
-        return "Failed to allocate string for a string literal";
+        return "Encountered end of file inside of string";
     }
 
-    int ignore_quote = 0;
+    if((string = String_fromView(StrView_slice(&scanner->data[start], &scanner->data[end]))) == 0) {
 
-    while(1) {
-
-        sr = ScannerGetNextStrict(scanner);
-
-        if(sr.err) {
-
-            String_cleanUp(string);
-
-            return "Encountered end of file inside of string";
-        }
-
-	    if(sr.val == '"' && !ignore_quote)
-            break;
-
-        ignore_quote = 0;
+        ScannerRollbackFull(scanner);
 
-#warning TODO: Implement real escape character handling
-/*
-	    if(sr.val == '\\')
-            ignore_quote = 1;
-        else
-*/
-            String_appendChar(string, sr.val);
+        return "Failed to allocate string for a string literal";
     }
 
-    if((error = ASTNode_create(node, StringLiteral, 0, 1)) != 0) {
+    if((error = ASTNode_create(node, StringLiteral, 0, 2)) != 0) {
 
         ScannerRollbackFull(scanner);
         String_cleanUp(string);
@@ -135,7 +241,10 @@ char* StringLiteral_tryParse(Scanner scanner, ASTNode** node, int level) {
     	return "Failed to allocate space for a string literal";
     }
 
+    scanner->position = end + 1;
+
     (*node)->SLN_STRING = string;
+    (*node)->SLN_VALUE = 0;
 
     return 0;
 }
@@ -145,75 +254,48 @@ char* Symbol_tryParse(Scanner scanner, ASTNode** node, int level) {
     DEBUG_INDENT_PRINT(level, "Trying to parse a symbol\n");
 
     char* error;
-    ScanResult sr = { 0 };
+    char first;
+    size_t start;
+    size_t length;
+    String* text;
 
     ScannerBegin(scanner);
-
-    String* symbol_text = String_new(0);
-
-    if(!symbol_text) return "Unable to allocate String for symbol text";
-
     ScannerSkipWhitespace(scanner);
 
-    for(int i = 0; ; i++) {
+    start = scanner->position;
+    first = start < scanner->length ? scanner->data[start] : 0;
 
-        if(!ScannerCheckpoint(scanner)) {
+    if(!((first >= 'a' && first <= 'z') || (first >= 'A' && first <= 'Z') || first == '_')) {
 
-            ScannerRollbackFull(scanner);
-            String_cleanUp(symbol_text);
-            
-            return "Failed to get file position";
-        }
-
-        sr = ScannerGetNext(scanner);
-
-        if(sr.err) break;
-
-        if(
-            (sr.val >= 'a' && sr.val <= 'z') ||
-            (sr.val >= 'A' && sr.val <= 'Z') ||
-            (!!i && (sr.val > 0 && sr.val >= '0' && sr.val <= '9')) ||
-            (sr.val == '_')
-        ) {
-
-            error = String_appendChar(symbol_text, sr.val);
-
-            if(error != 0) {
-        
-                ScannerRollbackFull(scanner);
-                String_cleanUp(symbol_text);
-
-                return error;
-            }
-
-            continue;
-        }
+        ScannerRollbackFull(scanner);
 
-        if(i == 0) {
+        return "Symbol did not begin with a valid character";
+    }
 
-            ScannerRollbackFull(scanner);
-            String_cleanUp(symbol_text);
+    length = 1 + Scanner_identifierLength(&scanner->data[start + 1], scanner->length - start - 1);
 
-            return "Symbol did not begin with a valid character";
-        }
+    if((text = String_fromView((StrView){ &scanner->data[start], length })) == 0) {
 
-        ScannerRollbackLast(scanner);
+        ScannerRollbackFull(scanner);
 
-        break;
+        return "Unable to allocate String for symbol text";
     }
 
-    error = ASTNode_create(node, Symbol, 0, 1);
-
-    if(*node == 0) {
+    if((error = ASTNode_create(node, Symbol, 0, 4)) != 0) {
 
         ScannerRollbackFull(scanner);
 
-        String_cleanUp(symbol_text);
+        String_cleanUp(text);
 
         return "Couldn't allocate memory for ast symbol";
     }
 
-    (*node)->SN_TEXT = (void*)symbol_text;
+    scanner->position = start + length;
+
+    (*node)->SN_TEXT = (void*)text;
+    (*node)->SN_KIND = (void*)SymbolExternal;
+    (*node)->SN_SLOT = 0;
+    (*node)->SN_LAMBDA = 0;
 
     return 0;
 }
@@ -227,7 +309,7 @@ char* Operator_tryParse(Scanner scanner, ASTNode** node, int level) {
 
     ASTNode* left_expr;
 
-    char* left_error = Value_tryParse(scanner, &left_expr, level + 1);
+    char* left_error = ParseStats_count(scanner, RuleValue, Value_tryParse(scanner, &left_expr, level + 1));
 
     if(left_error != 0) {
     
@@ -273,7 +355,7 @@ char* Operator_tryParse(Scanner scanner, ASTNode** node, int level) {
     
     ASTNode* right_expr;
 
-    char* right_error = Value_tryParse(scanner, &right_expr, level + 1);
+    char* right_error = ParseStats_count(scanner, RuleValue, Value_tryParse(scanner, &right_expr, level + 1));
 
     if(right_error != 0) {
     
@@ -326,7 +408,7 @@ char* Parameter_tryParse(Scanner scanner, ASTNode** node, int level) {
 
     ScannerSkipWhitespace(scanner);
 
-    char* error = Symbol_tryParse(scanner, &symbol, level + 1);
+    char* error = ParseStats_count(scanner, RuleSymbol, Symbol_tryParse(scanner, &symbol, level + 1));
 
     if(error != 0) return error;
 
@@ -356,56 +438,41 @@ char* ParameterList_tryParse(Scanner scanner, ASTNode** node, int level) {
 
     if(!ScannerNextIs(scanner, '(')) return "Expected '(' at start of parameter list";
 
-    int paramDeclarationsCapacity = 0;
-    int paramDeclarationsCount = 0;
     char* error = 0;
-    ASTNode** paramDeclarations = 0;
+    VEC(ASTNodePtr) parameters;
+
+    Vec_ASTNodePtr_init(&parameters, 0);
 
     while(1) {
     
         ASTNode* parameter;
 
-        error = Parameter_tryParse(scanner, &parameter, level + 1);
+        error = ParseStats_count(scanner, RuleParameter, Parameter_tryParse(scanner, &parameter, level + 1));
 
         if(error) {
 
-            if(paramDeclarationsCount > 0) free(paramDeclarations);
+            Vec_ASTNodePtr_cleanUp(&parameters);
 
             ScannerRollbackFull(scanner);
 
             return error;
         }
 
-        if(paramDeclarationsCapacity == paramDeclarationsCount) {
-
-            int new_size = paramDeclarationsCapacity == 0
-                ? 1
-                : (2 * paramDeclarationsCapacity);
-    
-            paramDeclarationsCapacity = new_size;
-            ASTNode** newParametersPtr = (ASTNode**)realloc(paramDeclarations, sizeof(ASTNode*) * paramDeclarationsCapacity );
-
-            if(newParametersPtr != 0) {
-
-                paramDeclarations = newParametersPtr;
-            } else {
+        if((error = Vec_ASTNodePtr_add(&parameters, parameter)) != 0) {
 
-                if(paramDeclarationsCount > 0) free(paramDeclarations);
+            Vec_ASTNodePtr_cleanUp(&parameters);
 
-                ScannerRollbackFull(scanner);
+            ScannerRollbackFull(scanner);
 
-                return "Failed to allocate memory for parameter list";
-            }
+            return error;
         }
 
-        paramDeclarations[paramDeclarationsCount++] = parameter;
-
         ScannerSkipWhitespace(scanner);
         sr = ScannerGetNextStrict(scanner);
 
         if(sr.err) {
 
-            if(paramDeclarationsCount > 0) free(paramDeclarations);
+            Vec_ASTNodePtr_cleanUp(&parameters);
 
             return "Unexpected EOF in parameter list";
         }
@@ -415,7 +482,7 @@ char* ParameterList_tryParse(Scanner scanner, ASTNode** node, int level) {
 
     if(sr.val != ')') {
 
-        if(paramDeclarationsCount > 0) free(paramDeclarations);
+        Vec_ASTNodePtr_cleanUp(&parameters);
 
         ScannerRollbackFull(scanner);
 
@@ -424,24 +491,42 @@ char* ParameterList_tryParse(Scanner scanner, ASTNode** node, int level) {
 
     error = ASTNode_create(node, ParameterList, 0, 0);
 
-    if(error != 0) {
+    if(error != 0 || (error = Vec_ASTNodePtr_shrink(&parameters)) != 0) {
 
-        if(paramDeclarationsCount > 0) free(paramDeclarations);
+        Vec_ASTNodePtr_cleanUp(&parameters);
 
         ScannerRollbackFull(scanner);
 
         return "Failed to allocate memory for parameter list";
     }
 
-    (*node)->childCount = paramDeclarationsCount;
-    (*node)->children = paramDeclarations;
+    (*node)->childCount = parameters.count;
+    (*node)->children = parameters.data;
     
     return 0;
 }
 
-char* Lambda_tryParse(Scanner scanner, ASTNode** node, int level) {
+//Statements parsed outside a module, as streaming and documents do, have no
+//parse state and number all their lambdas 0
+char* Lambda_create(Scanner scanner, ASTNode** node, ASTNode* parameterList, ASTNode* expression) {
 
-    static int lambda_id = 0;
+    if(ASTNode_create(node, Lambda, 2, 8) != 0) return "Unable to allocate space for a lambda";
+
+    (*node)->LN_PARAMS = parameterList;
+    (*node)->LN_EXPR = expression;
+    (*node)->LN_ID = (void*)(scanner->parse == 0 ? 0 : scanner->parse->nextLambdaId++);
+    (*node)->LN_MEMOIZE = 0;
+    (*node)->LN_MEMO_DIRECT = 0;
+    (*node)->LN_MEMO_SIZE = 0;
+    (*node)->LN_PURE = 0;
+    (*node)->LN_COLD = 0;
+    (*node)->LN_NATIVE = 0;
+    (*node)->LN_NAME = 0;
+
+    return 0;
+}
+
+char* Lambda_tryParse(Scanner scanner, ASTNode** node, int level) {
 
     DEBUG_INDENT_PRINT(level, "Trying to parse a lambda\n");
 
@@ -449,7 +534,7 @@ char* Lambda_tryParse(Scanner scanner, ASTNode** node, int level) {
 
     ScannerBegin(scanner);
 
-    char* pl_error = ParameterList_tryParse(scanner, &parameterList, level + 1);
+    char* pl_error = ParseStats_count(scanner, RuleParameterList, ParameterList_tryParse(scanner, &parameterList, level + 1));
 
     if(pl_error != 0) {
     
@@ -471,7 +556,7 @@ char* Lambda_tryParse(Scanner scanner, ASTNode** node, int level) {
 
     ASTNode* expression;
 
-    char* expression_error = Expression_tryParse(scanner, &expression, level + 1);
+    char* expression_error = ParseStats_count(scanner, RuleExpression, Expression_tryParse(scanner, &expression, level + 1));
 
     if(expression_error != 0)  {
 
@@ -482,7 +567,7 @@ char* Lambda_tryParse(Scanner scanner, ASTNode** node, int level) {
         return expression_error;
     }
 
-    char* error = ASTNode_create(node, Lambda, 2, 1);
+    char* error = Lambda_create(scanner, node, parameterList, expression);
 
     if(error != 0)  {
 
@@ -491,12 +576,65 @@ char* Lambda_tryParse(Scanner scanner, ASTNode** node, int level) {
 
         ScannerRollbackFull(scanner);
 
-        return expression_error;
+        return error;
     }
 
-    (*node)->LN_PARAMS = parameterList;
-    (*node)->LN_EXPR = expression;
-    (*node)->attributes[0] = (void*)(size_t)(lambda_id++);
+    return 0;
+}
+
+//Parses the parameters of a lambda but only measures its body, leaving
+//LN_EXPR empty until Module_parseReachedBodies gets to it
+char* Lambda_tryPreParse(Scanner scanner, ASTNode** node, int level) {
+
+    DEBUG_INDENT_PRINT(level, "Trying to pre-parse a lambda\n");
+
+    char* error;
+    ASTNode* parameterList;
+    LazyBody body = { 0 };
+
+    ScannerBegin(scanner);
+
+    if((error = ParseStats_count(scanner, RuleParameterList, ParameterList_tryParse(scanner, &parameterList, level + 1))) != 0) {
+
+        ScannerRollbackFull(scanner);
+
+        return error;
+    }
+
+    ScannerSkipWhitespace(scanner);
+
+    if(!ScannerNextIsStr(scanner, "=>")) {
+
+        ASTNode_cleanUp(parameterList);
+
+        return "Expected '=>' following lambda parameter list";
+    }
+
+    ScannerSkipWhitespace(scanner);
+
+    body.start = scanner->position;
+
+    if((error = Scanner_findStatementEnd(&scanner->data[body.start], scanner->length - body.start, &body.end)) != 0 ||
+        (error = Lambda_create(scanner, node, parameterList, 0)) != 0) {
+
+        ASTNode_cleanUp(parameterList);
+        ScannerRollbackFull(scanner);
+
+        return error;
+    }
+
+    body.end += body.start;
+    body.lambda = *node;
+
+    if((error = Vec_LazyBody_add(scanner->parse->lazyBodies, body)) != 0) {
+
+        ASTNode_cleanUp(*node);
+        ScannerRollbackFull(scanner);
+
+        return error;
+    }
+
+    scanner->position = body.end;
 
     return 0;
 }
@@ -505,10 +643,10 @@ char* ArgumentList_tryParse(Scanner scanner, ASTNode** node, int level) {
 
     DEBUG_INDENT_PRINT(level, "Trying to parse an argument list\n");
 
-    VoidList child_list;
+    VEC(ASTNodePtr) child_list;
 
     ScannerBegin(scanner);
-    VoidList_init(&child_list);
+    Vec_ASTNodePtr_init(&child_list, 0);
 
     ScanResult sr = { 0 };
     int expect_next = 0;
@@ -526,22 +664,25 @@ char* ArgumentList_tryParse(Scanner scanner, ASTNode** node, int level) {
 
     	ScannerSkipWhitespace(scanner);
 
-    	error = Expression_tryParse(scanner, &arg_expression, level + 1);
+    	//An empty list or a stray byte cannot start an argument
+    	error = Parse_peekFirst(scanner) != FirstNone
+            ? ParseStats_count(scanner, RuleExpression, Expression_tryParse(scanner, &arg_expression, level + 1))
+            : "Expected an argument";
 
     	if(error != 0 && expect_next) {
 
-            VoidList_cleanUp(&child_list);
+            Vec_ASTNodePtr_cleanUp(&child_list);
 
     	    return "Expected argument following comma in argument list";
     	}
 
     	if(error == 0) {
 
-            error = VoidList_add(&child_list, arg_expression);
+            error = Vec_ASTNodePtr_add(&child_list, arg_expression);
 
 	        if(error != 0) {
 
-                VoidList_cleanUp(&child_list);
+                Vec_ASTNodePtr_cleanUp(&child_list);
 
                 return error;
 	        }
@@ -553,7 +694,7 @@ char* ArgumentList_tryParse(Scanner scanner, ASTNode** node, int level) {
         if(sr.err) {
 
             //TODO: We should clean up the individual nodes as well
-            VoidList_cleanUp(&child_list);
+            Vec_ASTNodePtr_cleanUp(&child_list);
 
     	    return "Unexpected EOF reading argument list";
 	    }
@@ -564,16 +705,16 @@ char* ArgumentList_tryParse(Scanner scanner, ASTNode** node, int level) {
 
     error = ASTNode_create(node, ArgumentList, 0, 0);
 
-    if(error != 0) {
+    if(error != 0 || (error = Vec_ASTNodePtr_shrink(&child_list)) != 0) {
     
-        VoidList_cleanUp(&child_list);
+        Vec_ASTNodePtr_cleanUp(&child_list);
         ScannerRollbackFull(scanner);
         
     	return "Failed to allocate memory for an argument list node";
     }
 
     (*node)->childCount = child_list.count;
-    (*node)->children = (ASTNode**)child_list.data;
+    (*node)->children = child_list.data;
 
     return 0;
 }
@@ -588,7 +729,7 @@ char* Invocation_tryParse(Scanner scanner, ASTNode** node, int level) {
 
     ScannerBegin(scanner);
 
-    error = Symbol_tryParse(scanner, &symbol, level + 1);
+    error = ParseStats_count(scanner, RuleSymbol, Symbol_tryParse(scanner, &symbol, level + 1));
 
     if(error != 0) {
 
@@ -600,7 +741,7 @@ char* Invocation_tryParse(Scanner scanner, ASTNode** node, int level) {
     ScannerSkipWhitespace(scanner);
 
     ASTNode* arguments;
-    error = ArgumentList_tryParse(scanner, &arguments, level + 1);
+    error = ParseStats_count(scanner, RuleArgumentList, ArgumentList_tryParse(scanner, &arguments, level + 1));
 
     if(error != 0) {
 
@@ -631,13 +772,21 @@ char* Expression_tryParse(Scanner scanner, ASTNode** node, int level) {
 
     DEBUG_INDENT_PRINT(level, "Trying to parse an expression\n");
 
-    char* error;
-    
-    if(Lambda_tryParse(scanner, node, level + 1) == 0) return 0;
-    if((error = Invocation_tryParse(scanner, node, level + 1)) == 0) return 0;
-    if((error = Operator_tryParse(scanner, node, level + 1)) == 0) return 0;
+    ScannerSkipWhitespace(scanner);
 
-    return error;
+    switch(Parse_peekFirst(scanner)) {
+
+        case FirstParen: return ParseStats_count(scanner, RuleLambda, Lambda_tryParse(scanner, node, level + 1));
+
+        //A symbol that is not called is a value, maybe an operand
+        case FirstSymbol:
+            if(Parse_peekPastSymbol(scanner) == '(') return ParseStats_count(scanner, RuleInvocation, Invocation_tryParse(scanner, node, level + 1));
+
+        case FirstDigit:
+        case FirstQuote: return ParseStats_count(scanner, RuleOperator, Operator_tryParse(scanner, node, level + 1));
+
+        default: return "Expected a lambda, a call or a value";
+    }
 }
 
 char* Declaration_tryParse(Scanner scanner, ASTNode** node, int level) {
@@ -661,7 +810,7 @@ char* Declaration_tryParse(Scanner scanner, ASTNode** node, int level) {
 
     ScannerSkipWhitespace(scanner);
 
-    char* error = Symbol_tryParse(scanner, &lvalue, level + 1);
+    char* error = ParseStats_count(scanner, RuleSymbol, Symbol_tryParse(scanner, &lvalue, level + 1));
 
     if(error != 0) return error;
 
@@ -675,7 +824,14 @@ char* Declaration_tryParse(Scanner scanner, ASTNode** node, int level) {
 
     if(!sr.err && sr.val == '=') {
 
-        error = Expression_tryParse(scanner, &rvalue, level + 1);
+        ScannerSkipWhitespace(scanner);
+
+        //Only a lambda that makes up a whole initializer puts its body off.
+        //One that does not pre-parse is parsed in full for its error
+        error = scanner->parse != 0 && scanner->parse->lazyBodies != 0 && Parse_peekFirst(scanner) == FirstParen &&
+            ParseStats_count(scanner, RuleLambda, Lambda_tryPreParse(scanner, &rvalue, level + 1)) == 0
+            ? 0
+            : ParseStats_count(scanner, RuleExpression, Expression_tryParse(scanner, &rvalue, level + 1));
 
         if(error != 0) {
 
@@ -722,7 +878,7 @@ char* ExpressionStatement_tryParse(Scanner scanner, ASTNode** node, int level) {
 
     ScannerBegin(scanner);
 
-    if((error = Expression_tryParse(scanner, node, level + 1)) != 0) return error;
+    if((error = ParseStats_count(scanner, RuleExpression, Expression_tryParse(scanner, node, level + 1))) != 0) return error;
 
     ScannerSkipWhitespace(scanner);
 
@@ -737,10 +893,29 @@ char* Statement_tryParse(Scanner scanner, ASTNode** node, int level) {
 
     ScannerSkipWhitespace(scanner);
 
-    char* error;
+    if(Parse_peekKeyword(scanner, "var")) return ParseStats_count(scanner, RuleDeclaration, Declaration_tryParse(scanner, node, level + 1));
+
+    return ParseStats_count(scanner, RuleExpressionStatement, ExpressionStatement_tryParse(scanner, node, level + 1));
+}
+
+//Parses statements until the scanner runs out. The caller owns whatever
+//statements were parsed, even on an error
+char* Module_parseStatements(Scanner scanner, VEC(ASTNodePtr)* statements, int level) {
+
+    char* error = 0;
+    ASTNode* new_statement;
+
+    while((!ScannerAtEnd(scanner)) && ((error = ParseStats_count(scanner, RuleStatement, Statement_tryParse(scanner, &new_statement, level + 1))) == 0)) {
 
-    if((error = Declaration_tryParse(scanner, node, level + 1)) == 0) return 0;
-    if((error = ExpressionStatement_tryParse(scanner, node, level + 1)) == 0) return 0;
+        if((error = Vec_ASTNodePtr_add(statements, new_statement)) != 0) {
+
+            ASTNode_cleanUp(new_statement);
+
+            break;
+        }
+
+        ScannerSkipWhitespace(scanner);
+    }
 
     return error;
 }
@@ -749,38 +924,409 @@ char* Module_tryParse(Scanner scanner, ASTNode** node, int level) {
 
     DEBUG_INDENT_PRINT(level, "Trying to parse a module\n");
 
-    int statementCapacity = 0;
     char* inner_error = 0;
-    ASTNode* new_statement;
+    VEC(ASTNodePtr) statements;
 
     inner_error = ASTNode_create(node, Module, 0, 0);
 
     if(inner_error != 0) return "Unable to allocate memory for a module node";
 
-    while((!ScannerAtEnd(scanner)) && ((inner_error = Statement_tryParse(scanner, &new_statement, level + 1)) == 0)) {
-        
-        if(statementCapacity < ((*node)->childCount + 1)) {
+    Vec_ASTNodePtr_init(&statements, 0);
 
-            int nextCapacity = (statementCapacity == 0) ? 1 : (statementCapacity * 2);
-        
-            (*node)->children = (ASTNode**)realloc((*node)->children, nextCapacity * sizeof(ASTNode*));
+    inner_error = Module_parseStatements(scanner, &statements, level);
+
+    //The module owns whatever statements were parsed, even on an error
+    Vec_ASTNodePtr_shrink(&statements);
 
-            if((*node)->children == 0) {
+    (*node)->childCount = statements.count;
+    (*node)->children = statements.data;
 
-                inner_error = "Failed to allocate statement memory when constructing module node";
+    return inner_error;
+}
+
+int Statement_hasLazyBody(ASTNode* statement) {
+
+    return statement->type == Declaration && statement->DN_INITIALIZER != 0 &&
+        statement->DN_INITIALIZER->type == Lambda && statement->DN_INITIALIZER->LN_EXPR == 0;
+}
+
+int LazyBody_compareNames(StrView a, StrView b) {
+
+    if(a.length != b.length) return a.length < b.length ? -1 : 1;
+
+    return memcmp(a.data, b.data, a.length);
+}
+
+int LazyBody_compare(const void* a, const void* b) {
+
+    return LazyBody_compareNames(((LazyBody*)a)->name, ((LazyBody*)b)->name);
+}
+
+typedef struct LazyBodyReach_s {
+    VEC(LazyBody)* bodies;
+    VEC(LazyBodyPtr) pending;
+} LazyBodyReach;
+
+//Queues every unreached body declared under the name of a symbol. Bodies
+//are sorted by name, and a name can be declared more than once
+char* LazyBody_reachSymbol(ASTNode* node, void* args) {
+
+    VEC(LazyBody)* bodies = ((LazyBodyReach*)args)->bodies;
+    VEC(LazyBodyPtr)* pending = &((LazyBodyReach*)args)->pending;
+    size_t low = 0;
+    size_t high = bodies->count;
+    char* error;
+
+    if(node->type != Symbol) return 0;
+
+    StrView name = String_view((String*)node->SN_TEXT);
+
+    while(low < high) {
+
+        size_t middle = low + (high - low) / 2;
+
+        if(LazyBody_compareNames(bodies->data[middle].name, name) < 0) low = middle + 1;
+        else high = middle;
+    }
+
+    for(; low < bodies->count && LazyBody_compareNames(bodies->data[low].name, name) == 0; low++) {
+
+        if(bodies->data[low].reached) continue;
+
+        bodies->data[low].reached = 1;
+
+        if((error = Vec_LazyBodyPtr_add(pending, &bodies->data[low])) != 0) return error;
+    }
+
+    return 0;
+}
+
+char* LazyBody_parse(LazyBody* body, Scanner scanner, int level) {
+
+    char* error;
+    ASTNode* expression;
+    ScannerSource source;
+
+    //Ending the source right after the ';' lets the body see the same
+    //lookahead it would have seen in place
+    Scanner_init(&source, scanner->data, body->end + 1);
+    source.position = body->start;
+    source.parse = scanner->parse;
+
+    if((error = ParseStats_count(&source, RuleExpression, Expression_tryParse(&source, &expression, level + 1))) != 0) return error;
+
+    ScannerSkipWhitespace(&source);
+
+    if(source.position != body->end) {
+
+        ASTNode_cleanUp(expression);
+
+        return "Lambda body did not end at the ';' of its declaration";
+    }
+
+    body->lambda->LN_EXPR = expression;
+
+    return 0;
+}
+
+//Everything the generated code can call is reachable by name from the
+//statements that are not lambda declarations. Those bodies get parsed, the
+//bodies they name in turn, and declarations nothing reaches are dropped
+char* Module_parseReachedBodies(Scanner scanner, ASTNode* module, int level) {
+
+    VEC(LazyBody)* bodies = scanner->parse->lazyBodies;
+    LazyBodyReach reach = { bodies };
+    size_t next = 0;
+    size_t kept = 0;
+    char* error = 0;
+
+    for(size_t i = 0; i < module->childCount && next < bodies->count; i++) {
+
+        ASTNode* statement = module->children[i];
+
+        if(statement->type != Declaration || statement->DN_INITIALIZER != bodies->data[next].lambda) continue;
+
+        bodies->data[next].declaration = statement;
+        bodies->data[next].name = String_view((String*)statement->DN_SYMBOL->SN_TEXT);
+        next++;
+    }
+
+    qsort(bodies->data, bodies->count, sizeof(LazyBody), LazyBody_compare);
+
+    Vec_LazyBodyPtr_init(&reach.pending, 0);
+
+    for(size_t i = 0; i < module->childCount && error == 0; i++) {
+
+        if(!Statement_hasLazyBody(module->children[i]))
+            error = ASTNode_forAll(module->children[i], LazyBody_reachSymbol, &reach);
+    }
+
+    while(error == 0 && reach.pending.count != 0) {
+
+        LazyBody* body = reach.pending.data[--reach.pending.count];
+
+        if((error = LazyBody_parse(body, scanner, level + 1)) == 0)
+            error = ASTNode_forAll(body->lambda->LN_EXPR, LazyBody_reachSymbol, &reach);
+    }
+
+    Vec_LazyBodyPtr_cleanUp(&reach.pending);
+
+    if(error != 0) return error;
+
+    for(size_t i = 0; i < module->childCount; i++) {
+
+        if(Statement_hasLazyBody(module->children[i])) ASTNode_cleanUp(module->children[i]);
+        else module->children[kept++] = module->children[i];
+    }
+
+    module->childCount = kept;
+
+    return 0;
+}
+
+//Parses a module with every lambda declaration body put off until something
+//reaches it. The module never holds a lambda without a body on success. The
+//bodies are kept in the parse state, so this only runs under Module_parse
+char* Module_tryParseLazy(Scanner scanner, ASTNode** node, int level) {
+
+    char* error;
+    VEC(LazyBody) bodies;
+
+    Vec_LazyBody_init(&bodies, 0);
+
+    scanner->parse->lazyBodies = &bodies;
+
+    if((error = Module_tryParse(scanner, node, level)) == 0) error = Module_parseReachedBodies(scanner, *node, level);
+
+    scanner->parse->lazyBodies = 0;
+
+    Vec_LazyBody_cleanUp(&bodies);
+
+    return error;
+}
+
+//A run of whole statements one worker parses on its own. Its lambdas are
+//numbered from 0 and moved up past the earlier chunks' once all are done
+typedef struct ParseChunk_s {
+    size_t start;
+    size_t end;
+    VEC(ASTNodePtr) statements;
+    size_t lambdaCount;
+    char* error;
+} ParseChunk;
+
+VEC_DECLARE(ParseChunk)
+
+typedef struct ParallelParse_s {
+    char* data;
+    VEC(ParseChunk) chunks;
+    pthread_mutex_t lock;
+    size_t nextChunk;
+    ParseStats* stats;
+    int level;
+} ParallelParse;
+
+void* ParallelParse_work(void* args) {
+
+    ParallelParse* parse = (ParallelParse*)args;
+    ParseStats stats = { 0 };
+    ParseState state = { parse->stats != 0 ? &stats : 0 };
+
+    while(1) {
+
+        pthread_mutex_lock(&parse->lock);
+
+        size_t index = parse->nextChunk++;
+
+        if(index >= parse->chunks.count && parse->stats != 0) ParseStats_add(parse->stats, &stats);
+
+        pthread_mutex_unlock(&parse->lock);
+
+        if(index >= parse->chunks.count) return 0;
+
+        ParseChunk* chunk = &parse->chunks.data[index];
+        ScannerSource scanner;
+
+        Scanner_init(&scanner, parse->data, chunk->end);
+        scanner.position = chunk->start;
+
+        //The whitespace after the previous chunk's last statement, which a
+        //serial parse would have skipped right after it
+        if(index != 0) ScannerSkipWhitespace(&scanner);
+
+        scanner.parse = &state;
+        state.nextLambdaId = 0;
+        Vec_ASTNodePtr_init(&chunk->statements, 0);
+
+        chunk->error = Module_parseStatements(&scanner, &chunk->statements, parse->level);
+        chunk->lambdaCount = state.nextLambdaId;
+    }
+}
+
+char* Lambda_offsetId(ASTNode* node, void* args) {
+
+    if(node->type == Lambda) node->LN_ID = (void*)((size_t)node->LN_ID + *(size_t*)args);
+
+    return 0;
+}
+
+//Cuts the source into chunks of whole statements, about chunk_bytes each.
+//Anything the statement search cannot make sense of goes to the last chunk,
+//whose parse then reports it
+char* ParallelParse_split(ParallelParse* parse, Scanner scanner, size_t chunk_bytes) {
+
+    char* error;
+    size_t position = scanner->position;
+
+    while(position < scanner->length) {
+
+        ParseChunk chunk = { position, position };
+        size_t end;
+
+        while(chunk.end < scanner->length && chunk.end - chunk.start < chunk_bytes) {
+
+            if(Scanner_findStatementEnd(&scanner->data[chunk.end], scanner->length - chunk.end, &end) != 0) {
+
+                chunk.end = scanner->length;
 
                 break;
             }
 
-            statementCapacity = nextCapacity;
+            chunk.end += end + 1;
         }
 
-        (*node)->children[(*node)->childCount++] = new_statement;
+        if((error = Vec_ParseChunk_add(&parse->chunks, chunk)) != 0) return error;
 
-        ScannerSkipWhitespace(scanner);
+        position = chunk.end;
     }
 
-    return inner_error;
+    return 0;
+}
+
+//Parses the top-level statements of a large source on thread_count threads,
+//the calling one included. The module comes out exactly as Module_tryParse
+//would build it, lambda ids and the statements kept on an error included
+char* Module_tryParseParallel(Scanner scanner, ASTNode** node, int thread_count, int level) {
+
+    DEBUG_INDENT_PRINT(level, "Trying to parse a module in parallel\n");
+
+    char* error = 0;
+    ParallelParse parse;
+    pthread_t* threads;
+    VEC(ASTNodePtr) statements;
+    size_t lambda_offset = 0;
+    size_t chunk_bytes = (scanner->length - scanner->position) / ((size_t)thread_count * PARSE_CHUNKS_PER_THREAD);
+
+    parse.data = scanner->data;
+    parse.nextChunk = 0;
+    parse.stats = scanner->parse == 0 ? 0 : scanner->parse->stats;
+    parse.level = level;
+    Vec_ParseChunk_init(&parse.chunks, 0);
+
+    if(thread_count > 1 && (error = ParallelParse_split(&parse, scanner, chunk_bytes < PARSE_MIN_CHUNK_BYTES ? PARSE_MIN_CHUNK_BYTES : chunk_bytes)) != 0) {
+
+        Vec_ParseChunk_cleanUp(&parse.chunks);
+
+        return error;
+    }
+
+    if(parse.chunks.count <= 1) {
+
+        Vec_ParseChunk_cleanUp(&parse.chunks);
+
+        return Module_tryParse(scanner, node, level);
+    }
+
+    if(thread_count > parse.chunks.count) thread_count = (int)parse.chunks.count;
+
+    if((threads = (pthread_t*)malloc(sizeof(pthread_t) * thread_count)) == 0) {
+
+        Vec_ParseChunk_cleanUp(&parse.chunks);
+
+        return "Unable to allocate space for parser threads";
+    }
+
+    pthread_mutex_init(&parse.lock, 0);
+
+    threads[0] = pthread_self();
+
+    //Threads that fail to start just leave their share to the others
+    for(int i = 1; i < thread_count; i++) {
+
+        if(pthread_create(&threads[i], 0, ParallelParse_work, &parse) != 0) threads[i] = threads[0];
+    }
+
+    ParallelParse_work(&parse);
+
+    for(int i = 1; i < thread_count; i++) {
+
+        if(!pthread_equal(threads[i], threads[0])) pthread_join(threads[i], 0);
+    }
+
+    pthread_mutex_destroy(&parse.lock);
+    free(threads);
+
+    //Stitch the chunks back together in source order, up to the first one
+    //that failed
+    Vec_ASTNodePtr_init(&statements, 0);
+
+    for(size_t i = 0; i < parse.chunks.count; i++) {
+
+        ParseChunk* chunk = &parse.chunks.data[i];
+
+        if(error == 0) {
+
+            for(size_t j = 0; j < chunk->statements.count && lambda_offset != 0; j++)
+                ASTNode_forAll(chunk->statements.data[j], Lambda_offsetId, &lambda_offset);
+
+            lambda_offset += chunk->lambdaCount;
+
+            if((error = Vec_ASTNodePtr_append(&statements, chunk->statements.data, chunk->statements.count)) == 0) {
+
+                error = chunk->error;
+
+                chunk->statements.count = 0;
+            }
+        }
+
+        for(size_t j = 0; j < chunk->statements.count; j++) ASTNode_cleanUp(chunk->statements.data[j]);
+
+        Vec_ASTNodePtr_cleanUp(&chunk->statements);
+    }
+
+    Vec_ParseChunk_cleanUp(&parse.chunks);
+
+    Vec_ASTNodePtr_shrink(&statements);
+
+    if(ASTNode_create(node, Module, 0, 0) != 0) {
+
+        for(size_t i = 0; i < statements.count; i++) ASTNode_cleanUp(statements.data[i]);
+
+        Vec_ASTNodePtr_cleanUp(&statements);
+
+        return "Unable to allocate memory for a module node";
+    }
+
+    (*node)->childCount = statements.count;
+    (*node)->children = statements.data;
+
+    return error;
 }
 
+//Lazy parses stay on the calling thread, their reachability walk needs
+//every pending body in one place
+char* Module_parse(Scanner scanner, ParseOptions* options, ASTNode** node) {
+
+    char* error;
+    ParseState state = { options->stats };
 
+    scanner->parse = &state;
+
+    if(options->lazy) error = Module_tryParseLazy(scanner, node, 0);
+    else if(options->threadCount > 1) error = Module_tryParseParallel(scanner, node, options->threadCount, 0);
+    else error = Module_tryParse(scanner, node, 0);
+
+    scanner->parse = 0;
+
+    return error;
+}
@@ -5,6 +5,44 @@
 #include "scanner.h"
 #include <stdio.h>
 
+//The rules the parser counts attempts at. Every choice between rules is
+//made from the next token, so a rule only fails where the source is wrong
+typedef enum ParseRule_e {
+    RuleNumberLiteral,
+    RuleStringLiteral,
+    RuleSymbol,
+    RuleValue,
+    RuleOperator,
+    RuleParameter,
+    RuleParameterList,
+    RuleLambda,
+    RuleArgumentList,
+    RuleInvocation,
+    RuleExpression,
+    RuleDeclaration,
+    RuleExpressionStatement,
+    RuleStatement,
+    PARSE_RULE_COUNT
+} ParseRule;
+
+typedef struct ParseStats_s {
+    long attempts[PARSE_RULE_COUNT];
+    long failures[PARSE_RULE_COUNT];
+} ParseStats;
+
+//How Module_parse reads a source. More than one thread splits a large
+//source at its top-level ';' and parses the pieces side by side. Stats,
+//when given, add up the rule attempts of every thread
+typedef struct ParseOptions_s {
+    int lazy;
+    int threadCount;
+    ParseStats* stats;
+} ParseOptions;
+
+extern char* ParseRuleNames[PARSE_RULE_COUNT];
+
+void ParseStats_print(ParseStats* stats);
+
 char* StringLiteral_tryParse(Scanner scanner, ASTNode** node, int level);
 
 char* Value_tryParse(Scanner scanner, ASTNode** node, int level);
@@ -31,4 +69,10 @@ char* Statement_tryParse(Scanner scanner, ASTNode** node, int level);
 
 char* Module_tryParse(Scanner scanner, ASTNode** node, int level);
 
+char* Module_tryParseLazy(Scanner scanner, ASTNode** node, int level);
+
+char* Module_tryParseParallel(Scanner scanner, ASTNode** node, int thread_count, int level);
+
+char* Module_parse(Scanner scanner, ParseOptions* options, ASTNode** node);
+
 #endif //PARSE_H
@@ -0,0 +1,102 @@
+#include "parsecache.h"
+#include "parse.h"
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct ParseCacheEntry_s {
+    unsigned long long hash;
+    char* source;
+    size_t length;
+    int lazy;
+    ASTNode* module;
+    unsigned long lastUse;
+} ParseCacheEntry;
+
+//Parsed modules are kept pristine and keyed by their source text and how it
+//was parsed, callers always get a clone they are free to transform
+static ParseCacheEntry* parse_cache = 0;
+static int parse_cache_count = 0;
+static int parse_cache_capacity = 0;
+static unsigned long parse_cache_clock = 0;
+
+void ParseCache_enable(int max_entries) {
+
+    parse_cache = (ParseCacheEntry*)calloc(max_entries, sizeof(ParseCacheEntry));
+    parse_cache_capacity = parse_cache == 0 ? 0 : max_entries;
+}
+
+char* ParseCache_parseSource(char* source, size_t length, ParseOptions* options, ASTNode** module) {
+
+    ScannerSource scanner;
+
+    Scanner_init(&scanner, source, length);
+
+    return Module_parse(&scanner, options, module);
+}
+
+char* ParseCache_parse(FILE* in_file, ParseOptions* options, ASTNode** module) {
+
+    char* error;
+    char* source;
+    size_t length;
+    unsigned long long hash = 14695981039346656037ull;
+    ParseCacheEntry* entry = 0;
+
+    *module = 0;
+
+    if((error = Scanner_readAll(in_file, &source, &length)) != 0) return error;
+
+    if(parse_cache_capacity == 0) {
+
+        error = ParseCache_parseSource(source, length, options, module);
+        free(source);
+
+        return error;
+    }
+
+    for(size_t i = 0; i < length; i++) hash = (hash ^ (unsigned char)source[i]) * 1099511628211ull;
+
+    for(int i = 0; i < parse_cache_count; i++) {
+
+        ParseCacheEntry* candidate = &parse_cache[i];
+
+        if(candidate->hash == hash && candidate->length == length && candidate->lazy == options->lazy &&
+            memcmp(candidate->source, source, length) == 0) {
+
+            free(source);
+            candidate->lastUse = ++parse_cache_clock;
+
+            return ASTNode_clone(candidate->module, module);
+        }
+    }
+
+    if((error = ParseCache_parseSource(source, length, options, module)) != 0) {
+
+        free(source);
+
+        return error;
+    }
+
+    //Evict the least recently used module once the cache is full
+    if(parse_cache_count < parse_cache_capacity) {
+
+        entry = &parse_cache[parse_cache_count++];
+    } else {
+
+        entry = &parse_cache[0];
+
+        for(int i = 1; i < parse_cache_count; i++) if(parse_cache[i].lastUse < entry->lastUse) entry = &parse_cache[i];
+
+        free(entry->source);
+        ASTNode_cleanUp(entry->module);
+    }
+
+    entry->hash = hash;
+    entry->source = source;
+    entry->length = length;
+    entry->lazy = options->lazy;
+    entry->module = *module;
+    entry->lastUse = ++parse_cache_clock;
+
+    return ASTNode_clone(entry->module, module);
+}
@@ -0,0 +1,16 @@
+#ifndef PARSECACHE_H
+#define PARSECACHE_H
+
+#include "ast.h"
+#include "parse.h"
+#include <stdio.h>
+
+void ParseCache_enable(int max_entries);
+
+//A lazy parse only parses the lambda bodies the rest of the module reaches
+//and drops the declarations of the others
+char* ParseCache_parse(FILE* in_file, ParseOptions* options, ASTNode** module);
+
+char* ParseCache_parseSource(char* source, size_t length, ParseOptions* options, ASTNode** module);
+
+#endif //PARSECACHE_H
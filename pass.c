@@ -0,0 +1,231 @@
+#include "pass.h"
+#include "analysis.h"
+#include "callgraph.h"
+#include "naming.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+char* Pass_purity(ASTNode* module, PassContext* context, PassStats* stats) {
+
+    return Module_analyzePurity(module, stats);
+}
+
+char* Pass_fold(ASTNode* module, PassContext* context, PassStats* stats) {
+
+    return Module_foldConstants(module, &context->fold, stats);
+}
+
+char* Pass_specialize(ASTNode* module, PassContext* context, PassStats* stats) {
+
+    context->specialize.fold = context->fold;
+
+    return Module_specialize(module, &context->specialize, stats);
+}
+
+char* Pass_memoize(ASTNode* module, PassContext* context, PassStats* stats) {
+
+    return Module_memoize(module, &context->memoize, stats);
+}
+
+char* Pass_layout(ASTNode* module, PassContext* context, PassStats* stats) {
+
+    return Module_layOutLambdas(module, stats);
+}
+
+PassInfo PassRegistry[] = {
+    { "purity",     PassAnalysis,  Pass_purity,     "",       ""       },
+    { "fold",       PassTransform, Pass_fold,       "purity", ""       },
+    { "specialize", PassTransform, Pass_specialize, "purity", "purity" },
+    { "memoize",    PassTransform, Pass_memoize,    "purity", ""       },
+    { "layout",     PassTransform, Pass_layout,     "",       ""       }
+};
+
+#define PASS_REGISTRY_COUNT (sizeof(PassRegistry) / sizeof(PassRegistry[0]))
+
+char* PassOptimizationLevel[] = {
+    "",
+    "fold",
+    "fold,specialize,memoize,layout"
+};
+
+char* PassRegistry_lookUp(char* name, int length, PassInfo** info) {
+
+    for(int i = 0; i < PASS_REGISTRY_COUNT; i++) {
+
+        if(strlen(PassRegistry[i].name) == length && strncmp(PassRegistry[i].name, name, length) == 0) {
+
+            *info = &PassRegistry[i];
+
+            return 0;
+        }
+    }
+
+    return "Unknown optimization pass name";
+}
+
+int PassNameList_contains(char* list, char* name) {
+
+    int length = strlen(name);
+
+    while(*list != 0) {
+
+        char* end = strchr(list, ',');
+        int item_length = end == 0 ? strlen(list) : end - list;
+
+        if(item_length == length && strncmp(list, name, length) == 0) return 1;
+
+        if(end == 0) break;
+
+        list = end + 1;
+    }
+
+    return 0;
+}
+
+void PassManager_init(PassManager* manager) {
+
+    Vec_PassInfoPtr_init(&manager->pipeline, 0);
+    Vec_PassInfoPtr_init(&manager->validAnalyses, 0);
+    manager->printStats = 0;
+}
+
+char* PassManager_usePreset(PassManager* manager, int level) {
+
+    if(level < 0 || level >= sizeof(PassOptimizationLevel) / sizeof(PassOptimizationLevel[0])) {
+
+        return "Unsupported optimization level";
+    }
+
+    return PassManager_usePipeline(manager, PassOptimizationLevel[level]);
+}
+
+char* PassManager_usePipeline(PassManager* manager, char* pass_names) {
+
+    char* error;
+    PassInfo* info;
+
+    manager->pipeline.count = 0;
+
+    while(*pass_names != 0) {
+
+        char* end = strchr(pass_names, ',');
+        int length = end == 0 ? strlen(pass_names) : end - pass_names;
+
+        if((error = PassRegistry_lookUp(pass_names, length, &info)) != 0) return error;
+
+        if((error = Vec_PassInfoPtr_add(&manager->pipeline, info)) != 0) return error;
+
+        if(end == 0) break;
+
+        pass_names = end + 1;
+    }
+
+    return 0;
+}
+
+char* PassManager_addPass(PassManager* manager, char* pass_name) {
+
+    char* error;
+    PassInfo* info;
+
+    if((error = PassRegistry_lookUp(pass_name, strlen(pass_name), &info)) != 0) return error;
+
+    return Vec_PassInfoPtr_add(&manager->pipeline, info);
+}
+
+int PassManager_hasPass(PassManager* manager, char* pass_name) {
+
+    for(int i = 0; i < manager->pipeline.count; i++) {
+
+        if(strcmp(manager->pipeline.data[i]->name, pass_name) == 0) return 1;
+    }
+
+    return 0;
+}
+
+int PassManager_isValid(PassManager* manager, PassInfo* info) {
+
+    for(int i = 0; i < manager->validAnalyses.count; i++) {
+
+        if(manager->validAnalyses.data[i] == info) return 1;
+    }
+
+    return 0;
+}
+
+double Pass_now() {
+
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return now.tv_sec * 1000.0 + now.tv_nsec / 1000000.0;
+}
+
+char* PassManager_runPass(PassManager* manager, PassInfo* info, ASTNode* module, PassContext* context) {
+
+    char* error;
+    PassStats stats = { 0, 0 };
+    double start;
+
+    //Analyses stay valid until a transform that declares it invalidates them runs
+    if(info->kind == PassAnalysis && PassManager_isValid(manager, info)) return 0;
+
+    for(int i = 0; i < PASS_REGISTRY_COUNT; i++) {
+
+        if(!PassNameList_contains(info->requires, PassRegistry[i].name)) continue;
+
+        if((error = PassManager_runPass(manager, &PassRegistry[i], module, context)) != 0) return error;
+    }
+
+    if(manager->printStats) start = Pass_now();
+
+    if((error = info->run(module, context, &stats)) != 0) return error;
+
+    if(manager->printStats) {
+
+        printf("%-12s %10.3f ms %10ld visited %10ld changed\n",
+            info->name, Pass_now() - start, stats.nodesVisited, stats.nodesChanged);
+    }
+
+    if(info->kind == PassAnalysis) return Vec_PassInfoPtr_add(&manager->validAnalyses, info);
+
+    for(int i = 0; i < manager->validAnalyses.count; ) {
+
+        PassInfo* analysis = manager->validAnalyses.data[i];
+
+        if(PassNameList_contains(info->invalidates, analysis->name)) {
+
+            manager->validAnalyses.data[i] = manager->validAnalyses.data[--manager->validAnalyses.count];
+        } else {
+
+            i++;
+        }
+    }
+
+    return 0;
+}
+
+char* PassManager_run(PassManager* manager, ASTNode* module, PassContext* context) {
+
+    char* error;
+
+    for(int i = 0; i < manager->pipeline.count; i++) {
+
+        if((error = PassManager_runPass(manager, manager->pipeline.data[i], module, context)) != 0) {
+
+            return error;
+        }
+    }
+
+    //Names depend on the final bodies, so they are only given out once the
+    //pipeline is done rewriting them
+    return Module_nameLambdas(module);
+}
+
+void PassManager_cleanUp(PassManager* manager) {
+
+    Vec_PassInfoPtr_cleanUp(&manager->pipeline);
+    Vec_PassInfoPtr_cleanUp(&manager->validAnalyses);
+}
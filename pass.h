@@ -0,0 +1,62 @@
+#ifndef PASS_H
+#define PASS_H
+
+struct PassInfo_s;
+struct PassContext_s;
+struct PassManager_s;
+
+#include "ast.h"
+#include "fold.h"
+#include "specialize.h"
+#include "memoize.h"
+#include "vec.h"
+
+typedef enum {
+    PassAnalysis,
+    PassTransform
+} PassKind;
+
+typedef struct PassContext_s {
+    FoldOptions fold;
+    SpecializeOptions specialize;
+    MemoizeOptions memoize;
+} PassContext;
+
+typedef char* (*PassRunner)(ASTNode*, struct PassContext_s*, PassStats*);
+
+//requires and invalidates are comma separated lists of analysis pass names
+typedef struct PassInfo_s {
+    char* name;
+    PassKind kind;
+    PassRunner run;
+    char* requires;
+    char* invalidates;
+} PassInfo;
+
+typedef PassInfo* PassInfoPtr;
+
+VEC_DECLARE(PassInfoPtr)
+
+typedef struct PassManager_s {
+    VEC(PassInfoPtr) pipeline;
+    VEC(PassInfoPtr) validAnalyses;
+    int printStats;
+} PassManager;
+
+void PassManager_init(PassManager* manager);
+
+char* PassManager_usePreset(PassManager* manager, int level);
+
+char* PassManager_usePipeline(PassManager* manager, char* pass_names);
+
+char* PassManager_addPass(PassManager* manager, char* pass_name);
+
+int PassManager_hasPass(PassManager* manager, char* pass_name);
+
+char* PassManager_run(PassManager* manager, ASTNode* module, PassContext* context);
+
+void PassManager_cleanUp(PassManager* manager);
+
+double Pass_now();
+
+#endif //PASS_H
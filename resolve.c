@@ -0,0 +1,77 @@
+#include "resolve.h"
+#include "analysis.h"
+
+int Module_globalCount(ASTNode* module) {
+
+    int count = 0;
+
+    for(int i = 0; i < module->childCount; i++) count += module->children[i]->type == Declaration;
+
+    return count;
+}
+
+//Global slots are numbered by the position of the declaration among the
+//module's declarations, the index hands them out with each name
+char* ASTNode_resolveSymbols(DeclarationIndex* index, ASTNode* lambda, ASTNode* node, PassStats* stats) {
+
+    char* error;
+    int slot;
+    DeclarationIndexEntry* global;
+
+    if(node == 0) return 0;
+
+    stats->nodesVisited++;
+
+    if(node->type == Lambda) lambda = node;
+
+    if(node->type == Symbol) {
+
+        String* name = (String*)node->SN_TEXT;
+
+        node->SN_LAMBDA = 0;
+
+        if(lambda != 0 && (slot = ASTLambdaNode_findParameter(lambda, name)) >= 0) {
+
+            node->SN_KIND = (void*)SymbolParameter;
+        } else if((global = DeclarationIndex_find(index, name)) != 0) {
+
+            node->SN_KIND = (void*)SymbolGlobal;
+            slot = global->slot;
+
+            if(ASTDeclarationNode_IsLambda(global->declaration)) node->SN_LAMBDA = global->declaration->DN_INITIALIZER;
+        } else {
+
+            node->SN_KIND = (void*)SymbolExternal;
+            slot = 0;
+        }
+
+        node->SN_SLOT = (void*)(size_t)slot;
+        stats->nodesChanged++;
+
+        return 0;
+    }
+
+    for(int i = 0; i < node->childCount; i++) {
+
+        if((error = ASTNode_resolveSymbols(index, lambda, node->children[i], stats)) != 0) return error;
+    }
+
+    return 0;
+}
+
+//Binds every symbol to a parameter index of its innermost lambda, a global
+//declaration slot, or marks it as external for the backend to link. Globals
+//declared with a lambda also record it so backends can call it directly
+char* Module_resolveSymbols(ASTNode* module, PassStats* stats) {
+
+    char* error;
+    DeclarationIndex index;
+
+    if((error = DeclarationIndex_build(&index, module)) != 0) return error;
+
+    error = ASTNode_resolveSymbols(&index, 0, module, stats);
+
+    DeclarationIndex_cleanUp(&index);
+
+    return error;
+}
@@ -0,0 +1,10 @@
+#ifndef RESOLVE_H
+#define RESOLVE_H
+
+#include "ast.h"
+
+char* Module_resolveSymbols(ASTNode* module, PassStats* stats);
+
+int Module_globalCount(ASTNode* module);
+
+#endif //RESOLVE_H
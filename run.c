@@ -0,0 +1,300 @@
+#define _GNU_SOURCE
+#include "run.h"
+#include "pass.h"
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define RUN_MAX_COMPILER_ARGS 64
+#define RUN_WRITE_CHUNK 65536
+#define RUN_TEMPORARY_TEMPLATE "/tmp/yc-XXXXXX"
+
+void RunOptions_init(RunOptions* options) {
+
+    char* compiler = getenv("CC");
+    char* flags = getenv("CFLAGS");
+
+    options->compiler = compiler != 0 && compiler[0] != 0 ? compiler : "cc";
+    options->flags = flags != 0 ? flags : "-O1";
+    options->language = "c";
+    options->cacheDir = 0;
+    options->useCache = 1;
+    options->printTimes = 0;
+}
+
+unsigned long long Run_hash(unsigned long long hash, char* data, size_t length) {
+
+    for(size_t i = 0; i < length; i++) hash = (hash ^ (unsigned char)data[i]) * 1099511628211ull;
+
+    return hash;
+}
+
+//Creates each missing directory along path, like mkdir -p
+char* Run_makeDirectories(char* path) {
+
+    char* copy = strdup(path);
+
+    if(copy == 0) return "Failed to allocate space for the cache path";
+
+    for(char* c = copy + 1; ; c++) {
+
+        if(*c != '/' && *c != 0) continue;
+
+        char saved = *c;
+
+        *c = 0;
+
+        if(mkdir(copy, 0755) != 0 && errno != EEXIST) {
+
+            free(copy);
+
+            return "Unable to create the binary cache directory";
+        }
+
+        if((*c = saved) == 0) break;
+    }
+
+    free(copy);
+
+    return 0;
+}
+
+char* Run_cacheDirectory(RunOptions* options, char** directory) {
+
+    char* base;
+    char* error;
+
+    if(options->cacheDir != 0) {
+
+        *directory = strdup(options->cacheDir);
+    } else if((base = getenv("XDG_CACHE_HOME")) != 0 && base[0] != 0) {
+
+        if(asprintf(directory, "%s/yc", base) < 0) *directory = 0;
+    } else if((base = getenv("HOME")) != 0 && base[0] != 0) {
+
+        if(asprintf(directory, "%s/.cache/yc", base) < 0) *directory = 0;
+    } else {
+
+        *directory = strdup("/tmp/yc-cache");
+    }
+
+    if(*directory == 0) return "Failed to allocate space for the cache path";
+
+    if((error = Run_makeDirectories(*directory)) != 0) {
+
+        free(*directory);
+        *directory = 0;
+
+        return error;
+    }
+
+    return 0;
+}
+
+//Spawns the compiler reading from a pipe and feeds it the rendered output in
+//chunks, so the compiler parses the start of the translation unit while the
+//rest is still being written
+char* Run_compile(String* code, RunOptions* options, char* out_path) {
+
+    char* args[RUN_MAX_COMPILER_ARGS + 8];
+    char* flags = strdup(options->flags);
+    char* saveptr;
+    int argc = 0;
+    int pipe_fds[2];
+    int status;
+    pid_t pid;
+
+    if(flags == 0) return "Failed to allocate space for compiler flags";
+
+    args[argc++] = options->compiler;
+
+    for(char* flag = strtok_r(flags, " \t", &saveptr); flag != 0; flag = strtok_r(0, " \t", &saveptr)) {
+
+        if(argc == RUN_MAX_COMPILER_ARGS) {
+
+            free(flags);
+
+            return "Too many compiler flags";
+        }
+
+        args[argc++] = flag;
+    }
+
+    args[argc++] = "-x";
+    args[argc++] = options->language;
+    args[argc++] = "-";
+    args[argc++] = "-o";
+    args[argc++] = out_path;
+    args[argc] = 0;
+
+    if(pipe(pipe_fds) != 0) {
+
+        free(flags);
+
+        return "Unable to create a pipe to the compiler";
+    }
+
+    if((pid = fork()) < 0) {
+
+        free(flags);
+        close(pipe_fds[0]);
+        close(pipe_fds[1]);
+
+        return "Unable to start the compiler";
+    }
+
+    if(pid == 0) {
+
+        dup2(pipe_fds[0], STDIN_FILENO);
+        close(pipe_fds[0]);
+        close(pipe_fds[1]);
+        execvp(args[0], args);
+        _exit(127);
+    }
+
+    free(flags);
+    close(pipe_fds[0]);
+
+    //A compiler that exits early shows up as a failed status rather than a SIGPIPE
+    void (*previous_handler)(int) = signal(SIGPIPE, SIG_IGN);
+
+    for(size_t written = 0; written < code->length;) {
+
+        size_t chunk = code->length - written < RUN_WRITE_CHUNK ? code->length - written : RUN_WRITE_CHUNK;
+        ssize_t count = write(pipe_fds[1], &code->data[written], chunk);
+
+        if(count < 0 && errno == EINTR) continue;
+
+        if(count <= 0) break;
+
+        written += (size_t)count;
+    }
+
+    close(pipe_fds[1]);
+    signal(SIGPIPE, previous_handler);
+
+    while(waitpid(pid, &status, 0) < 0) if(errno != EINTR) return "Unable to wait for the compiler";
+
+    if(!WIFEXITED(status) || WEXITSTATUS(status) != 0) return "The C compiler failed to build the rendered output";
+
+    return 0;
+}
+
+char* Run_execute(char* path, char* program_name, int argc, char** argv, int* exit_status) {
+
+    char* args[argc + 2];
+    int status;
+    pid_t pid;
+
+    args[0] = program_name;
+
+    for(int i = 0; i < argc; i++) args[i + 1] = argv[i];
+
+    args[argc + 1] = 0;
+
+    fflush(stdout);
+
+    if((pid = fork()) < 0) return "Unable to start the compiled program";
+
+    if(pid == 0) {
+
+        execv(path, args);
+        _exit(127);
+    }
+
+    while(waitpid(pid, &status, 0) < 0) if(errno != EINTR) return "Unable to wait for the compiled program";
+
+    *exit_status = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+
+    return 0;
+}
+
+//Builds the rendered module with the configured compiler and runs it. Binaries
+//are cached under the hash of the rendered code together with the compiler,
+//flags and language, so an unchanged module skips compilation entirely.
+//Uncached builds go to a fresh directory only this process can write to
+char* Module_compileAndRun(ASTNode* module, TemplateConfig* config, RunOptions* options,
+    char* program_name, int argc, char** argv, int* exit_status) {
+
+    char* error;
+    char* directory = 0;
+    char* binary_path = 0;
+    char* build_path = 0;
+    char temporary[] = RUN_TEMPORARY_TEMPLATE;
+    int made_temporary = 0;
+    String* code;
+    unsigned long long hash = 14695981039346656037ull;
+    double start = Pass_now();
+    double rendered, compiled;
+    int cached = 0;
+
+    if((error = ASTNode_renderTemplate(module, config, &code)) != 0) return error;
+
+    rendered = Pass_now();
+
+    hash = Run_hash(hash, code->data, code->length);
+    hash = Run_hash(hash, options->compiler, strlen(options->compiler) + 1);
+    hash = Run_hash(hash, options->flags, strlen(options->flags) + 1);
+    hash = Run_hash(hash, options->language, strlen(options->language) + 1);
+
+    if(options->useCache) {
+
+        if((error = Run_cacheDirectory(options, &directory)) == 0) {
+
+            if(asprintf(&binary_path, "%s/%016llx", directory, hash) < 0) binary_path = 0;
+            if(asprintf(&build_path, "%s/%016llx.%i.tmp", directory, hash, (int)getpid()) < 0) build_path = 0;
+        }
+    } else if(mkdtemp(temporary) == 0) {
+
+        error = "Unable to create a temporary directory for the binary";
+    } else {
+
+        made_temporary = 1;
+
+        if(asprintf(&build_path, "%s/%016llx", temporary, hash) < 0) build_path = 0;
+    }
+
+    free(directory);
+
+    if(error == 0 && (build_path == 0 || (options->useCache && binary_path == 0))) {
+
+        error = "Failed to allocate space for the binary path";
+    }
+
+    if(error == 0 && binary_path != 0 && access(binary_path, X_OK) == 0) {
+
+        cached = 1;
+    } else if(error == 0 && (error = Run_compile(code, options, build_path)) == 0 && binary_path != 0) {
+
+        //Renaming into place keeps concurrent runs from seeing a partially written binary
+        if(rename(build_path, binary_path) != 0) error = "Unable to move the built binary into the cache";
+    }
+
+    String_cleanUp(code);
+
+    compiled = Pass_now();
+
+    if(options->printTimes) {
+
+        fprintf(stderr, "%-12s %10.3f ms\n", "render", rendered - start);
+        fprintf(stderr, "%-12s %10.3f ms%s\n", "compile", compiled - rendered, cached ? " (cached)" : "");
+    }
+
+    if(error == 0) {
+
+        error = Run_execute(binary_path != 0 ? binary_path : build_path, program_name, argc, argv, exit_status);
+    }
+
+    if(build_path != 0 && (binary_path == 0 || error != 0)) unlink(build_path);
+    if(made_temporary) rmdir(temporary);
+
+    free(binary_path);
+    free(build_path);
+
+    return error;
+}
@@ -0,0 +1,21 @@
+#ifndef RUN_H
+#define RUN_H
+
+#include "ast.h"
+#include "template.h"
+
+typedef struct RunOptions_s {
+    char* compiler;
+    char* flags;
+    char* language;
+    char* cacheDir;
+    int useCache;
+    int printTimes;
+} RunOptions;
+
+void RunOptions_init(RunOptions* options);
+
+char* Module_compileAndRun(ASTNode* module, TemplateConfig* config, RunOptions* options,
+    char* program_name, int argc, char** argv, int* exit_status);
+
+#endif //RUN_H
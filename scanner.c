@@ -1,65 +1,394 @@
 #include "scanner.h"
 #include "debug.h"
+#include <stdlib.h>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define SCANNER_SIMD 1
+#define SCANNER_SHORT_RUN 8
+#else
+#define SCANNER_SIMD 0
+#endif
+
+void Scanner_init(ScannerSource* source, char* data, size_t length) {
+
+    source->data = data;
+    source->length = length;
+    source->position = 0;
+    source->parse = 0;
+}
+
+char* Scanner_readAll(FILE* in_file, char** data, size_t* length) {
+
+    size_t capacity = 4096;
+    size_t count = 0;
+    size_t read;
+    char* buffer = (char*)malloc(capacity);
+
+    if(buffer == 0) return "Failed to allocate space for module source";
+
+    while((read = fread(&buffer[count], 1, capacity - count, in_file)) > 0) {
+
+        count += read;
+
+        if(count < capacity) continue;
+
+        char* grown = (char*)realloc(buffer, capacity * 2);
+
+        if(grown == 0) {
+
+            free(buffer);
 
-int _Scanner_peekMatch(Scanner s, char c) {
+            return "Failed to allocate space for module source";
+        }
+
+        buffer = grown;
+        capacity *= 2;
+    }
+
+    *data = buffer;
+    *length = count;
+
+    return 0;
+}
 
-    fpos_t initial;
-    char actual;
+size_t Scanner_findQuoteOrEscapeScalar(char* data, size_t length) {
 
-    fgetpos(s, &initial);
+    size_t i = 0;
 
-    if(fread(&actual, 1, 1, s) != 1) return 0;
+    while(i < length && data[i] != '"' && data[i] != '\\') i++;
 
-    int result = actual == c;
+    return i;
+}
 
-    fsetpos(s, &initial);
+int Scanner_isIdentifierCharacter(char c) {
 
-    return result;
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+size_t Scanner_identifierLengthScalar(char* data, size_t length) {
+
+    size_t i = 0;
+
+    while(i < length && Scanner_isIdentifierCharacter(data[i])) i++;
+
+    return i;
+}
+
+//Anything up to and including a space is whitespace. Bytes past 0x7f are
+//negative chars and count as well, as they always have
+size_t Scanner_whitespaceLengthScalar(char* data, size_t length) {
+
+    size_t i = 0;
+
+    while(i < length && data[i] <= 0x20) i++;
+
+    return i;
+}
+
+#if SCANNER_SIMD
+
+//Whole vectors are only loaded while they fit, the scalar loops finish the
+//last few bytes so nothing is read past the end of the source. Identifier
+//and whitespace runs are mostly short, so their first few bytes are checked
+//one at a time before a vector is worth setting up. The AVX2 versions never
+//fall back to the SSE2 ones, mixing the two encodings stalls some CPUs
+
+size_t Scanner_findQuoteOrEscapeSSE2(char* data, size_t length) {
+
+    __m128i quote = _mm_set1_epi8('"');
+    __m128i escape = _mm_set1_epi8('\\');
+    size_t i = 0;
+
+    for(; i + 16 <= length; i += 16) {
+
+        __m128i chunk = _mm_loadu_si128((__m128i*)&data[i]);
+        int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, escape)));
+
+        if(mask != 0) return i + __builtin_ctz(mask);
+    }
+
+    return i + Scanner_findQuoteOrEscapeScalar(&data[i], length - i);
+}
+
+//Bytes past 0x7f compare as negative, so they never pass the range checks.
+//Or-ing in 0x20 folds upper case letters onto lower case ones
+size_t Scanner_identifierLengthSSE2(char* data, size_t length) {
+
+    size_t i = 0;
+
+    for(; i < SCANNER_SHORT_RUN; i++) if(i == length || !Scanner_isIdentifierCharacter(data[i])) return i;
+
+    for(; i + 16 <= length; i += 16) {
+
+        __m128i chunk = _mm_loadu_si128((__m128i*)&data[i]);
+        __m128i folded = _mm_or_si128(chunk, _mm_set1_epi8(0x20));
+        __m128i letter = _mm_and_si128(_mm_cmpgt_epi8(folded, _mm_set1_epi8('a' - 1)),
+            _mm_cmplt_epi8(folded, _mm_set1_epi8('z' + 1)));
+        __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(chunk, _mm_set1_epi8('0' - 1)),
+            _mm_cmplt_epi8(chunk, _mm_set1_epi8('9' + 1)));
+        __m128i underscore = _mm_cmpeq_epi8(chunk, _mm_set1_epi8('_'));
+        int mask = _mm_movemask_epi8(_mm_or_si128(_mm_or_si128(letter, digit), underscore));
+
+        if(mask != 0xffff) return i + __builtin_ctz(~mask);
+    }
+
+    return i + Scanner_identifierLengthScalar(&data[i], length - i);
+}
+
+size_t Scanner_whitespaceLengthSSE2(char* data, size_t length) {
+
+    size_t i = 0;
+
+    for(; i < SCANNER_SHORT_RUN; i++) if(i == length || data[i] > 0x20) return i;
+
+    for(; i + 16 <= length; i += 16) {
+
+        __m128i chunk = _mm_loadu_si128((__m128i*)&data[i]);
+        int mask = _mm_movemask_epi8(_mm_cmpgt_epi8(chunk, _mm_set1_epi8(0x20)));
+
+        if(mask != 0) return i + __builtin_ctz(mask);
+    }
+
+    return i + Scanner_whitespaceLengthScalar(&data[i], length - i);
+}
+
+__attribute__((target("avx2")))
+size_t Scanner_findQuoteOrEscapeAVX2(char* data, size_t length) {
+
+    __m256i quote = _mm256_set1_epi8('"');
+    __m256i escape = _mm256_set1_epi8('\\');
+    size_t i = 0;
+
+    for(; i + 32 <= length; i += 32) {
+
+        __m256i chunk = _mm256_loadu_si256((__m256i*)&data[i]);
+        unsigned mask = (unsigned)_mm256_movemask_epi8(
+            _mm256_or_si256(_mm256_cmpeq_epi8(chunk, quote), _mm256_cmpeq_epi8(chunk, escape)));
+
+        if(mask != 0) return i + __builtin_ctz(mask);
+    }
+
+    return i + Scanner_findQuoteOrEscapeScalar(&data[i], length - i);
+}
+
+__attribute__((target("avx2")))
+size_t Scanner_identifierLengthAVX2(char* data, size_t length) {
+
+    size_t i = 0;
+
+    for(; i < SCANNER_SHORT_RUN; i++) if(i == length || !Scanner_isIdentifierCharacter(data[i])) return i;
+
+    for(; i + 32 <= length; i += 32) {
+
+        __m256i chunk = _mm256_loadu_si256((__m256i*)&data[i]);
+        __m256i folded = _mm256_or_si256(chunk, _mm256_set1_epi8(0x20));
+        __m256i letter = _mm256_and_si256(_mm256_cmpgt_epi8(folded, _mm256_set1_epi8('a' - 1)),
+            _mm256_cmpgt_epi8(_mm256_set1_epi8('z' + 1), folded));
+        __m256i digit = _mm256_and_si256(_mm256_cmpgt_epi8(chunk, _mm256_set1_epi8('0' - 1)),
+            _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), chunk));
+        __m256i underscore = _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('_'));
+        unsigned mask = (unsigned)_mm256_movemask_epi8(_mm256_or_si256(_mm256_or_si256(letter, digit), underscore));
+
+        if(mask != 0xffffffffu) return i + __builtin_ctz(~mask);
+    }
+
+    return i + Scanner_identifierLengthScalar(&data[i], length - i);
+}
+
+__attribute__((target("avx2")))
+size_t Scanner_whitespaceLengthAVX2(char* data, size_t length) {
+
+    size_t i = 0;
+
+    for(; i < SCANNER_SHORT_RUN; i++) if(i == length || data[i] > 0x20) return i;
+
+    for(; i + 32 <= length; i += 32) {
+
+        __m256i chunk = _mm256_loadu_si256((__m256i*)&data[i]);
+        unsigned mask = (unsigned)_mm256_movemask_epi8(_mm256_cmpgt_epi8(chunk, _mm256_set1_epi8(0x20)));
+
+        if(mask != 0) return i + __builtin_ctz(mask);
+    }
+
+    return i + Scanner_whitespaceLengthScalar(&data[i], length - i);
+}
+
+#endif
+
+//Fastest first, the scalar searches work everywhere
+const ScannerSearches ScannerSearchesFor[] = {
+#if SCANNER_SIMD
+    { "avx2", "avx2", Scanner_findQuoteOrEscapeAVX2, Scanner_identifierLengthAVX2, Scanner_whitespaceLengthAVX2 },
+    { "sse2", "sse2", Scanner_findQuoteOrEscapeSSE2, Scanner_identifierLengthSSE2, Scanner_whitespaceLengthSSE2 },
+#endif
+    { "scalar", 0, Scanner_findQuoteOrEscapeScalar, Scanner_identifierLengthScalar, Scanner_whitespaceLengthScalar },
+    { 0 }
+};
+
+static const ScannerSearches* scanner_searches = 0;
+
+int ScannerSearches_supported(const ScannerSearches* searches) {
+
+    if(searches->cpuFeature == 0) return 1;
+
+#if SCANNER_SIMD
+    __builtin_cpu_init();
+
+    if(strcmp(searches->cpuFeature, "avx2") == 0) return __builtin_cpu_supports("avx2");
+    if(strcmp(searches->cpuFeature, "sse2") == 0) return __builtin_cpu_supports("sse2");
+#endif
+
+    return 0;
+}
+
+//Meant to be called before any thread starts scanning
+char* Scanner_useSearches(char* name) {
+
+    for(const ScannerSearches* searches = ScannerSearchesFor; searches->name != 0; searches++) {
+
+        if(name != 0 && strcmp(searches->name, name) != 0) continue;
+
+        if(!ScannerSearches_supported(searches)) {
+
+            if(name != 0) return "The CPU does not support those scanner searches";
+
+            continue;
+        }
+
+        scanner_searches = searches;
+
+        return 0;
+    }
+
+    return "Unknown scanner searches";
+}
+
+//Picked once at load time, before any thread can be scanning
+__attribute__((constructor)) static void Scanner_selectSearches() {
+
+    Scanner_useSearches(0);
+}
+
+//Offset of the first '"' or '\' in data, or length when there is none
+size_t Scanner_findQuoteOrEscape(char* data, size_t length) {
+
+    return scanner_searches->findQuoteOrEscape(data, length);
+}
+
+//Number of leading bytes of data that are letters, digits or underscores
+size_t Scanner_identifierLength(char* data, size_t length) {
+
+    return scanner_searches->identifierLength(data, length);
+}
+
+//Offset of the '"' closing a string literal whose contents start at data, or
+//at least length when it is never closed. An escape always takes the
+//character after it along, quotes included
+size_t Scanner_findStringEnd(char* data, size_t length) {
+
+    size_t end = 0;
+
+    while(1) {
+
+        end += Scanner_findQuoteOrEscape(&data[end], length - end);
+
+        if(end >= length || data[end] != '\\') return end;
+
+        end += 2;
+
+        if(end >= length) return end;
+    }
+}
+
+//Offset of the ';' ending the statement or lambda body data starts with,
+//found without parsing it. String literals and comments are skipped and
+//parentheses have to balance
+char* Scanner_findStatementEnd(char* data, size_t length, size_t* end) {
+
+    size_t i = 0;
+    int depth = 0;
+
+    while(i < length) {
+
+        if(data[i] == '"') {
+
+            i += 1 + Scanner_findStringEnd(&data[i + 1], length - i - 1);
+
+            if(i >= length) return "Encountered end of file inside of string";
+        } else if(data[i] == '/' && i + 1 < length && data[i + 1] == '/') {
+
+            char* newline = (char*)memchr(&data[i], '\n', length - i);
+
+            if(newline == 0) break;
+
+            i = newline - data;
+        } else if(data[i] == '(') {
+
+            depth++;
+        } else if(data[i] == ')') {
+
+            if(--depth < 0) return "Unbalanced ')' before the end of a statement";
+        } else if(data[i] == ';' && depth == 0) {
+
+            *end = i;
+
+            return 0;
+        }
+
+        i++;
+    }
+
+    return "Encountered end of file before the end of a statement";
+}
+
+//Moves past the newline ending the comment whose first '/' was just read
+void Scanner_skipComment(Scanner s) {
+
+    char* newline = (char*)memchr(&s->data[s->position], '\n', s->length - s->position);
+
+    s->position = newline == 0 ? s->length : (size_t)(newline - s->data) + 1;
 }
 
 ScanResult _Scanner_getc(Scanner s) {
 
-    ScannerDeclareHiddenLocals;
-    ScannerCheckpoint(s);
     ScanResult sr = { 0 };
 
-    sr.err = fread(&(sr.val), 1, 1, s) != 1;
+    if(s->position >= s->length) {
 
-    if(sr.err) {
+        sr.err = 1;
 
         DEBUG_PRINT("Scanner: EOF\n");
-    } else {
 
-        //Try to consume a comment
-        while(1) {
+        return sr;
+    }
 
-            if(sr.val != '/' || !_Scanner_peekMatch(s, '/')) break;
+    sr.val = s->data[s->position++];
 
-            while(1) {
+    //Try to consume a comment
+    while(sr.val == '/' && s->position < s->length && s->data[s->position] == '/') {
 
-                sr.err = fread(&(sr.val), 1, 1, s) != 1;
-                
-                if(sr.err) return sr;
+        Scanner_skipComment(s);
 
-                if(sr.val == '\n') {
+        if(s->position >= s->length) {
 
-                    sr.err = fread(&(sr.val), 1, 1, s) != 1;
+            sr.err = 1;
 
-                    break;
-                }
-            }
+            return sr;
         }
 
-        DEBUG_PRINTF("Scanner: '%c'\n", sr.val);
+        sr.val = s->data[s->position++];
     }
 
+    DEBUG_PRINTF("Scanner: '%c'\n", sr.val);
+
     return sr;
 }
 
-ScanResult _Scanner_GetNextImpl(Scanner s, fpos_t old_pos, char* expected, int expect) {
+ScanResult _Scanner_GetNextImpl(Scanner s, size_t old_pos, char* expected, int expect) {
 
     ScanResult sr = { .err = 0, .val = 0 };
-    
+
     for(int i = 0; ((expect >= 1 && i < expect) || (expect == 0 && i < 1) )&& !sr.err; i++) {
 
         sr = _Scanner_getc(s);
@@ -67,31 +396,26 @@ ScanResult _Scanner_GetNextImpl(Scanner s, fpos_t old_pos, char* expected, int e
         if(expected && (expected[i] != sr.val)) sr.err = 1;
     }
 
-    if(sr.err && (expect || expected)) fsetpos(s, &old_pos);
+    if(sr.err && (expect || expected)) s->position = old_pos;
 
     return sr;
 }
 
+//Skips whitespace a vector at a time and comments with memchr. A comment
+//runs up to and including its newline and stands for nothing at all
 void ScannerSkipWhitespace(Scanner s) {
-    
-    ScanResult sr = { 0 };
-    fpos_t last_pos;
-    
+
     while(1) {
 
-        fgetpos(s, &last_pos);
+        //Most calls start right on a token, which needs no vector at all
+        if(s->position < s->length && s->data[s->position] > 0x20 && s->data[s->position] != '/') return;
 
-        sr = _Scanner_getc(s);
+        s->position += scanner_searches->whitespaceLength(&s->data[s->position], s->length - s->position);
 
-        if(sr.err) return;
+        if(s->length - s->position < 2 || s->data[s->position] != '/' || s->data[s->position + 1] != '/') return;
 
-        if(sr.val > 0x20) {
-        
-            fsetpos(s, &last_pos);
-            
-            return;
-        }
+        s->position++;
+
+        Scanner_skipComment(s);
     }
 }
-
-
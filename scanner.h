@@ -4,37 +4,68 @@
 #include <stdio.h>
 #include <string.h>
 
-typedef FILE* Scanner;
+//The whole source sits in memory and the scanner is a position into it, so
+//checkpoints and rollbacks are plain assignments and tokens can be sliced
+//straight out of data. A module parse keeps the rest of its state in parse
+typedef struct ScannerSource_s {
+    char* data;
+    size_t length;
+    size_t position;
+    struct ParseState_s* parse;
+} ScannerSource;
+
+typedef ScannerSource* Scanner;
+
+//Each search returns how many leading bytes of data it accepts
+typedef size_t (*ScannerSearch)(char* data, size_t length);
+
+//One implementation of every byte search the scanner does. The fastest one
+//the CPU supports is picked at load time
+typedef struct ScannerSearches_s {
+    char* name;
+    char* cpuFeature;
+    ScannerSearch findQuoteOrEscape;
+    ScannerSearch identifierLength;
+    ScannerSearch whitespaceLength;
+} ScannerSearches;
+
+extern const ScannerSearches ScannerSearchesFor[];
 
 typedef struct ScanResult_S {
     char val;
     int err;
 } ScanResult;
 
-ScanResult _Scanner_GetNextImpl(Scanner s, fpos_t old_pos, char* expected, int expect);
-void ScannerSkipWhitespace(Scanner s);
+void Scanner_init(ScannerSource* source, char* data, size_t length);
+char* Scanner_readAll(FILE* in_file, char** data, size_t* length);
+int ScannerSearches_supported(const ScannerSearches* searches);
+char* Scanner_useSearches(char* name);
+size_t Scanner_findQuoteOrEscape(char* data, size_t length);
+size_t Scanner_identifierLength(char* data, size_t length);
+size_t Scanner_findStringEnd(char* data, size_t length);
+char* Scanner_findStatementEnd(char* data, size_t length, size_t* end);
 
-#define NewScanner(f) \
-    (Scanner)(f)
+ScanResult _Scanner_GetNextImpl(Scanner s, size_t old_pos, char* expected, int expect);
+void ScannerSkipWhitespace(Scanner s);
 
 #define ScannerCheckpoint(s) \
-    (fgetpos((s), &S_last_pos) == 0)
+    ((S_last_pos = (s)->position), 1)
 
 #define ScannerDeclareHiddenLocals \
-    fpos_t S_original_pos; \
-    fpos_t S_last_pos; \
-    char S_tmp_c; 
+    size_t S_original_pos; \
+    size_t S_last_pos; \
+    char S_tmp_c;
 
 #define ScannerBegin(s) \
     ScannerDeclareHiddenLocals \
-    if(fgetpos((s), &S_original_pos)) return "Failed to get file position"; \
+    S_original_pos = (s)->position; \
     S_last_pos = S_original_pos
 
 #define ScannerRollbackLast(s) \
-    fsetpos((s), &S_last_pos)
+    ((s)->position = S_last_pos)
 
 #define ScannerRollbackFull(s) \
-    fsetpos((s), &S_original_pos)
+    ((s)->position = S_original_pos)
 
 #define ScannerNextIs(s, c) \
     (_Scanner_GetNextImpl((s), S_original_pos, (S_tmp_c = c, &S_tmp_c), 1).err == 0)
@@ -43,12 +74,12 @@ void ScannerSkipWhitespace(Scanner s);
     (_Scanner_GetNextImpl((s), S_original_pos, (str), strlen(str)).err == 0)
 
 #define ScannerGetNext(s) \
-    _Scanner_GetNextImpl((s), S_original_pos, 0, 0) 
+    _Scanner_GetNextImpl((s), S_original_pos, 0, 0)
 
 #define ScannerGetNextStrict(s) \
     _Scanner_GetNextImpl((s), S_original_pos, 0, 1)
 
 #define ScannerAtEnd(s) \
-    feof(s)
+    ((s)->position >= (s)->length)
 
 #endif //SCANNER_H
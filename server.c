@@ -0,0 +1,405 @@
+#define _GNU_SOURCE
+#include "server.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define SERVER_BACKLOG 128
+#define SERVER_MAX_ARGS 1024
+
+//A request is the client's working directory, its argument count and
+//arguments, then whatever it read from stdin. The reply is the exit status
+//followed by everything the compile wrote to stdout and stderr. Strings are
+//sent as a 32-bit length followed by the bytes
+static volatile sig_atomic_t server_stopping = 0;
+
+char* Server_writeAll(int fd, void* data, size_t length) {
+
+    for(size_t written = 0; written < length;) {
+
+        ssize_t count = write(fd, (char*)data + written, length - written);
+
+        if(count < 0 && errno == EINTR) continue;
+
+        if(count <= 0) return "Connection closed while writing";
+
+        written += (size_t)count;
+    }
+
+    return 0;
+}
+
+char* Server_readAll(int fd, void* data, size_t length) {
+
+    for(size_t read_count = 0; read_count < length;) {
+
+        ssize_t count = read(fd, (char*)data + read_count, length - read_count);
+
+        if(count < 0 && errno == EINTR) continue;
+
+        if(count <= 0) return "Connection closed while reading";
+
+        read_count += (size_t)count;
+    }
+
+    return 0;
+}
+
+char* Server_writeString(int fd, char* data, size_t length) {
+
+    char* error;
+    uint32_t size = (uint32_t)length;
+
+    if((error = Server_writeAll(fd, &size, sizeof(size))) != 0) return error;
+
+    return Server_writeAll(fd, data, length);
+}
+
+char* Server_readString(int fd, char** data, size_t* length) {
+
+    char* error;
+    uint32_t size;
+
+    if((error = Server_readAll(fd, &size, sizeof(size))) != 0) return error;
+
+    if((*data = (char*)malloc(size + 1)) == 0) return "Failed to allocate space for a request string";
+
+    if((error = Server_readAll(fd, *data, size)) != 0) {
+
+        free(*data);
+
+        return error;
+    }
+
+    (*data)[size] = 0;
+
+    if(length != 0) *length = size;
+
+    return 0;
+}
+
+void Server_stop(int signal_number) {
+
+    server_stopping = 1;
+}
+
+//Runs one request with stdin, stdout, stderr and the working directory
+//temporarily swapped for the client's
+char* Server_handle(int connection, ServerHandler handler) {
+
+    char* error;
+    char* cwd = 0;
+    char* input = 0;
+    char* args[SERVER_MAX_ARGS + 2] = { "yc" };
+    char* output_data;
+    size_t input_length;
+    uint32_t argc;
+    int arg_count = 0;
+    int32_t status = 1;
+    int saved_fds[3] = { -1, -1, -1 };
+    int old_cwd = -1;
+    FILE* input_file = 0;
+    FILE* output_file = 0;
+
+    if((error = Server_readString(connection, &cwd, 0)) != 0) return error;
+
+    if((error = Server_readAll(connection, &argc, sizeof(argc))) != 0 || argc > SERVER_MAX_ARGS) {
+
+        free(cwd);
+
+        return error != 0 ? error : "Request has too many arguments";
+    }
+
+    for(; arg_count < (int)argc; arg_count++) {
+
+        if((error = Server_readString(connection, &args[arg_count + 1], 0)) != 0) break;
+    }
+
+    if(error == 0) error = Server_readString(connection, &input, &input_length);
+
+    if(error == 0) {
+
+        input_file = tmpfile();
+        output_file = tmpfile();
+        old_cwd = open(".", O_RDONLY | O_DIRECTORY);
+
+        if(input_file == 0 || output_file == 0 || old_cwd < 0) error = "Unable to set up request files";
+    }
+
+    if(error == 0 && fwrite(input, 1, input_length, input_file) != input_length) error = "Unable to buffer request input";
+
+    if(error == 0 && chdir(cwd) != 0) error = "Unable to change to the client's working directory";
+
+    if(error == 0) {
+
+        fflush(input_file);
+
+        for(int i = 0; i < 3; i++) saved_fds[i] = dup(i);
+
+        dup2(fileno(input_file), STDIN_FILENO);
+        dup2(fileno(output_file), STDOUT_FILENO);
+        dup2(fileno(output_file), STDERR_FILENO);
+        clearerr(stdin);
+        fseek(stdin, 0, SEEK_SET);
+
+        status = handler(arg_count + 1, args);
+
+        fflush(stdout);
+        fflush(stderr);
+
+        for(int i = 0; i < 3; i++) {
+
+            dup2(saved_fds[i], i);
+            close(saved_fds[i]);
+        }
+
+        clearerr(stdin);
+    }
+
+    if(old_cwd >= 0 && fchdir(old_cwd) != 0 && error == 0) error = "Unable to restore the server's working directory";
+
+    if(error == 0) {
+
+        long output_length;
+
+        fseek(output_file, 0, SEEK_END);
+        output_length = ftell(output_file);
+        rewind(output_file);
+
+        if((output_data = (char*)malloc(output_length + 1)) == 0) {
+
+            error = "Failed to allocate space for request output";
+        } else {
+
+            output_length = (long)fread(output_data, 1, output_length, output_file);
+
+            if((error = Server_writeAll(connection, &status, sizeof(status))) == 0) {
+
+                error = Server_writeString(connection, output_data, output_length);
+            }
+
+            free(output_data);
+        }
+    }
+
+    if(old_cwd >= 0) close(old_cwd);
+    if(input_file != 0) fclose(input_file);
+    if(output_file != 0) fclose(output_file);
+
+    for(int i = 1; i <= arg_count; i++) free(args[i]);
+
+    free(cwd);
+    free(input);
+
+    return error;
+}
+
+void Server_work(int listen_fd, ServerHandler handler) {
+
+    signal(SIGTERM, SIG_DFL);
+    signal(SIGINT, SIG_DFL);
+
+    for(;;) {
+
+        int connection = accept(listen_fd, 0, 0);
+
+        if(connection < 0) {
+
+            if(errno == EINTR || errno == ECONNABORTED) continue;
+
+            _exit(1);
+        }
+
+        char* error = Server_handle(connection, handler);
+
+        if(error != 0) fprintf(stderr, "yc server: %s\n", error);
+
+        close(connection);
+    }
+}
+
+pid_t Server_spawnWorker(int listen_fd, ServerHandler handler) {
+
+    pid_t pid;
+
+    fflush(stdout);
+    fflush(stderr);
+
+    if((pid = fork()) == 0) Server_work(listen_fd, handler);
+
+    return pid;
+}
+
+//Workers are forked after the caller has warmed its caches, each one blocks
+//in accept on the shared socket so the kernel hands every connection to an
+//idle worker. Workers that die are replaced until the server is signalled
+char* Server_run(char* socket_path, int worker_count, ServerHandler handler) {
+
+    struct sockaddr_un address = { 0 };
+    struct sigaction stop_action = { 0 };
+    int listen_fd;
+    int status;
+    pid_t* workers;
+
+    if(worker_count < 1) return "The server needs at least one worker";
+
+    if(strlen(socket_path) >= sizeof(address.sun_path)) return "Socket path is too long";
+
+    if((workers = (pid_t*)calloc(worker_count, sizeof(pid_t))) == 0) return "Failed to allocate space for workers";
+
+    if((listen_fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0) {
+
+        free(workers);
+
+        return "Unable to create the server socket";
+    }
+
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, socket_path);
+    unlink(socket_path);
+
+    if(bind(listen_fd, (struct sockaddr*)&address, sizeof(address)) != 0 || listen(listen_fd, SERVER_BACKLOG) != 0) {
+
+        close(listen_fd);
+        free(workers);
+
+        return "Unable to listen on the server socket";
+    }
+
+    stop_action.sa_handler = Server_stop;
+    sigaction(SIGTERM, &stop_action, 0);
+    sigaction(SIGINT, &stop_action, 0);
+
+    for(int i = 0; i < worker_count; i++) workers[i] = Server_spawnWorker(listen_fd, handler);
+
+    while(!server_stopping) {
+
+        pid_t pid = wait(&status);
+
+        if(pid < 0) {
+
+            if(errno == EINTR) continue;
+
+            break;
+        }
+
+        for(int i = 0; i < worker_count && !server_stopping; i++) {
+
+            if(workers[i] == pid) workers[i] = Server_spawnWorker(listen_fd, handler);
+        }
+    }
+
+    for(int i = 0; i < worker_count; i++) if(workers[i] > 0) kill(workers[i], SIGTERM);
+
+    while(wait(&status) > 0 || errno == EINTR);
+
+    close(listen_fd);
+    unlink(socket_path);
+    free(workers);
+
+    return 0;
+}
+
+char* Client_readStdin(char** data, size_t* length) {
+
+    size_t capacity = 4096;
+    size_t read_count;
+
+    *length = 0;
+
+    if((*data = (char*)malloc(capacity)) == 0) return "Failed to allocate space for stdin";
+
+    while((read_count = fread(&(*data)[*length], 1, capacity - *length, stdin)) > 0) {
+
+        *length += read_count;
+
+        if(*length < capacity) continue;
+
+        char* grown = (char*)realloc(*data, capacity *= 2);
+
+        if(grown == 0) {
+
+            free(*data);
+
+            return "Failed to allocate space for stdin";
+        }
+
+        *data = grown;
+    }
+
+    return 0;
+}
+
+char* Client_run(char* socket_path, int argc, char** argv, int* exit_status) {
+
+    struct sockaddr_un address = { 0 };
+    char* error = 0;
+    char* cwd;
+    char* input = 0;
+    char* output;
+    size_t input_length = 0;
+    size_t output_length;
+    uint32_t count = (uint32_t)argc;
+    int32_t status;
+    int connection;
+
+    if(strlen(socket_path) >= sizeof(address.sun_path)) return "Socket path is too long";
+
+    for(int i = 0; i < argc && error == 0; i++) {
+
+        if(strcmp(argv[i], "-") == 0) error = Client_readStdin(&input, &input_length);
+    }
+
+    if(error != 0) return error;
+
+    if((cwd = getcwd(0, 0)) == 0) {
+
+        free(input);
+
+        return "Unable to determine the working directory";
+    }
+
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, socket_path);
+
+    if((connection = socket(AF_UNIX, SOCK_STREAM, 0)) < 0) {
+
+        error = "Unable to create a client socket";
+    } else if(connect(connection, (struct sockaddr*)&address, sizeof(address)) != 0) {
+
+        error = "Unable to connect to the server";
+    } else if((error = Server_writeString(connection, cwd, strlen(cwd))) == 0) {
+
+        error = Server_writeAll(connection, &count, sizeof(count));
+
+        for(int i = 0; i < argc && error == 0; i++) error = Server_writeString(connection, argv[i], strlen(argv[i]));
+
+        if(error == 0) error = Server_writeString(connection, input == 0 ? "" : input, input_length);
+
+        if(error == 0) error = Server_readAll(connection, &status, sizeof(status));
+
+        if(error == 0 && (error = Server_readString(connection, &output, &output_length)) == 0) {
+
+            fwrite(output, 1, output_length, stdout);
+            fflush(stdout);
+            free(output);
+
+            *exit_status = status;
+        }
+    }
+
+    if(connection >= 0) close(connection);
+
+    free(cwd);
+    free(input);
+
+    return error;
+}
@@ -0,0 +1,10 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+typedef int (*ServerHandler)(int argc, char** argv);
+
+char* Server_run(char* socket_path, int worker_count, ServerHandler handler);
+
+char* Client_run(char* socket_path, int argc, char** argv, int* exit_status);
+
+#endif //SERVER_H
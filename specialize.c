@@ -0,0 +1,409 @@
+#include "specialize.h"
+#include "analysis.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+//next is the callee's previous specialization, -1 after its first
+typedef struct Specialization_s {
+    ASTNode* callee;
+    ASTNode* invocation;
+    String* name;
+    int next;
+} Specialization;
+
+VEC_DECLARE(Specialization)
+VEC_DECLARE(int)
+
+typedef struct SpecializeState_s {
+    ASTNode* module;
+    DeclarationIndex index;
+    SpecializeOptions* options;
+    PassStats* stats;
+    VEC(Specialization) specializations;
+    VEC(int) latest;
+    VEC(ASTNodePtr) children;
+    int nextLambdaId;
+} SpecializeState;
+
+char* Specialize_findMaxLambdaId(ASTNode* node, void* max_id) {
+
+    if(node->type == Lambda && (int)(size_t)node->LN_ID >= *(int*)max_id) {
+
+        *(int*)max_id = (int)(size_t)node->LN_ID + 1;
+    }
+
+    return 0;
+}
+
+char* Specialize_findNestedLambda(ASTNode* node, void* unused) {
+
+    return node->type == Lambda ? "Lambda body contains a nested lambda" : 0;
+}
+
+//Two call sites share a clone when they bind the same constants to the same
+//parameter positions of the same callee
+int Specialization_matches(Specialization* specialization, ASTNode* callee, ASTNode* invocation) {
+
+    ASTNode* args = invocation->IN_ARGS;
+    ASTNode* other_args = specialization->invocation->IN_ARGS;
+
+    if(specialization->callee != callee) return 0;
+
+    for(int i = 0; i < args->childCount; i++) {
+
+        int literal = args->children[i]->type == NumberLiteral;
+
+        if(literal != (other_args->children[i]->type == NumberLiteral)) return 0;
+
+        if(literal && args->children[i]->NLN_NUMBER != other_args->children[i]->NLN_NUMBER) return 0;
+    }
+
+    return 1;
+}
+
+//Replaces every reference to the parameter with a copy of the constant
+char* ASTNode_substituteSymbol(ASTNode** slot, String* name, ASTNode* value) {
+
+    char* error;
+    ASTNode* node = *slot;
+
+    if(node->type == Symbol) {
+
+        if(!String_equals((String*)node->SN_TEXT, name)) return 0;
+
+        if((error = ASTNode_clone(value, slot)) != 0) return error;
+
+        ASTNode_cleanUp(node);
+
+        return 0;
+    }
+
+    for(int i = 0; i < node->childCount; i++) {
+
+        //Never substitute the name being invoked
+        if(node->type == Invocation && i == 0) continue;
+
+        if((error = ASTNode_substituteSymbol(&node->children[i], name, value)) != 0) return error;
+    }
+
+    return 0;
+}
+
+char* SpecializeState_uniqueName(SpecializeState* state, String* base, String** name) {
+
+    char suffix[32];
+
+    for(int i = 0; ; i++) {
+
+        sprintf(suffix, "__s%i", i);
+
+        if((*name = String_new(0)) == 0) return "Failed to allocate a specialization name";
+
+        if(String_append(*name, base) != 0 || String_appendCString(*name, suffix) != 0) {
+
+            String_cleanUp(*name);
+
+            return "Failed to allocate a specialization name";
+        }
+
+        if(DeclarationIndex_find(&state->index, *name) == 0) return 0;
+
+        String_cleanUp(*name);
+    }
+}
+
+//Each declared lambda's latest specialization by slot, clones included
+char* SpecializeState_coverSlots(SpecializeState* state) {
+
+    char* error;
+
+    while(state->latest.count < (size_t)state->index.slotCount) {
+
+        if((error = Vec_int_add(&state->latest, -1)) != 0) return error;
+    }
+
+    return 0;
+}
+
+//Builds `var <callee>__s<n> = (<remaining params>) => <folded body>;` and
+//appends it to the module and its index
+char* SpecializeState_createClone(SpecializeState* state, ASTNode* callee, String* callee_name,
+    ASTNode* invocation, String** clone_name) {
+
+    char* error;
+    ASTNode* lambda;
+    ASTNode* declaration;
+    ASTNode* symbol;
+    ASTNode* args = invocation->IN_ARGS;
+    ASTNode* params;
+
+    if((error = ASTNode_clone(callee, &lambda)) != 0) return error;
+
+    params = lambda->LN_PARAMS;
+
+    for(int i = 0; i < args->childCount; i++) {
+
+        if(args->children[i]->type != NumberLiteral) continue;
+
+        if((error = ASTNode_substituteSymbol(&lambda->LN_EXPR,
+            (String*)params->children[i]->PN_SYMBOL->SN_TEXT, args->children[i])) != 0) {
+
+            ASTNode_cleanUp(lambda);
+
+            return error;
+        }
+    }
+
+    if((error = ASTNode_foldSlot(&state->index, &lambda->LN_EXPR, &state->options->fold, state->stats)) != 0) {
+
+        ASTNode_cleanUp(lambda);
+
+        return error;
+    }
+
+    int kept = 0;
+
+    for(int i = 0; i < args->childCount; i++) {
+
+        if(args->children[i]->type == NumberLiteral) {
+
+            ASTNode_cleanUp(params->children[i]);
+        } else {
+
+            params->children[kept++] = params->children[i];
+        }
+    }
+
+    params->childCount = kept;
+
+    lambda->LN_ID = (void*)(size_t)(state->nextLambdaId++);
+    lambda->LN_MEMOIZE = 0;
+    lambda->LN_MEMO_DIRECT = 0;
+    lambda->LN_MEMO_SIZE = 0;
+
+    if((error = SpecializeState_uniqueName(state, callee_name, clone_name)) != 0) {
+
+        ASTNode_cleanUp(lambda);
+
+        return error;
+    }
+
+    if((error = ASTNode_create(&symbol, Symbol, 0, 4)) != 0) {
+
+        ASTNode_cleanUp(lambda);
+        String_cleanUp(*clone_name);
+
+        return error;
+    }
+
+    if((error = String_copy(*clone_name, (String**)&symbol->SN_TEXT)) != 0) {
+
+        ASTNode_cleanUp(lambda);
+        String_cleanUp(*clone_name);
+        free(symbol);
+
+        return error;
+    }
+
+    if((error = ASTNode_create(&declaration, Declaration, 2, 0)) != 0) {
+
+        ASTNode_cleanUp(lambda);
+        ASTNode_cleanUp(symbol);
+        String_cleanUp(*clone_name);
+
+        return error;
+    }
+
+    symbol->SN_KIND = (void*)SymbolExternal;
+    symbol->SN_SLOT = 0;
+    symbol->SN_LAMBDA = 0;
+
+    declaration->DN_SYMBOL = symbol;
+    declaration->DN_INITIALIZER = lambda;
+
+    if((error = Vec_ASTNodePtr_add(&state->children, declaration)) != 0) {
+
+        ASTNode_cleanUp(declaration);
+        String_cleanUp(*clone_name);
+
+        return error;
+    }
+
+    state->module->children = state->children.data;
+    state->module->childCount = state->children.count;
+
+    if((error = DeclarationIndex_add(&state->index, declaration)) != 0 || (error = SpecializeState_coverSlots(state)) != 0) {
+
+        String_cleanUp(*clone_name);
+
+        return error;
+    }
+
+    return 0;
+}
+
+//Points the invocation at the clone and drops the arguments baked into it
+char* ASTInvocationNode_retarget(ASTNode* invocation, String* clone_name) {
+
+    char* error;
+    String* name;
+    ASTNode* args = invocation->IN_ARGS;
+    int kept = 0;
+
+    if((error = String_copy(clone_name, &name)) != 0) return error;
+
+    String_cleanUp((String*)invocation->IN_SYMBOL->SN_TEXT);
+    invocation->IN_SYMBOL->SN_TEXT = name;
+
+    for(int i = 0; i < args->childCount; i++) {
+
+        if(args->children[i]->type == NumberLiteral) {
+
+            ASTNode_cleanUp(args->children[i]);
+        } else {
+
+            args->children[kept++] = args->children[i];
+        }
+    }
+
+    args->childCount = kept;
+
+    return 0;
+}
+
+char* SpecializeState_visitInvocation(SpecializeState* state, ASTNode* lambda, ASTNode* invocation) {
+
+    char* error;
+    DeclarationIndexEntry* entry;
+    ASTNode* callee;
+    ASTNode* args = invocation->IN_ARGS;
+    String* callee_name = (String*)invocation->IN_SYMBOL->SN_TEXT;
+    String* clone_name = 0;
+    int literals = 0;
+    int clones = 0;
+    int slot;
+
+    if(lambda != 0 && ASTLambdaNode_findParameter(lambda, callee_name) >= 0) return 0;
+
+    entry = DeclarationIndex_find(&state->index, callee_name);
+
+    if(entry == 0 || !ASTDeclarationNode_IsLambda(entry->declaration)) return 0;
+
+    callee = entry->declaration->DN_INITIALIZER;
+    slot = entry->slot;
+
+    if(callee->LN_PARAMS->childCount != args->childCount) return 0;
+
+    for(int i = 0; i < args->childCount; i++) literals += args->children[i]->type == NumberLiteral;
+
+    //Fully constant calls are left to constant folding
+    if(literals == 0 || literals == args->childCount) return 0;
+
+    if(ASTNode_forAll(callee->LN_EXPR, Specialize_findNestedLambda, 0) != 0) return 0;
+
+    for(int i = state->latest.data[slot]; i >= 0; i = state->specializations.data[i].next) {
+
+        Specialization* existing = &state->specializations.data[i];
+
+        clones++;
+
+        if(Specialization_matches(existing, callee, invocation)) clone_name = existing->name;
+    }
+
+    if(clone_name == 0) {
+
+        Specialization specialization = { callee, 0, 0, state->latest.data[slot] };
+
+        if(clones >= state->options->maxClones) return 0;
+
+        if((error = SpecializeState_createClone(state, callee, callee_name, invocation, &specialization.name)) != 0) {
+
+            return error;
+        }
+
+        //Keep a pristine copy of the call site to match later calls against
+        if((error = ASTNode_clone(invocation, &specialization.invocation)) != 0) {
+
+            String_cleanUp(specialization.name);
+
+            return error;
+        }
+
+        if((error = Vec_Specialization_add(&state->specializations, specialization)) != 0) {
+
+            ASTNode_cleanUp(specialization.invocation);
+            String_cleanUp(specialization.name);
+
+            return error;
+        }
+
+        state->latest.data[slot] = state->specializations.count - 1;
+
+        clone_name = specialization.name;
+    }
+
+    state->stats->nodesChanged++;
+
+    return ASTInvocationNode_retarget(invocation, clone_name);
+}
+
+char* SpecializeState_visit(SpecializeState* state, ASTNode* lambda, ASTNode* node) {
+
+    char* error;
+
+    if(node == 0) return 0;
+
+    state->stats->nodesVisited++;
+
+    if(node->type == Lambda) lambda = node;
+
+    for(int i = 0; i < node->childCount; i++) {
+
+        if((error = SpecializeState_visit(state, lambda, node->children[i])) != 0) return error;
+    }
+
+    if(node->type == Invocation) return SpecializeState_visitInvocation(state, lambda, node);
+
+    return 0;
+}
+
+char* Module_specialize(ASTNode* module, SpecializeOptions* options, PassStats* stats) {
+
+    char* error = 0;
+    SpecializeState state = { module, { 0 }, options, stats };
+
+    if((error = DeclarationIndex_build(&state.index, module)) != 0) return error;
+
+    Vec_Specialization_init(&state.specializations, 0);
+    Vec_int_init(&state.latest, 0);
+
+    //Adopt the module's child array so appended clones grow it geometrically
+    state.children.data = module->children;
+    state.children.count = state.children.capacity = module->childCount;
+    state.children.arena = 0;
+
+    ASTNode_forAll(module, Specialize_findMaxLambdaId, &state.nextLambdaId);
+
+    error = SpecializeState_coverSlots(&state);
+
+    //Declarations appended for clones get visited as well, so calls inside a
+    //clone's body can be specialized in turn, up to each callee's clone limit
+    for(int i = 0; i < module->childCount && error == 0; i++) {
+
+        error = SpecializeState_visit(&state, 0, module->children[i]);
+    }
+
+    for(int i = 0; i < state.specializations.count; i++) {
+
+        Specialization* specialization = &state.specializations.data[i];
+
+        ASTNode_cleanUp(specialization->invocation);
+        String_cleanUp(specialization->name);
+    }
+
+    Vec_Specialization_cleanUp(&state.specializations);
+    Vec_int_cleanUp(&state.latest);
+    DeclarationIndex_cleanUp(&state.index);
+
+    return error;
+}
@@ -0,0 +1,14 @@
+#ifndef SPECIALIZE_H
+#define SPECIALIZE_H
+
+#include "ast.h"
+#include "fold.h"
+
+typedef struct SpecializeOptions_s {
+    int maxClones;
+    FoldOptions fold;
+} SpecializeOptions;
+
+char* Module_specialize(ASTNode* module, SpecializeOptions* options, PassStats* stats);
+
+#endif //SPECIALIZE_H
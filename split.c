@@ -0,0 +1,369 @@
+#include "split.h"
+#include "callgraph.h"
+#include "resolve.h"
+#include <ctype.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//Every lambda with its estimated size, in the order the parts receive them
+typedef struct SplitLambda_s {
+    ASTNode* lambda;
+    long weight;
+} SplitLambda;
+
+VEC_DECLARE(SplitLambda)
+
+typedef struct SplitPlan_s {
+    VEC(SplitLambda) lambdas;
+    long totalWeight;
+} SplitPlan;
+
+char* Split_countNode(ASTNode* node, void* count) {
+
+    (*(long*)count)++;
+
+    return 0;
+}
+
+//Body size is estimated from the node count, memoized lambdas also carry
+//their table and wrapper
+long Split_weigh(ASTNode* lambda) {
+
+    long count = 0;
+
+    ASTNode_forAll(lambda->LN_EXPR, Split_countNode, &count);
+
+    return count + lambda->LN_PARAMS->childCount + (lambda->LN_MEMOIZE != 0 ? 32 : 0);
+}
+
+char* Split_addLambda(SplitPlan* plan, ASTNode* lambda) {
+
+    SplitLambda entry = { lambda, Split_weigh(lambda) };
+
+    for(int i = 0; i < plan->lambdas.count; i++) if(plan->lambdas.data[i].lambda == lambda) return 0;
+
+    plan->totalWeight += entry.weight;
+
+    return Vec_SplitLambda_add(&plan->lambdas, entry);
+}
+
+char* Split_collectLambda(ASTNode* node, void* plan) {
+
+    return node->type == Lambda ? Split_addLambda((SplitPlan*)plan, node) : 0;
+}
+
+//Declared lambdas come first in call graph order so callers and callees tend
+//to share a part, any other lambdas follow in tree order
+char* SplitPlan_build(SplitPlan* plan, ASTNode* module) {
+
+    char* error;
+    CallGraph graph;
+    VEC(CallGraphNodePtr) order;
+
+    Vec_SplitLambda_init(&plan->lambdas, 0);
+    plan->totalWeight = 0;
+
+    if((error = CallGraph_build(&graph, module)) != 0) return error;
+
+    Vec_CallGraphNodePtr_init(&order, 0);
+
+    error = CallGraph_findSCCs(&graph);
+
+    for(int i = 0; i < graph.roots.count && error == 0; i++) {
+
+        error = CallGraph_place(&graph, graph.roots.data[i], &order);
+    }
+
+    for(int i = 0; i < graph.nodes.count && error == 0; i++) {
+
+        error = CallGraph_place(&graph, &graph.nodes.data[i], &order);
+    }
+
+    for(int i = 0; i < order.count && error == 0; i++) {
+
+        error = Split_addLambda(plan, order.data[i]->lambda);
+    }
+
+    Vec_CallGraphNodePtr_cleanUp(&order);
+    CallGraph_cleanUp(&graph);
+
+    if(error != 0) return error;
+
+    return ASTNode_forAll(module, Split_collectLambda, plan);
+}
+
+//Split output is C only and C templates number no labels, so the table
+//never grows
+char* Split_render(TemplateConfig* config, char* template_name, ASTNode* node, String* out_str) {
+
+    char* error;
+    Template* template;
+    TemplateLabelTable labels = { 0 };
+
+    if((error = Template_getCompiled(config, StrView_fromCString(template_name), &template)) != 0) return error;
+
+    error = Template_renderCompiledInner(template, node, &out_str, 0, &labels);
+
+    TemplateLabelTable_cleanUp(&labels);
+
+    return error;
+}
+
+char* Split_appendf(String* out_str, char* format, ...) {
+
+    char buffer[1024];
+    va_list args;
+
+    va_start(args, format);
+    vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+
+    return String_appendCString(out_str, buffer);
+}
+
+//Files whose text did not change keep their timestamp, so make only rebuilds
+//the objects of lambdas that were edited
+char* Split_writeIfChanged(char* name, String* content) {
+
+    FILE* out_file = fopen(name, "r");
+    int same = 0;
+
+    if(out_file != 0) {
+
+        char* existing = (char*)malloc(content->length + 1);
+
+        same = existing != 0 &&
+            fread(existing, 1, content->length + 1, out_file) == (size_t)content->length &&
+            memcmp(existing, content->data, content->length) == 0;
+
+        free(existing);
+        fclose(out_file);
+    }
+
+    if(same) return 0;
+
+    if((out_file = fopen(name, "w")) == 0) return "Unable to open a split output file";
+
+    fwrite(content->data, 1, content->length, out_file);
+
+    return fclose(out_file) == 0 ? 0 : "Unable to write a split output file";
+}
+
+char* Split_collectGlobal(ASTNode* node, void* globals) {
+
+    VEC(ASTNodePtr)* list = (VEC(ASTNodePtr)*)globals;
+
+    if(node->type != Symbol || node->SN_KIND != (void*)SymbolGlobal) return 0;
+
+    for(int i = 0; i < list->count; i++) {
+
+        if(String_equals((String*)list->data[i]->SN_TEXT, (String*)node->SN_TEXT)) return 0;
+    }
+
+    return Vec_ASTNodePtr_add(list, node);
+}
+
+//A lambda in a file of its own declares just the globals it uses, lambdas
+//typed by arity alone, so it does not depend on the names of other lambdas
+char* Split_renderSelfContained(TemplateConfig* config, ASTNode* lambda, String* out_str) {
+
+    char* error;
+    VEC(ASTNodePtr) globals;
+
+    Vec_ASTNodePtr_init(&globals, 0);
+
+    error = ASTNode_forAll(lambda, Split_collectGlobal, &globals);
+
+    if(error == 0) error = String_appendCString(out_str, "#include <stdio.h>\n\n");
+
+    for(int i = 0; i < globals.count && error == 0; i++) {
+
+        ASTNode* symbol = globals.data[i];
+        String* name = (String*)symbol->SN_TEXT;
+
+        if(symbol->SN_LAMBDA == 0) {
+
+            error = Split_appendf(out_str, "extern int %.*s;\n", (int)name->length, name->data);
+
+            continue;
+        }
+
+        int param_count = ((ASTNode*)symbol->SN_LAMBDA)->LN_PARAMS->childCount;
+
+        error = Split_appendf(out_str, "extern int (*%.*s)(", (int)name->length, name->data);
+
+        for(int j = 0; j < param_count && error == 0; j++) error = String_appendCString(out_str, j == 0 ? "int" : ", int");
+
+        if(error == 0) error = String_appendCString(out_str, ");\n");
+    }
+
+    if(error == 0) error = String_appendCString(out_str, "\n");
+
+    if(error == 0) error = Split_render(config, "lambda_body", lambda, out_str);
+
+    Vec_ASTNodePtr_cleanUp(&globals);
+
+    return error;
+}
+
+//Parts are cut from the ordered lambdas wherever the running weight crosses
+//the next equal share of the total, every part gets at least one lambda
+void SplitPlan_cut(SplitPlan* plan, int part_count, int* ends) {
+
+    long weight = 0;
+
+    for(int part = 0, next = 0; part < part_count; part++) {
+
+        long limit = plan->totalWeight * (part + 1) / part_count;
+        int last = plan->lambdas.count - (part_count - part - 1);
+
+        do {
+
+            weight += plan->lambdas.data[next++].weight;
+        } while(next < last && weight < limit);
+
+        ends[part] = next;
+    }
+}
+
+char* Split_writeFile(char* name, String* content) {
+
+    char* error = Split_writeIfChanged(name, content);
+
+    content->length = 0;
+
+    return error;
+}
+
+//out_name holds main and the globals, <base>.h the shared declarations and
+//<base>.mk rules to build everything in parallel. Lambda bodies go to
+//<base>_<n>.c, or with SPLIT_EACH to <base>_<lambda name>.c one per lambda
+char* Module_writeSplit(ASTNode* module, TemplateConfig* config, char* out_name, int part_count) {
+
+    char* error;
+    char* header_base;
+    char variable[256] = { 0 };
+    SplitPlan plan;
+    PassStats resolve_stats = { 0, 0 };
+    String* content;
+    String* objects;
+    String* rules;
+    size_t base_length = strlen(out_name);
+    int each = part_count == SPLIT_EACH;
+
+    if(part_count < 1 && !each) return "The split needs at least one part";
+
+    if(base_length > 2 && strcmp(&out_name[base_length - 2], ".c") == 0) base_length -= 2;
+
+    char base[base_length + 1];
+
+    memcpy(base, out_name, base_length);
+    base[base_length] = 0;
+    header_base = strrchr(base, '/') == 0 ? base : strrchr(base, '/') + 1;
+
+    for(int i = 0; header_base[i] != 0 && i < (int)sizeof(variable) - 1; i++) {
+
+        variable[i] = isalnum((unsigned char)header_base[i]) ? toupper((unsigned char)header_base[i]) : '_';
+    }
+
+    if((error = Module_resolveSymbols(module, &resolve_stats)) != 0) return error;
+
+    if((error = SplitPlan_build(&plan, module)) != 0) {
+
+        Vec_SplitLambda_cleanUp(&plan.lambdas);
+
+        return error;
+    }
+
+    if(each || part_count > plan.lambdas.count) part_count = plan.lambdas.count;
+
+    int ends[part_count + 1];
+
+    content = String_new(0);
+    objects = String_new(0);
+    rules = String_new(0);
+
+    if(content == 0 || objects == 0 || rules == 0) error = "Failed to allocate space for split output";
+
+    if(!each) SplitPlan_cut(&plan, part_count, ends);
+
+    for(int part = 0; part < part_count && error == 0; part++) {
+
+        String* lambda_name = (String*)plan.lambdas.data[part].lambda->LN_NAME;
+        char name[base_length + lambda_name->length + 32];
+
+        if(each) {
+
+            sprintf(name, "%s_%.*s", base, (int)lambda_name->length, lambda_name->data);
+            error = Split_renderSelfContained(config, plan.lambdas.data[part].lambda, content);
+        } else {
+
+            sprintf(name, "%s_%d", base, part + 1);
+            error = Split_appendf(content, "#include \"%s.h\"\n\n", header_base);
+
+            for(int i = part == 0 ? 0 : ends[part - 1]; i < ends[part] && error == 0; i++) {
+
+                error = Split_render(config, "lambda_body", plan.lambdas.data[i].lambda, content);
+            }
+        }
+
+        if(error == 0) error = Split_appendf(objects, " %s.o", name);
+
+        if(error == 0) error = Split_appendf(rules, "\n%s.o: %s.c", name, name);
+
+        if(error == 0 && !each) error = Split_appendf(rules, " %s.h", base);
+
+        if(error == 0) error = Split_appendf(rules, "\n\t$(CC) $(CFLAGS) -c -o $@ %s.c\n", name);
+
+        if(error == 0) {
+
+            strcat(name, ".c");
+            error = Split_writeFile(name, content);
+        }
+    }
+
+    if(error == 0) error = Split_appendf(content, "#ifndef %s_H\n#define %s_H\n\n", variable, variable);
+    if(error == 0) error = Split_render(config, "split_header", module, content);
+    if(error == 0) error = String_appendCString(content, "\n#endif\n");
+
+    if(error == 0) {
+
+        char name[base_length + 8];
+
+        sprintf(name, "%s.h", base);
+        error = Split_writeFile(name, content);
+    }
+
+    if(error == 0) error = Split_appendf(content, "#include \"%s.h\"\n\n", header_base);
+    if(error == 0) error = Split_render(config, "split_main", module, content);
+    if(error == 0) error = Split_writeFile(out_name, content);
+
+    if(error == 0) error = Split_appendf(content, "%s_OBJECTS =", variable);
+    if(error == 0) error = String_append(content, objects);
+
+    if(error == 0) error = Split_appendf(content, " %s.o\n\n%s: $(%s_OBJECTS)\n\t$(CC) $(CFLAGS) -o $@ $(%s_OBJECTS)\n\n",
+        base, base, variable, variable);
+
+    if(error == 0) error = Split_appendf(content, "%s.o: %s %s.h\n\t$(CC) $(CFLAGS) -c -o $@ %s\n",
+        base, out_name, base, out_name);
+
+    if(error == 0) error = String_append(content, rules);
+
+    if(error == 0) {
+
+        char name[base_length + 8];
+
+        sprintf(name, "%s.mk", base);
+        error = Split_writeFile(name, content);
+    }
+
+    if(content != 0) String_cleanUp(content);
+    if(objects != 0) String_cleanUp(objects);
+    if(rules != 0) String_cleanUp(rules);
+
+    Vec_SplitLambda_cleanUp(&plan.lambdas);
+
+    return error;
+}
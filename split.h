@@ -0,0 +1,12 @@
+#ifndef SPLIT_H
+#define SPLIT_H
+
+#include "ast.h"
+#include "template.h"
+
+//Puts every lambda in a file of its own named after the lambda
+#define SPLIT_EACH -1
+
+char* Module_writeSplit(ASTNode* module, TemplateConfig* config, char* out_name, int part_count);
+
+#endif //SPLIT_H
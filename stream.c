@@ -0,0 +1,265 @@
+#include "stream.h"
+#include "parse.h"
+#include "naming.h"
+#include "helpers.h"
+#include <stdlib.h>
+
+char* StreamSectionTemplateNames[STREAM_SECTION_COUNT] = {
+    "module_types",
+    "global_declarations",
+    "module_bodies",
+    "global_assignments",
+    "global_expressions"
+};
+
+char* StreamSectionPrefixes[STREAM_SECTION_COUNT] = {
+    "",
+    "\n",
+    "\n",
+    "\n#include <stdio.h>\nint main(int argc, char* argv[]) {\n",
+    "\n"
+};
+
+//A section collects one part of the module output in memory and moves it to
+//a temporary file whenever it grows past the spill threshold
+typedef struct StreamSection_s {
+    String* buffer;
+    FILE* spill;
+} StreamSection;
+
+char* StreamSection_flush(StreamSection* section) {
+
+    if(section->spill == 0 && (section->spill = tmpfile()) == 0) return "Unable to create a spill file";
+
+    if(fwrite(section->buffer->data, 1, section->buffer->length, section->spill) != section->buffer->length) {
+
+        return "Unable to write a spill file";
+    }
+
+    section->buffer->length = 0;
+
+    return 0;
+}
+
+char* StreamSection_writeTo(StreamSection* section, char* prefix, FILE* out_file) {
+
+    char chunk[1 << 16];
+    size_t count;
+
+    fputs(prefix, out_file);
+
+    if(section->spill != 0) {
+
+        rewind(section->spill);
+
+        while((count = fread(chunk, 1, sizeof(chunk), section->spill)) > 0) {
+
+            if(fwrite(chunk, 1, count, out_file) != count) return "Unable to write output file";
+        }
+    }
+
+    if(fwrite(section->buffer->data, 1, section->buffer->length, out_file) != section->buffer->length) {
+
+        return "Unable to write output file";
+    }
+
+    return 0;
+}
+
+//The unparsed part of the input, data[start, length) is what is left of the
+//last read. It only grows past STREAM_WINDOW_BYTES to fit a longer statement
+typedef struct StreamWindow_s {
+    FILE* in_file;
+    char* data;
+    size_t start;
+    size_t length;
+    size_t capacity;
+    int atEnd;
+} StreamWindow;
+
+//Moves the unparsed bytes to the front and reads after them, growing the
+//window first when they already fill it
+char* StreamWindow_fill(StreamWindow* window) {
+
+    char* error;
+    char* data;
+    size_t capacity;
+    size_t read;
+
+    memmove(window->data, &window->data[window->start], window->length - window->start);
+
+    window->length -= window->start;
+    window->start = 0;
+
+    if(window->length == window->capacity) {
+
+        if((error = size_grow(window->capacity + 1, 1, &capacity)) != 0) return error;
+
+        if((data = (char*)realloc(window->data, capacity)) == 0) return "Failed to allocate space for module source";
+
+        window->data = data;
+        window->capacity = capacity;
+    }
+
+    read = fread(&window->data[window->length], 1, window->capacity - window->length, window->in_file);
+
+    if(read == 0) {
+
+        if(ferror(window->in_file)) return "Unable to read input file";
+
+        window->atEnd = 1;
+    }
+
+    window->length += read;
+
+    return 0;
+}
+
+//Slices the next top-level statement off the window, reading more until its
+//';' is in view. An empty statement means the input is used up, and input
+//that ends without a ';' comes back whole for the parser to report on
+char* StreamWindow_nextStatement(StreamWindow* window, StrView* statement) {
+
+    char* error;
+    size_t end;
+    ScannerSource scanner;
+
+    while(1) {
+
+        Scanner_init(&scanner, &window->data[window->start], window->length - window->start);
+        ScannerSkipWhitespace(&scanner);
+
+        *statement = StrView_slice(&scanner.data[scanner.position], &scanner.data[scanner.length]);
+
+        if(statement->length > 0 && Scanner_findStatementEnd(statement->data, statement->length, &end) == 0) {
+
+            statement->length = end + 1;
+            window->start += scanner.position + statement->length;
+
+            return 0;
+        }
+
+        if(window->atEnd) {
+
+            window->start = window->length;
+
+            return 0;
+        }
+
+        if((error = StreamWindow_fill(window)) != 0) return error;
+    }
+}
+
+char* Stream_getTemplates(TemplateConfig* config, Template** templates) {
+
+    char* error;
+
+    for(int i = 0; i < STREAM_SECTION_COUNT; i++) {
+
+        if((error = Template_getCompiled(config, StrView_fromCString(StreamSectionTemplateNames[i]), &templates[i])) != 0) {
+
+            return error;
+        }
+    }
+
+    return 0;
+}
+
+//Appends the statement's share of each section to outputs. Lambdas outside
+//a declaration are named after anonymous_owner
+char* Stream_renderStatement(Template** templates, ASTNode* statement, char* anonymous_owner, String** outputs) {
+
+    char* error;
+    ASTNode* children[1] = { statement };
+    ASTNode module = { Module, 1, children, 0, 0 };
+    TemplateLabelTable labels = { 0 };
+
+    if((error = Module_nameLambdasAs(&module, anonymous_owner)) != 0) return error;
+
+    for(int i = 0; i < STREAM_SECTION_COUNT && error == 0; i++) {
+
+        error = Template_renderCompiledInto(templates[i], &module, outputs[i], &labels);
+    }
+
+    TemplateLabelTable_cleanUp(&labels);
+
+    return error;
+}
+
+char* StreamSection_renderStatement(StreamSection* sections, Template** templates, ASTNode* statement,
+    long index, size_t spill_bytes) {
+
+    char* error;
+    char owner[48];
+    String* outputs[STREAM_SECTION_COUNT];
+
+    for(int i = 0; i < STREAM_SECTION_COUNT; i++) outputs[i] = sections[i].buffer;
+
+    sprintf(owner, "anonymous%ld", index);
+
+    if((error = Stream_renderStatement(templates, statement, owner, outputs)) != 0) return error;
+
+    for(int i = 0; i < STREAM_SECTION_COUNT; i++) {
+
+        if(sections[i].buffer->length >= spill_bytes && (error = StreamSection_flush(&sections[i])) != 0) return error;
+    }
+
+    return 0;
+}
+
+//Reads the input through a window and parses and renders one top-level
+//statement at a time, freeing it before slicing off the next. Memory stays
+//bounded by the largest statement and the spill threshold whatever the input
+//size. There is no whole-module view, so no passes run and lambdas outside
+//declarations are named after their statement's position
+char* Module_streamCompile(FILE* in_file, TemplateConfig* config, FILE* out_file, size_t spill_bytes) {
+
+    char* error = 0;
+    long index = 0;
+    ASTNode* statement;
+    ScannerSource scanner;
+    StrView text;
+    Template* templates[STREAM_SECTION_COUNT];
+    StreamSection sections[STREAM_SECTION_COUNT] = { { 0 } };
+    StreamWindow window = { in_file, 0, 0, 0, STREAM_WINDOW_BYTES, 0 };
+
+    if((window.data = (char*)malloc(window.capacity)) == 0) return "Failed to allocate space for module source";
+
+    error = Stream_getTemplates(config, templates);
+
+    for(int i = 0; i < STREAM_SECTION_COUNT && error == 0; i++) {
+
+        if((sections[i].buffer = String_new(0)) == 0) error = "Unable to allocate memory for a stream section";
+    }
+
+    //Nodes own copies of their text, so the window is free to move on as
+    //soon as a statement is parsed
+    while(error == 0 && (error = StreamWindow_nextStatement(&window, &text)) == 0 && text.length > 0) {
+
+        Scanner_init(&scanner, text.data, text.length);
+
+        while(error == 0 && !ScannerAtEnd(&scanner)) {
+
+            if((error = Statement_tryParse(&scanner, &statement, 0)) != 0) break;
+
+            error = StreamSection_renderStatement(sections, templates, statement, index++, spill_bytes);
+
+            ASTNode_cleanUp(statement);
+            ScannerSkipWhitespace(&scanner);
+        }
+    }
+
+    free(window.data);
+
+    for(int i = 0; i < STREAM_SECTION_COUNT && error == 0; i++) error = StreamSection_writeTo(&sections[i], StreamSectionPrefixes[i], out_file);
+
+    if(error == 0) fputs(STREAM_SUFFIX, out_file);
+
+    for(int i = 0; i < STREAM_SECTION_COUNT; i++) {
+
+        if(sections[i].buffer != 0) String_cleanUp(sections[i].buffer);
+        if(sections[i].spill != 0) fclose(sections[i].spill);
+    }
+
+    return error;
+}
@@ -0,0 +1,27 @@
+#ifndef STREAM_H
+#define STREAM_H
+
+#include "template.h"
+#include "ast.h"
+#include "string.h"
+#include <stddef.h>
+#include <stdio.h>
+
+#define STREAM_DEFAULT_SPILL_BYTES (1 << 20)
+#define STREAM_WINDOW_BYTES (1 << 16)
+
+//Mirrors the C module template one section at a time, each statement adds
+//its share to every section and the sections are joined at the end
+#define STREAM_SECTION_COUNT 5
+#define STREAM_SUFFIX "\n}\n"
+
+extern char* StreamSectionTemplateNames[STREAM_SECTION_COUNT];
+extern char* StreamSectionPrefixes[STREAM_SECTION_COUNT];
+
+char* Stream_getTemplates(TemplateConfig* config, Template** templates);
+
+char* Stream_renderStatement(Template** templates, ASTNode* statement, char* anonymous_owner, String** outputs);
+
+char* Module_streamCompile(FILE* in_file, TemplateConfig* config, FILE* out_file, size_t spill_bytes);
+
+#endif //STREAM_H
@@ -1,102 +1,258 @@
 #include "string.h"
+#include "helpers.h"
+#include <stdint.h>
 #include <string.h>
 #include <stdlib.h>
+#include <stdio.h>
 
-void String_init(String* string, char* s) {
+StrView StrView_fromCString(char* s) {
 
-    string->length = s == 0 ? 0 : strlen(s);
-    string->capacity = 0;
-    string->data = s;
+    return (StrView){ s, s == 0 ? 0 : strlen(s) };
+}
+
+StrView StrView_slice(char* start, char* end) {
+
+    return (StrView){ start, (size_t)(end - start) };
+}
+
+int StrView_equals(StrView a, StrView b) {
+
+    return a.length == b.length && memcmp(a.data, b.data, a.length) == 0;
+}
+
+int StrView_equalsCString(StrView view, char* s) {
+
+    return strlen(s) == view.length && memcmp(view.data, s, view.length) == 0;
+}
+
+void String_init(String* string) {
+
+    string->length = 0;
+    string->capacity = STRING_INLINE_CAPACITY;
+    string->data = string->inlineData;
 }
 
 String* String_new(char* s) {
 
+    return String_fromView(StrView_fromCString(s));
+}
+
+String* String_fromView(StrView view) {
+
     String* string = (String*)malloc(sizeof(String));
 
-    if(!string) return string;
+    if(string == 0) return 0;
+
+    String_init(string);
+
+    if(String_appendView(string, view) != 0) {
 
-    String_init(string, s);
+        String_cleanUp(string);
+
+        return 0;
+    }
 
     return string;
 }
 
-char* String_append(String* target, String* source) {
+StrView String_view(String* string) {
+
+    return (StrView){ string->data, string->length };
+}
 
-    int reallocate = 0;
-    int original_capacity = target->capacity;
-    
-    //TODO: There has to be a fast math way to calculate the
-    //      next highest power of 2 from an arbitrary number
-    while((target->length + source->length) > target->capacity) {
+//Makes room for extra more bytes so callers can write straight into data.
+//A zeroed String that was never initialized starts out inline
+char* String_reserve(String* string, size_t extra) {
 
-        target->capacity = target->capacity == 0
-            ? 1
-            : (2 * target->capacity);
+    char* error;
+    char* data;
+    size_t capacity;
 
-        reallocate = 1;
+    if(string->data == 0) String_init(string);
+
+    if(extra > SIZE_MAX - string->length) return "String would be too long";
+
+    if(string->length + extra <= string->capacity) return 0;
+
+    if((error = size_grow(string->length + extra, 1, &capacity)) != 0) return error;
+
+    if(string->data == string->inlineData) {
+
+        if((data = (char*)malloc(capacity)) == 0) return "Failed to reallocate string buffer";
+
+        memcpy(data, string->inlineData, string->length);
+    } else if((data = (char*)realloc(string->data, capacity)) == 0) {
+
+        return "Failed to reallocate string buffer";
     }
 
-    if(reallocate) {
+    string->data = data;
+    string->capacity = capacity;
+
+    return 0;
+}
+
+char* String_appendBytes(String* string, char* data, size_t length) {
 
-        char* last_data = target->data;
-        int precopy = original_capacity == 0 && target->data != 0;
+    char* error;
 
-        if(original_capacity == 0) target->data = 0;
+    if(length == 0) return 0;
 
-        target->data = (char*)realloc(target->data, target->capacity);
+    if(length > string->capacity - string->length || string->data == 0) {
 
-        if(!target->data) return "Failed to reallocate string buffer";
-     
-        //TODO: error handle
-        if(precopy) strncpy(target->data, last_data, target->length);
+        if((error = String_reserve(string, length)) != 0) return error;
     }
 
-    //TODO: error handle
-    strncpy(&target->data[target->length], source->data, source->length);
+    memcpy(&string->data[string->length], data, length);
 
-    target->length = target->length + source->length;
+    string->length += length;
 
     return 0;
 }
 
+char* String_append(String* target, String* source) {
+
+    return String_appendBytes(target, source->data, source->length);
+}
+
+char* String_appendView(String* string, StrView view) {
+
+    return String_appendBytes(string, view.data, view.length);
+}
+
 char* String_appendChar(String* string, char c) {
 
-    String temp;
+    char* error;
+
+    if(string->length == string->capacity && (error = String_reserve(string, 1)) != 0) return error;
 
-    temp.capacity = 0;
-    temp.length = 1;
-    temp.data = &c;
+    string->data[string->length++] = c;
 
-    return String_append(string, &temp);
+    return 0;
 }
 
 char* String_appendCString(String* string, char* s) {
 
-    String temp;
+    return String_appendBytes(string, s, strlen(s));
+}
+
+//Formats straight into the string's buffer instead of through a temporary
+char* String_appendInt(String* string, long value) {
+
+    char* error;
+
+    if((error = String_reserve(string, 21)) != 0) return error;
+
+    string->length += sprintf(&string->data[string->length], "%li", value);
+
+    return 0;
+}
+
+char* String_copy(String* source, String** string) {
+
+    if((*string = String_fromView(String_view(source))) == 0) return "Failed to allocate space for a copied string";
+
+    return 0;
+}
+
+int String_equals(String* a, String* b) {
+
+    return a->length == b->length && memcmp(a->data, b->data, a->length) == 0;
+}
+
+int String_hexDigit(char c) {
 
-    temp.capacity = 0;
-    temp.length = strlen(s);
-    temp.data = s;
+    if(c >= '0' && c <= '9') return c - '0';
+    if(c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if(c >= 'A' && c <= 'F') return c - 'A' + 10;
 
-    return String_append(string, &temp);
+    return -1;
 }
 
-char* String_sliceCString(char* start, char* end, String** string) {
+//Produces a NUL-terminated copy of the string with C escape sequences
+//replaced by the characters they stand for
+char* String_decodeEscapes(String* source, char** decoded) {
+
+    char* out;
+    int i = 0;
+
+    if((*decoded = out = (char*)malloc(source->length + 1)) == 0) {
+
+        return "Failed to allocate space for a decoded string";
+    }
+
+    while(i < source->length) {
+
+        char c = source->data[i++];
 
-    *string = (String*)malloc(sizeof(String));
+        if(c != '\\' || i == source->length) {
 
-    if(*string == 0) return "Failed to allocate space for a new sliced string";
+            *(out++) = c;
 
-    (*string)->capacity = 0;
-    (*string)->length = (size_t)end - (size_t)start;
-    (*string)->data = start;
+            continue;
+        }
+
+        c = source->data[i++];
+
+        switch(c) {
+
+            case 'n': *(out++) = '\n'; break;
+            case 't': *(out++) = '\t'; break;
+            case 'r': *(out++) = '\r'; break;
+            case 'a': *(out++) = '\a'; break;
+            case 'b': *(out++) = '\b'; break;
+            case 'f': *(out++) = '\f'; break;
+            case 'v': *(out++) = '\v'; break;
+
+            case 'x': {
+
+                int value = 0;
+
+                while(i < source->length && String_hexDigit(source->data[i]) >= 0) {
+
+                    value = value * 16 + String_hexDigit(source->data[i++]);
+                }
+
+                *(out++) = (char)value;
+
+                break;
+            }
+
+            default:
+                if(c >= '0' && c <= '7') {
+
+                    int value = c - '0';
+
+                    for(int digits = 1; digits < 3 && i < source->length &&
+                        source->data[i] >= '0' && source->data[i] <= '7'; digits++) {
+
+                        value = value * 8 + (source->data[i++] - '0');
+                    }
+
+                    *(out++) = (char)value;
+                } else {
+
+                    *(out++) = c;
+                }
+        }
+    }
+
+    *out = 0;
 
     return 0;
 }
 
+//Frees what a String embedded in another struct or on the stack owns
+void String_release(String* string) {
+
+    if(string->data != string->inlineData) free(string->data);
+
+    String_init(string);
+}
+
 void String_cleanUp(String* string) {
 
-    if(string->capacity > 0) free(string->data);
+    if(string->data != string->inlineData) free(string->data);
 
     free(string);
 }
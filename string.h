@@ -1,25 +1,64 @@
 #ifndef STRING_H
 #define STRING_H
 
+#include <stddef.h>
+
+//Strings this short keep their bytes inside the String itself
+#define STRING_INLINE_CAPACITY 24
+
+//A borrowed run of bytes, the owner of the bytes has to outlive the view
+typedef struct StrView_s {
+    char* data;
+    size_t length;
+} StrView;
+
+//Always owns its bytes. Short contents sit in inlineData and data points at
+//them, so a String that holds anything must not be copied by value
 typedef struct String_s {
-    int length;
-    int capacity;
+    size_t length;
+    size_t capacity;
     char* data;
+    char inlineData[STRING_INLINE_CAPACITY];
 } String;
 
-void String_init(String* string, char* s);
+StrView StrView_fromCString(char* s);
+
+StrView StrView_slice(char* start, char* end);
+
+int StrView_equals(StrView a, StrView b);
+
+int StrView_equalsCString(StrView view, char* s);
+
+void String_init(String* string);
 
 String* String_new(char* s);
 
+String* String_fromView(StrView view);
+
+StrView String_view(String* string);
+
+char* String_reserve(String* string, size_t extra);
+
+char* String_appendBytes(String* string, char* data, size_t length);
+
 char* String_append(String* target, String* source);
 
+char* String_appendView(String* string, StrView view);
+
 char* String_appendChar(String* string, char c);
 
 char* String_appendCString(String* string, char* s);
 
-char* String_sliceCString(char* start, char* end, String** string);
+char* String_appendInt(String* string, long value);
+
+char* String_copy(String* source, String** string);
+
+int String_equals(String* a, String* b);
+
+char* String_decodeEscapes(String* source, char** decoded);
+
+void String_release(String* string);
 
 void String_cleanUp(String* string);
 
 #endif //STRING_H
-
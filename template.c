@@ -3,20 +3,15 @@
 #include <string.h>
 #include <stdlib.h>
 
-char* TemplateConfig_lookUp(TemplateConfig* config, String* template_name,
-    TemplateInfo** template_info) {
+//Compiled templates are never freed, so they all come out of one arena
+static Arena template_arena = { 0, ARENA_DEFAULT_BLOCK_BYTES };
 
-    char* error;
+char* TemplateConfig_lookUp(TemplateConfig* config, StrView template_name,
+    TemplateInfo** template_info) {
 
     for(int i = 0; i < config->templateCount; i++) {
 
-        if(
-            strlen(config->templateList[i].templateName)
-                == template_name->length &&
-            (strncmp(
-                config->templateList[i].templateName,
-                template_name->data,
-                template_name->length) == 0)) {
+        if(StrView_equalsCString(template_name, config->templateList[i].templateName)) {
 
             *template_info = &config->templateList[i];
             
@@ -28,7 +23,7 @@ char* TemplateConfig_lookUp(TemplateConfig* config, String* template_name,
 }
 
 char* TemplateExpression_tryParse(TemplateConfig* config, TemplateInfo* info, char** sp,
-    char* end_pos, TemplateExpression** out_expr) {
+    char* end_pos, TemplateExpression* out_expr) {
 
     char* s = *sp;
     char* error;
@@ -45,7 +40,10 @@ char* TemplateExpression_tryParse(TemplateConfig* config, TemplateInfo* info, ch
         expr.typeCode != 'c' &&
         expr.typeCode != 't' &&
         expr.typeCode != 'i' &&
-        expr.typeCode != 's'
+        expr.typeCode != 's' &&
+        expr.typeCode != 'o' &&
+        expr.typeCode != 'l' &&
+        expr.typeCode != 'x'
     ) {
 
         return "Encountered an unrecognized template expression type code";
@@ -57,6 +55,7 @@ char* TemplateExpression_tryParse(TemplateConfig* config, TemplateInfo* info, ch
     //                if there is no path, the target is the current node
     //                if the path ends in an 's', the inner template is expanded only for the one child
     //                if the path ends in an 'r', the inner template is expanded recursively for every child in the tree
+    //                if the path ends in a 'v', the inner template is expanded for each child in reverse order
     //                if the path does not end in an 's' or an 'r', the inner template is expanded for each
     //                child in the terminal node
     //    text_expr:  embedded template that will be compiled and inserted into the compiled expression
@@ -72,11 +71,7 @@ char* TemplateExpression_tryParse(TemplateConfig* config, TemplateInfo* info, ch
             return "Hit end of expression looking for closing '`' following 'e' expression code";
         }
 
-        if((error = String_sliceCString(s, &s[len], &expr.sourcePath)) != 0) {
-    
-            //TODO: Clean up everything
-            return error;
-        }
+        expr.sourcePath = StrView_slice(s, &s[len]);
 
         s = &s[len + 1];
 
@@ -160,11 +155,7 @@ char* TemplateExpression_tryParse(TemplateConfig* config, TemplateInfo* info, ch
             return "Hit end of expression looking for closing '`' following 'c' expression code";
         }
 
-        if((error = String_sliceCString(s, &s[len], &expr.sourcePath)) != 0) {
-    
-            //TODO: Clean up everything
-            return error;
-        }
+        expr.sourcePath = StrView_slice(s, &s[len]);
 
         s = &s[len + 1];
 
@@ -203,11 +194,7 @@ char* TemplateExpression_tryParse(TemplateConfig* config, TemplateInfo* info, ch
             return "Hit end of expression looking for opening '`' following 't' expression code";
         }
 
-        if((error = String_sliceCString(s, &s[len], &expr.sourcePath)) != 0) {
-    
-            //TODO: Clean up everything
-            return error;
-        }
+        expr.sourcePath = StrView_slice(s, &s[len]);
    
         s = &s[len + 1]; 
 
@@ -225,23 +212,12 @@ char* TemplateExpression_tryParse(TemplateConfig* config, TemplateInfo* info, ch
             return "Hit end of expression looking for closing '`' following 't' expression code";
         }
 
-        String* template_name;
-
-        if((error = String_sliceCString(s, &s[len], &template_name)) != 0) {
-    
-            //TODO: Clean up everything
-            return error;
-        }
+        StrView template_name = StrView_slice(s, &s[len]);
 
         s = &s[len];
 
-        error = Template_getCompiled(config, template_name, &expr.template);
-
-        String_cleanUp(template_name);
-
         //TODO: Clean up everything
-        
-        if(error != 0) return error;
+        if((error = Template_getCompiled(config, template_name, &expr.template)) != 0) return error;
 
         s++;
     }
@@ -255,21 +231,76 @@ char* TemplateExpression_tryParse(TemplateConfig* config, TemplateInfo* info, ch
     //    attribute_path - path to attribute which will be assumed to be an integer and inserted
     if(expr.typeCode == 'i' || expr.typeCode == 's') {
 
-        if((error = String_sliceCString(s, end_pos, &expr.sourcePath)) != 0) {
+        expr.sourcePath = StrView_slice(s, end_pos);
 
-            //TODO: Clean up everything
-        }
+        s = end_pos;
+    }
+
+    //Offset format:
+    //o<attribute_path>`scale`bias`
+    //    attribute_path - path to an integer attribute which is multiplied by scale and added to
+    //                     bias before being inserted, as for stack offsets or table strides
+    //                     if there is no path, the index of the node in the current iteration is used
+    if(expr.typeCode == 'o') {
+
+        int len = 0;
+        char* number_end;
+
+        for(len = 0; &s[len] != end_pos; len++) if(s[len] == '`') break;
+
+        if(&s[len] == end_pos) return "Hit end of expression looking for '`' following 'o' expression code";
+
+        expr.sourcePath = StrView_slice(s, &s[len]);
+
+        s = &s[len + 1];
+        expr.scale = strtol(s, &number_end, 10);
+
+        if(number_end == s || *number_end != '`') return "Expected a scale followed by '`' in 'o' expression";
+
+        s = number_end + 1;
+        expr.bias = strtol(s, &number_end, 10);
+
+        if(number_end == s || *number_end != '`') return "Expected a bias followed by '`' in 'o' expression";
 
         s = end_pos;
     }
 
-    if((*out_expr = (TemplateExpression*)malloc(sizeof(TemplateExpression))) == 0) {
+    //Label format:
+    //l<child_path>
+    //    child_path - node whose label number is inserted, every render of the same node
+    //                 during one top-level render produces the same number
+    if(expr.typeCode == 'l') {
 
-        //TODO: Clean up everything
-        return "Failed to allocate memory for a template expression";
+        expr.sourcePath = StrView_slice(s, end_pos);
+
+        s = end_pos;
     }
 
-    (**out_expr) = expr;
+    //Select format:
+    //x`text_expr0`text_expr1`...`
+    //    text_expr - embedded templates, the one at the index of the node in the current
+    //                iteration is rendered and indices past the last option render the last one
+    if(expr.typeCode == 'x') {
+
+        Template* option;
+
+        if(*s != '`') return "Expected a '`' following 'x' template expression code";
+
+        Vec_TemplatePtr_init(&expr.options, &template_arena);
+
+        for(s++; !(s[0] == '}' && s[1] == '}');) {
+
+            if((error = Template_compile(config, info, &s, &option)) != 0) return error;
+
+            if(*s != '`') return "Expected closing '`' following 'x' template expression option";
+
+            s++;
+
+            if((error = Vec_TemplatePtr_add(&expr.options, option)) != 0) return error;
+        }
+    }
+
+    *out_expr = expr;
     *sp = s;
 
     return 0;
@@ -280,19 +311,17 @@ char* Template_compile(TemplateConfig* config, TemplateInfo* info, char** templa
     char* template_str = *template_strp;
     char* error;
 
-    *template = (Template*)malloc(sizeof(Template));
-
-    if(*template == 0) return "Failed to allocate memory for a template";
+    if(Arena_alloc(&template_arena, sizeof(Template), (void**)template) != 0) return "Failed to allocate memory for a template";
 
     (*template)->info = info;
     
-    VoidList_init(&(*template)->segments);
-    VoidList_init(&(*template)->expressions);
+    Vec_StrView_init(&(*template)->segments, &template_arena);
+    Vec_TemplateExpression_init(&(*template)->expressions, &template_arena);
 
     int state = 0;
     char* end_pos = template_str;
     char* start_pos = template_str;
-    String* segment;
+    TemplateExpression expr;
 
     //TODO: We need to figure out a good mechanism for escaping special template chars
     for(; *template_str != 0 && state >= 0; template_str++) {
@@ -315,14 +344,12 @@ char* Template_compile(TemplateConfig* config, TemplateInfo* info, char** templa
                 
                     end_pos = template_str + 1;
 
-                    if((error = String_sliceCString(start_pos, end_pos - 2, &segment)) != 0) {
+                    if((error = Vec_StrView_add(&(*template)->segments, StrView_slice(start_pos, end_pos - 2))) != 0) {
                         
                         //TODO: Clean up everything
                         return error;
                     }
 
-                    VoidList_add(&(*template)->segments, segment);
-
                     start_pos = end_pos;
 
                     state = 2;
@@ -344,15 +371,13 @@ char* Template_compile(TemplateConfig* config, TemplateInfo* info, char** templa
 
                     end_pos = template_str + 1;
 
-                    TemplateExpression* expr;
-
-                    if((error = TemplateExpression_tryParse(config, info, &start_pos, end_pos - 2, &expr)) != 0) {
+                    if((error = TemplateExpression_tryParse(config, info, &start_pos, end_pos - 2, &expr)) != 0 ||
+                        (error = Vec_TemplateExpression_add(&(*template)->expressions, expr)) != 0) {
                         
                         //TODO: Clean up everything
                         return error;
                     }
 
-                    VoidList_add(&(*template)->expressions, expr);
                     start_pos += 2;
                     end_pos = start_pos;
                     template_str = start_pos - 1;
@@ -366,13 +391,11 @@ char* Template_compile(TemplateConfig* config, TemplateInfo* info, char** templa
 
     if(state == 0 || state == -1)  {
 
-        if((error = String_sliceCString(start_pos, template_str, &segment)) != 0) {
+        if((error = Vec_StrView_add(&(*template)->segments, StrView_slice(start_pos, template_str))) != 0) {
             
             //TODO: Clean up everything
             return error;
         }
-
-        VoidList_add(&(*template)->segments, segment);
     } else {
         
         //TODO: Clean up everything
@@ -384,7 +407,7 @@ char* Template_compile(TemplateConfig* config, TemplateInfo* info, char** templa
     return 0;
 }
 
-char* Template_getCompiled(TemplateConfig* config, String* template_name, Template** out_template) {
+char* Template_getCompiled(TemplateConfig* config, StrView template_name, Template** out_template) {
 
     char* error;
     TemplateInfo* template_info;
@@ -406,29 +429,46 @@ char* Template_getCompiled(TemplateConfig* config, String* template_name, Templa
     return 0;
 }
 
+//Compiles every template up front instead of on first use, for processes
+//that render many modules
+char* TemplateConfig_compileAll(TemplateConfig* config) {
+
+    char* error;
+    Template* template;
+
+    for(int i = 0; i < config->templateCount; i++) {
+
+        error = Template_getCompiled(config, StrView_fromCString(config->templateList[i].templateName), &template);
+
+        if(error != 0) return error;
+    }
+
+    return 0;
+}
+
 char* Template_printInner(Template* template, int depth) {
 
     char* error;
 
     for(int i = 0; i < template->segments.count; i++) {
 
-        String* segment = (String*)template->segments.data[i];
+        StrView* segment = &template->segments.data[i];
     
         print_indent(depth); printf(
             "Segment[%i] '%.*s'\n",
             i, 
-            segment->length,
+            (int)segment->length,
             segment->data
         );
 
         if(i == template->expressions.count) continue;
 
-        TemplateExpression* expression = (TemplateExpression*)template->expressions.data[i];
+        TemplateExpression* expression = &template->expressions.data[i];
 
         print_indent(depth); printf("Expression[%i]\n", i);
         print_indent(depth); printf("    typeCode: '%c'\n", expression->typeCode);
         print_indent(depth); printf("    sourcePath: '%.*s'\n",
-            expression->sourcePath->length, expression->sourcePath->data);
+            (int)expression->sourcePath.length, expression->sourcePath.data);
         print_indent(depth); printf("    template: %s\n",
             expression->template == 0 ? "[none]" : "");
 
@@ -446,7 +486,7 @@ char* Template_print(Template* template) {
 }
 
 char* IntegerTemplateExpression_render(Template* template, TemplateExpression* expression,
-    ASTNode* node, String** out_str, int child_index) {
+    ASTNode* node, String** out_str, int child_index, TemplateLabelTable* labels) {
 
     char* error;
     void* attribute_ptr;
@@ -456,19 +496,117 @@ char* IntegerTemplateExpression_render(Template* template, TemplateExpression* e
         return error;
     }
 
-    size_t attribute_val = (size_t)attribute_ptr;
-    char num_buf[50] = {0};
+    return String_appendInt(*out_str, (long)(size_t)attribute_ptr);
+}
+
+char* OffsetTemplateExpression_render(Template* template, TemplateExpression* expression,
+    ASTNode* node, String** out_str, int child_index, TemplateLabelTable* labels) {
+
+    char* error;
+    void* attribute_ptr = (void*)(size_t)child_index;
+
+    if(
+        expression->sourcePath.length > 0 &&
+        (error = ASTNode_getAttributeByPath(node, expression->sourcePath, &attribute_ptr)) != 0
+    ) return error;
+
+    return String_appendInt(*out_str, (long)(size_t)attribute_ptr * expression->scale + expression->bias);
+}
+
+char* TemplateLabelTable_lookUp(TemplateLabelTable* table, ASTNode* node, int* label) {
+
+    size_t index;
+
+    if(table->count * 2 >= table->capacity) {
+
+        TemplateLabelTable grown = { 0, 0, table->capacity == 0 ? 64 : table->capacity * 2, table->count };
+
+        grown.nodes = (ASTNode**)calloc(grown.capacity, sizeof(ASTNode*));
+        grown.labels = (int*)malloc(grown.capacity * sizeof(int));
+
+        if(grown.nodes == 0 || grown.labels == 0) {
+
+            free(grown.nodes);
+            free(grown.labels);
+
+            return "Failed to allocate space for template labels";
+        }
+
+        for(size_t i = 0; i < table->capacity; i++) {
+
+            if(table->nodes[i] == 0) continue;
+
+            for(index = ((size_t)table->nodes[i] >> 4) & (grown.capacity - 1); grown.nodes[index] != 0;
+                index = (index + 1) & (grown.capacity - 1));
+
+            grown.nodes[index] = table->nodes[i];
+            grown.labels[index] = table->labels[i];
+        }
+
+        free(table->nodes);
+        free(table->labels);
+        *table = grown;
+    }
+
+    for(index = ((size_t)node >> 4) & (table->capacity - 1); table->nodes[index] != 0;
+        index = (index + 1) & (table->capacity - 1)) {
+
+        if(table->nodes[index] == node) {
+
+            *label = table->labels[index];
+
+            return 0;
+        }
+    }
 
-    sprintf(num_buf, "%li", attribute_val);
-    String* num_str = String_new(num_buf);
-    String_append(*out_str, num_str);
-    String_cleanUp(num_str);
+    table->nodes[index] = node;
+    table->labels[index] = (int)table->count++;
+    *label = table->labels[index];
 
     return 0;
 }
 
+void TemplateLabelTable_reset(TemplateLabelTable* table) {
+
+    if(table->nodes != 0) memset(table->nodes, 0, table->capacity * sizeof(ASTNode*));
+
+    table->count = 0;
+}
+
+void TemplateLabelTable_cleanUp(TemplateLabelTable* table) {
+
+    free(table->nodes);
+    free(table->labels);
+    *table = (TemplateLabelTable){ 0, 0, 0, 0 };
+}
+
+char* LabelTemplateExpression_render(Template* template, TemplateExpression* expression,
+    ASTNode* node, String** out_str, int child_index, TemplateLabelTable* labels) {
+
+    char* error;
+    ASTNode* target_node;
+    int label;
+
+    if((error = ASTNode_getChildByPath(node, expression->sourcePath, 0, &target_node)) != 0) return error;
+
+    if((error = TemplateLabelTable_lookUp(labels, target_node, &label)) != 0) return error;
+
+    return String_appendInt(*out_str, label);
+}
+
+char* SelectTemplateExpression_render(Template* template, TemplateExpression* expression,
+    ASTNode* node, String** out_str, int child_index, TemplateLabelTable* labels) {
+
+    int option = child_index < expression->options.count ? child_index : (int)expression->options.count - 1;
+
+    if(option < 0) return "Select template expression has no options";
+
+    return Template_renderCompiledInner(
+        expression->options.data[option], node, out_str, child_index, labels);
+}
+
 char* StringTemplateExpression_render(Template* template, TemplateExpression* expression,
-    ASTNode* node, String** out_str, int child_index) {
+    ASTNode* node, String** out_str, int child_index, TemplateLabelTable* labels) {
 
     char* error;
     void* attribute_ptr;
@@ -478,15 +616,11 @@ char* StringTemplateExpression_render(Template* template, TemplateExpression* ex
         return error;
     }
 
-    String* attribute_str = (String*)attribute_ptr;
-
-    String_append(*out_str, attribute_str);
-
-    return 0;
+    return String_append(*out_str, (String*)attribute_ptr);
 }
 
 char* ReferenceTemplateExpression_render(Template* template, TemplateExpression* expression,
-    ASTNode* node, String** out_str, int child_index) { 
+    ASTNode* node, String** out_str, int child_index, TemplateLabelTable* labels) { 
 
     char* error;
     ASTNode* source_node;
@@ -497,7 +631,7 @@ char* ReferenceTemplateExpression_render(Template* template, TemplateExpression*
     }
    
     if((error = Template_renderCompiledInner(
-        expression->template, source_node, out_str, child_index)) != 0) {
+        expression->template, source_node, out_str, child_index, labels)) != 0) {
 
         return error;
     }
@@ -509,11 +643,11 @@ char* Template_renderDescender(ASTNode* node, void* void_args) {
 
     RecursiveRenderArgs* args = (RecursiveRenderArgs*)void_args;
 
-    return Template_renderCompiledInner(args->template, node, args->outStr, args->index);
+    return Template_renderCompiledInner(args->template, node, args->outStr, args->index, args->labels);
 }
 
 char* ExpansionTemplateExpression_render(Template* template, TemplateExpression* expression,
-    ASTNode* node, String** out_str, int child_index) {
+    ASTNode* node, String** out_str, int child_index, TemplateLabelTable* labels) {
 
     char* error;
     ASTNode* target_node;
@@ -521,11 +655,11 @@ char* ExpansionTemplateExpression_render(Template* template, TemplateExpression*
     if((error = ASTNode_getChildByPath(node, expression->sourcePath, 0, &target_node)) != 0) return error;
 
     if(
-        expression->sourcePath->length > 0 &&
-        expression->sourcePath->data[expression->sourcePath->length - 1] == 'c'
+        expression->sourcePath.length > 0 &&
+        expression->sourcePath.data[expression->sourcePath.length - 1] == 'c'
     ) {
 
-        if((error = Template_renderCompiledInner(expression->template, target_node, out_str, 0)) != 0) {
+        if((error = Template_renderCompiledInner(expression->template, target_node, out_str, 0, labels)) != 0) {
 
             return error;
         } 
@@ -534,11 +668,11 @@ char* ExpansionTemplateExpression_render(Template* template, TemplateExpression*
     }
 
     if(
-        expression->sourcePath->length > 0 &&
-        expression->sourcePath->data[expression->sourcePath->length - 1] == 'r'
+        expression->sourcePath.length > 0 &&
+        expression->sourcePath.data[expression->sourcePath.length - 1] == 'r'
     ) {
 
-        RecursiveRenderArgs args = { expression->template, out_str, 0 };
+        RecursiveRenderArgs args = { expression->template, out_str, 0, labels };
 
         if((error = ASTNode_forAll(target_node, Template_renderDescender, &args)) != 0) {
 
@@ -548,10 +682,27 @@ char* ExpansionTemplateExpression_render(Template* template, TemplateExpression*
         return 0;
     }
 
+    if(
+        expression->sourcePath.length > 0 &&
+        expression->sourcePath.data[expression->sourcePath.length - 1] == 'v'
+    ) {
+
+        for(int i = (int)target_node->childCount - 1; i >= 0; i--) {
+
+            if((error = Template_renderCompiledInner(
+                expression->template, target_node->children[i], out_str, i, labels)) != 0) {
+
+                return error;
+            }
+        }
+
+        return 0;
+    }
+
     for(int i = 0; i < target_node->childCount; i++) {
 
          if((error = Template_renderCompiledInner(
-            expression->template, target_node->children[i], out_str, i)) != 0) {
+            expression->template, target_node->children[i], out_str, i, labels)) != 0) {
 
             return error;
         }
@@ -561,23 +712,17 @@ char* ExpansionTemplateExpression_render(Template* template, TemplateExpression*
 }
 
 char* ConditionalTemplateExpression_render(Template* template, TemplateExpression* expression,
-    ASTNode* node, String** out_str, int child_index) {
+    ASTNode* node, String** out_str, int child_index, TemplateLabelTable* labels) {
 
     char* error;
     void* attribute_ptr;
 
-    if(
-        expression->sourcePath->length == strlen("first") &&
-        strncmp(expression->sourcePath->data, "first", expression->sourcePath->length) == 0
-    ) {
+    if(StrView_equalsCString(expression->sourcePath, "first")) {
         if(
             (expression->typeCode == 'c' && child_index != 0) ||
             (expression->typeCode == 'n' && child_index == 0)
         ) return 0;
-    } else if( 
-        expression->sourcePath->length == strlen("pred") &&
-        strncmp(expression->sourcePath->data, "pred", expression->sourcePath->length) == 0
-    ) {
+    } else if(StrView_equalsCString(expression->sourcePath, "pred")) {
 
         if(template->info->predicate == 0) return "Predicate specified in template, but predicate pointer is null";
 
@@ -602,65 +747,83 @@ char* ConditionalTemplateExpression_render(Template* template, TemplateExpressio
         ) return 0;
     }
 
-    return Template_renderCompiledInner(expression->template, node, out_str, child_index);
+    return Template_renderCompiledInner(expression->template, node, out_str, child_index, labels);
 }
 
 char* TemplateExpression_render(Template* template, TemplateExpression* expression,
-    ASTNode* node, String** out_str, int child_index) {
+    ASTNode* node, String** out_str, int child_index, TemplateLabelTable* labels) {
 
     if(expression->typeCode == 'i')
-        return IntegerTemplateExpression_render(template, expression, node, out_str, child_index);
+        return IntegerTemplateExpression_render(template, expression, node, out_str, child_index, labels);
 
     if(expression->typeCode == 's')
-        return StringTemplateExpression_render(template, expression, node, out_str, child_index);
+        return StringTemplateExpression_render(template, expression, node, out_str, child_index, labels);
 
     if(expression->typeCode == 't')
-        return ReferenceTemplateExpression_render(template, expression, node, out_str, child_index);
+        return ReferenceTemplateExpression_render(template, expression, node, out_str, child_index, labels);
 
     if(expression->typeCode == 'e')
-        return ExpansionTemplateExpression_render(template, expression, node, out_str, child_index);
+        return ExpansionTemplateExpression_render(template, expression, node, out_str, child_index, labels);
 
     if(expression->typeCode == 'c' || expression->typeCode == 'n')
-        return ConditionalTemplateExpression_render(template, expression, node, out_str, child_index);
+        return ConditionalTemplateExpression_render(template, expression, node, out_str, child_index, labels);
+
+    if(expression->typeCode == 'o')
+        return OffsetTemplateExpression_render(template, expression, node, out_str, child_index, labels);
+
+    if(expression->typeCode == 'l')
+        return LabelTemplateExpression_render(template, expression, node, out_str, child_index, labels);
+
+    if(expression->typeCode == 'x')
+        return SelectTemplateExpression_render(template, expression, node, out_str, child_index, labels);
 
     return "Encountered an unknown expression type when rendering template";
 }
 
 char* Template_renderCompiledInner(Template* template, ASTNode* node, String** out_str,
-    int child_index) {
+    int child_index, TemplateLabelTable* labels) {
 
     char* error;
 
     for(int i = 0; i < template->segments.count; i++) {
 
-        String* segment = (String*)template->segments.data[i];
-    
-        String_append(*out_str, segment);
+        if((error = String_appendView(*out_str, template->segments.data[i])) != 0) return error;
 
         if(i == template->expressions.count) continue;
 
-        TemplateExpression* expression = (TemplateExpression*)template->expressions.data[i];
-
         if((error = TemplateExpression_render(
             template,
-            (TemplateExpression*)template->expressions.data[i],
+            &template->expressions.data[i],
             node,
             out_str,
-            child_index)) != 0) return error;
+            child_index,
+            labels)) != 0) return error;
     }
 
     return 0;
 }
 
+char* Template_renderCompiledInto(Template* template, ASTNode* node, String* out_str, TemplateLabelTable* labels) {
+
+    TemplateLabelTable_reset(labels);
+
+    return Template_renderCompiledInner(template, node, &out_str, 0, labels);
+}
+
 char* Template_renderCompiled(Template* template, ASTNode* node, String** out_str) {
 
     char* error;
+    TemplateLabelTable labels = { 0 };
     
     *out_str = String_new(0);
 
-    if(out_str == 0) return "Unable to allocate memory for template output string";
+    if(*out_str == 0) return "Unable to allocate memory for template output string";
+
+    error = Template_renderCompiledInto(template, node, *out_str, &labels);
+
+    TemplateLabelTable_cleanUp(&labels);
 
-    if((error = Template_renderCompiledInner(template, node, out_str, 0)) != 0) {
+    if(error != 0) {
 
         String_cleanUp(*out_str);
 
@@ -9,12 +9,31 @@ struct TemplateExpression_s;
 struct RecursiveRenderArgs_s;
 
 #include "ast.h"
-#include "voidlist.h"
+#include "vec.h"
 #include "string.h"
+#include <stddef.h>
 
+typedef struct Template_s* TemplatePtr;
+
+VEC_DECLARE(TemplatePtr)
+VEC_DECLARE(StrView)
+
+typedef struct TemplateExpression_s {
+    char typeCode;
+    StrView sourcePath;
+    struct Template_s* template;
+    long scale;
+    long bias;
+    VEC(TemplatePtr) options;
+} TemplateExpression;
+
+VEC_DECLARE(TemplateExpression)
+
+//Segment i is rendered right before expression i, there is always one more
+//segment than there are expressions
 typedef struct Template_s {
-    VoidList segments;
-    VoidList expressions;
+    VEC(StrView) segments;
+    VEC(TemplateExpression) expressions;
     struct TemplateInfo_s* info;
 } Template;
 
@@ -35,29 +54,42 @@ typedef struct TemplateConfig_s {
    TemplateInfo templateList[];
 } TemplateConfig;
 
-typedef struct TemplateExpression_s {
-    char typeCode;
-    String* sourcePath;
-    Template* template;
-} TemplateExpression;
+//Labels are numbered in the order nodes are first asked for one and the
+//numbering restarts with every top-level render. Whoever starts the render
+//owns the table and passes it down, so it can be reused across renders
+typedef struct TemplateLabelTable_s {
+    struct ASTNode_s** nodes;
+    int* labels;
+    size_t capacity;
+    size_t count;
+} TemplateLabelTable;
 
 typedef struct RecursiveRenderArgs_s {
     Template* template;
     String** outStr;
     int index;
+    TemplateLabelTable* labels;
 } RecursiveRenderArgs;
 
 char* Template_compile(TemplateConfig* config, TemplateInfo* info, char** template_strp,
     Template** template);
 
-char* Template_getCompiled(TemplateConfig* config, String* template_name, Template** out_template);
+char* Template_getCompiled(TemplateConfig* config, StrView template_name, Template** out_template);
+
+char* TemplateConfig_compileAll(TemplateConfig* config);
+
+void TemplateLabelTable_cleanUp(TemplateLabelTable* table);
 
 char* Template_renderCompiledInner(Template* template, struct ASTNode_s* node, String** out_str,
-    int child_index); 
+    int child_index, TemplateLabelTable* labels); 
 
+//Renders with a table of its own, freed before returning
 char* Template_renderCompiled(Template* template, struct ASTNode_s* node, String** out_str);
 
+char* Template_renderCompiledInto(Template* template, struct ASTNode_s* node, String* out_str,
+    TemplateLabelTable* labels);
+
 char* TemplateExpression_render(Template* template, TemplateExpression* expression,
-    struct ASTNode_s* node, String** out_str, int child_index);
+    struct ASTNode_s* node, String** out_str, int child_index, TemplateLabelTable* labels);
 
 #endif //TEMPLATE_H
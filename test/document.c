@@ -0,0 +1,372 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../document.h"
+#include "../libyc.h"
+
+#define DOCUMENT_LINES 100000
+#define DOCUMENT_EDITS 2000
+#define DOCUMENT_CHECK_EVERY 250
+
+double now() {
+
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int compare_doubles(const void* a, const void* b) {
+
+    double difference = *(double*)a - *(double*)b;
+
+    return difference < 0 ? -1 : difference > 0;
+}
+
+//Chained declarations with a call, a comment or an anonymous lambda now and then
+char* document_source(int lines, int anonymous, size_t* length) {
+
+    char* source = (char*)malloc((size_t)lines * 80 + 256);
+    size_t count;
+
+    if(source == 0) return 0;
+
+    count = sprintf(source, "var apply = (var f, var x) => f(x);\n");
+
+    for(int i = 0; i < lines; i++) {
+
+        if(i % 50 == 0) count += sprintf(&source[count], "// section %i\n", i / 50);
+        else if(i % 10 == 0) count += sprintf(&source[count], "printf(\"%%d\\n\", f%i(%i, 2));\n", i + 1, i);
+        else if(anonymous && i % 25 == 7) count += sprintf(&source[count], "apply((var x) => x + %i, %i);\n", i, i);
+        else count += sprintf(&source[count], "var f%i = (var a, var b) => f%i(a * b, b - %i);\n", i, i + 1, i % 7);
+    }
+
+    *length = count;
+
+    return source;
+}
+
+char* collect_chunk(StrView chunk, void* args) {
+
+    return String_appendView((String*)args, chunk);
+}
+
+//Gathers the pieces of the last render into output
+int document_output(Document* document, String* output) {
+
+    output->length = 0;
+
+    return Document_write(document, collect_chunk, output) == 0 && output->length == Document_outputLength(document);
+}
+
+//What yc --stream writes for source
+char* stream_output(String* source, size_t* length) {
+
+    FILE* in_file = fmemopen(source->data, source->length, "r");
+    FILE* out_file = tmpfile();
+    char* output = 0;
+    char* error;
+
+    if(in_file == 0 || out_file == 0) return 0;
+
+    if((error = Module_streamCompile(in_file, &CTemplateConfig, out_file, STREAM_DEFAULT_SPILL_BYTES)) == 0) {
+
+        *length = (size_t)ftell(out_file);
+        output = (char*)malloc(*length + 1);
+
+        rewind(out_file);
+
+        if(output != 0 && fread(output, 1, *length, out_file) != *length) {
+
+            free(output);
+            output = 0;
+        }
+    } else {
+
+        printf("Stream compile failed: %s\n", error);
+    }
+
+    fclose(in_file);
+    fclose(out_file);
+
+    return output;
+}
+
+//Without anonymous lambdas a document renders exactly what yc --stream writes
+int check_stream(int lines) {
+
+    Document document;
+    String output;
+    String source;
+    size_t length;
+    char* text = document_source(lines, 0, &length);
+    char* expected = 0;
+    int matches = 0;
+
+    String_init(&output);
+    String_init(&source);
+
+    if(text != 0 && Document_open(&document, &CTemplateConfig, text, length) == 0) {
+
+        if(Document_render(&document) == 0 && document_output(&document, &output) &&
+            Document_copySource(&document, &source) == 0 && (expected = stream_output(&source, &length)) != 0) {
+
+            matches = length == output.length && memcmp(expected, output.data, length) == 0;
+        }
+
+        Document_cleanUp(&document);
+    }
+
+    if(!matches) printf("Document output differs from a stream compile\n");
+
+    String_release(&output);
+    String_release(&source);
+    free(expected);
+    free(text);
+
+    return matches;
+}
+
+//An edited document has to hold the source the edits made and render what
+//opening that source afresh renders
+int check_output(Document* document, String* source, String* output, int edit) {
+
+    Document fresh;
+    String copy;
+    String expected;
+    int matches = 0;
+
+    String_init(&copy);
+    String_init(&expected);
+
+    if(Document_copySource(document, &copy) != 0 || !String_equals(&copy, source)) {
+
+        printf("Source differs from the edited text after edit %i\n", edit);
+    } else if(Document_open(&fresh, &CTemplateConfig, source->data, source->length) == 0) {
+
+        matches = Document_render(&fresh) == 0 && document_output(&fresh, &expected) &&
+            document_output(document, output) && String_equals(&expected, output);
+
+        Document_cleanUp(&fresh);
+
+        if(!matches) printf("Output differs from a fresh document after edit %i\n", edit);
+    }
+
+    String_release(&copy);
+    String_release(&expected);
+
+    return matches;
+}
+
+//Mirrors an edit in the text the editor keeps
+char* source_edit(String* source, size_t offset, size_t removed, char* inserted, size_t inserted_length) {
+
+    char* error;
+    size_t tail_length = source->length - offset - removed;
+
+    if(inserted_length > removed && (error = String_reserve(source, inserted_length - removed)) != 0) return error;
+
+    memmove(&source->data[offset + inserted_length], &source->data[offset + removed], tail_length);
+    memcpy(&source->data[offset], inserted, inserted_length);
+
+    source->length = offset + inserted_length + tail_length;
+
+    return 0;
+}
+
+//Start of a random line of the source
+size_t random_line(String* source) {
+
+    size_t offset = (size_t)rand() % source->length;
+
+    while(offset > 0 && source->data[offset - 1] != '\n') offset--;
+
+    return offset;
+}
+
+size_t line_length(String* source, size_t offset) {
+
+    char* newline = (char*)memchr(&source->data[offset], '\n', source->length - offset);
+
+    return newline == 0 ? source->length - offset : (size_t)(newline - &source->data[offset]) + 1;
+}
+
+//Opens a 100k line module, applies edits of every kind to it and times each
+//edit and render, checking the output against a fresh document as it goes.
+//The text the edits make is kept alongside, as an editor would keep it
+int main(int argc, char** argv) {
+
+    Document document;
+    String source;
+    String output;
+    size_t length;
+    char* text = document_source(DOCUMENT_LINES, 1, &length);
+    char* error;
+    char inserted[128];
+    double* latencies = (double*)malloc(sizeof(double) * DOCUMENT_EDITS);
+    double write_seconds = 0;
+    int writes = 0;
+    size_t parsed = 0;
+    size_t rendered = 0;
+    int failures = 0;
+
+    String_init(&source);
+    String_init(&output);
+
+    if(text == 0 || latencies == 0 || Yc_init() != 0 || String_appendBytes(&source, text, length) != 0) {
+
+        printf("Unable to set up the benchmark\n");
+
+        return 1;
+    }
+
+    if(!check_stream(DOCUMENT_LINES / 10)) return 1;
+
+    double start = now();
+
+    if((error = Document_open(&document, &CTemplateConfig, text, length)) != 0 ||
+        (error = Document_render(&document)) != 0) {
+
+        printf("Opening the document failed: %s\n", error);
+
+        return 1;
+    }
+
+    printf("Opened %i lines, %zu bytes in %.3f s\n", DOCUMENT_LINES, length, now() - start);
+
+    if(!check_output(&document, &source, &output, 0)) return 1;
+
+    srand(1);
+
+    for(int edit = 0; edit < DOCUMENT_EDITS; edit++) {
+
+        size_t offset = random_line(&source);
+        size_t removed = 0;
+        int broken = 0;
+
+        switch(edit % 5) {
+
+            //Retype a number
+            case 0:
+                while(offset < source.length && (source.data[offset] < '0' || source.data[offset] > '9')) offset++;
+                removed = offset < source.length ? 1 : 0;
+                sprintf(inserted, "%i", edit % 10);
+                break;
+
+            case 1:
+                sprintf(inserted, "var g%i = (var a) => f%i(a, a);\n", edit, edit);
+                break;
+
+            case 2:
+                removed = line_length(&source, offset);
+                inserted[0] = 0;
+                break;
+
+            //Leaves a statement without its ';', the next edit puts it back
+            case 3:
+                removed = line_length(&source, offset);
+                memcpy(inserted, &source.data[offset], removed);
+                inserted[removed] = 0;
+                removed = 0;
+                offset = random_line(&source);
+                break;
+
+            case 4:
+                sprintf(inserted, "apply((var x) => x * %i, 1);\n", edit);
+                break;
+        }
+
+        if(edit % 5 == 3) {
+
+            //Drop the ';' of a copied line so it runs into the next statement
+            char* semicolon = strrchr(inserted, ';');
+
+            if(semicolon != 0 && strncmp(inserted, "//", 2) != 0) {
+
+                *semicolon = ' ';
+                broken = 1;
+            }
+        }
+
+        double edit_start = now();
+
+        error = Document_edit(&document, offset, removed, inserted, strlen(inserted));
+
+        if(error == 0) error = Document_render(&document);
+
+        latencies[edit] = now() - edit_start;
+        parsed += document.parsedCount;
+        rendered += document.renderedCount;
+
+        if(Document_sourceLength(&document) != source.length - removed + strlen(inserted)) {
+
+            printf("Edit %i changed the source by the wrong length\n", edit);
+            failures++;
+
+            break;
+        }
+
+        source_edit(&source, offset, removed, inserted, strlen(inserted));
+
+        if(broken && error != 0) {
+
+            //Put the ';' back, which has to bring the module back
+            char* semicolon = strrchr(inserted, ' ');
+            size_t at = offset + (size_t)(semicolon - inserted);
+
+            if((error = Document_edit(&document, at, 1, ";", 1)) == 0) error = Document_render(&document);
+
+            source_edit(&source, at, 1, ";", 1);
+        }
+
+        if(error != 0) {
+
+            printf("Edit %i failed: %s\n", edit, error);
+            failures++;
+
+            break;
+        }
+
+        if(edit % DOCUMENT_CHECK_EVERY == DOCUMENT_CHECK_EVERY - 1) {
+
+            double write_start = now();
+
+            if(!document_output(&document, &output)) {
+
+                printf("Writing the output failed after edit %i\n", edit);
+                failures++;
+
+                break;
+            }
+
+            write_seconds += now() - write_start;
+            writes++;
+
+            if(!check_output(&document, &source, &output, edit)) {
+
+                failures++;
+
+                break;
+            }
+        }
+    }
+
+    qsort(latencies, DOCUMENT_EDITS, sizeof(double), compare_doubles);
+
+    printf("%i edits: median %.3f ms, 99th percentile %.3f ms, max %.3f ms\n", DOCUMENT_EDITS,
+        latencies[DOCUMENT_EDITS / 2] * 1000, latencies[DOCUMENT_EDITS * 99 / 100] * 1000, latencies[DOCUMENT_EDITS - 1] * 1000);
+    printf("%.2f statements parsed and %.2f rendered per edit\n",
+        (double)parsed / DOCUMENT_EDITS, (double)rendered / DOCUMENT_EDITS);
+
+    if(writes > 0) printf("Writing out %zu bytes of output takes %.3f ms\n", output.length, write_seconds / writes * 1000);
+
+    Document_cleanUp(&document);
+    String_release(&source);
+    String_release(&output);
+    free(latencies);
+    free(text);
+
+    return failures != 0;
+}
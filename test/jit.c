@@ -0,0 +1,379 @@
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "../interp.h"
+#include "../jit.h"
+#include "../libyc.h"
+#include "../naming.h"
+#include "../parsecache.h"
+#include "../pass.h"
+#include "../run.h"
+
+#define JIT_TEST_DEFAULT_MODULES 40
+#define JIT_TEST_MAX_LAMBDAS 16
+#define JIT_TEST_INPUTS 3
+#define JIT_TEST_OUTPUT_BYTES 4096
+
+#define JIT_TEST_OVERFLOW "Maximum recursion depth exceeded"
+
+int JitTestArgs[] = { -9, 0, 13 };
+
+//Only infinite recursion overflows, and only the native code can tell, so the
+//module is never handed to cc
+char JitTestLimits[] =
+    "var sub = (var a, var b) => a - b;\n"
+    "var div = (var a, var b) => a / b;\n"
+    "var negate = (var a) => div(a, sub(0, 1));\n"
+    "var halve = (var a) => a / 2;\n"
+    "var down = (var a) => down(a + 1);\n"
+    "var n = sub(0, 9);\n"
+    "printf(\"%d\\n\", negate(n));\n"
+    "printf(\"%d\\n\", halve(n));\n"
+    "printf(\"%d\\n\", down(n));\n";
+
+unsigned next_random(unsigned* state) {
+
+    *state = *state * 1103515245 + 12345;
+
+    return (*state >> 16) & 0x7fff;
+}
+
+//Lambdas f0 to fn only call earlier ones so every call terminates, multiply
+//at most once on any path so nothing overflows, and get their inputs from
+//globals so fold cannot compute the printed results ahead of the JIT. Kinds
+//3 and up divide or call and so need a frame, kind 6 divides by -1 once
+//fold and specialize have run
+char* test_source(unsigned seed, int* framed, int* count, size_t* length) {
+
+    unsigned state = seed;
+    int lambdas = 4 + next_random(&state) % (JIT_TEST_MAX_LAMBDAS - 3);
+    char* source = (char*)malloc(JIT_TEST_MAX_LAMBDAS * 128 + 1024);
+    size_t used;
+
+    if(source == 0) return 0;
+
+    used = sprintf(source, "var sub = (var a, var b) => a - b;\nvar div = (var a, var b) => a / b;\n");
+
+    for(int i = 0; i < lambdas; i++) {
+
+        int kind = next_random(&state) % 8;
+        int callee = i == 0 ? 0 : next_random(&state) % i;
+        int k = 2 + next_random(&state) % 8;
+
+        if(i == 0) kind %= 4;
+
+        used += sprintf(&source[used], "var f%i = (var a) => ", i);
+
+        switch(kind) {
+            case 0: used += sprintf(&source[used], "a + %i;\n", k); break;
+            case 1: used += sprintf(&source[used], "a * %i;\n", k % 3 + 1); break;
+            case 2: used += sprintf(&source[used], "%i - a;\n", k); break;
+            case 3: used += sprintf(&source[used], "a / %i;\n", k); break;
+            case 4: used += sprintf(&source[used], "f%i(a + %i);\n", callee, k); break;
+            case 5: used += sprintf(&source[used], "sub(f%i(a), %i);\n", callee, k); break;
+            case 6: used += sprintf(&source[used], "div(f%i(a), sub(0, 1));\n", callee); break;
+            default: used += sprintf(&source[used], "div(a, %i);\n", k); break;
+        }
+
+        framed[i] = kind >= 3;
+    }
+
+    for(int i = 0; i < JIT_TEST_INPUTS; i++) {
+
+        used += sprintf(&source[used], "var n%i = sub(%i, 50);\n", i, (int)(next_random(&state) % 101));
+    }
+
+    for(int i = 0; i < lambdas; i++) {
+
+        used += sprintf(&source[used], "printf(\"%%d\\n\", f%i(n%i));\n", i, (int)(next_random(&state) % JIT_TEST_INPUTS));
+    }
+
+    *count = lambdas;
+    *length = used;
+
+    return source;
+}
+
+//Parses and runs the -O2 pipeline without automatic memoization, which
+//would keep the memoized lambdas away from the JIT, and with room for a
+//clone of sub and div per call site so every division ends up literal
+char* prepare_module(char* source, size_t length, ASTNode** module) {
+
+    ParseOptions parse_options = { 0, 1 };
+    PassContext context = { { 100000, 64 }, { JIT_TEST_MAX_LAMBDAS }, { 0, 1 << 20, 0 } };
+    PassManager manager;
+    char* error;
+
+    PassManager_init(&manager);
+
+    if((error = ParseCache_parseSource(source, length, &parse_options, module)) != 0) {
+
+        PassManager_cleanUp(&manager);
+
+        return error;
+    }
+
+    if((error = PassManager_usePreset(&manager, 2)) == 0) error = PassManager_run(&manager, *module, &context);
+
+    PassManager_cleanUp(&manager);
+
+    if(error != 0) ASTNode_cleanUp(*module);
+
+    return error;
+}
+
+char* run_interpreter(void* interpreter) {
+
+    return Interpreter_run((Interpreter*)interpreter);
+}
+
+char* run_compiled(void* module) {
+
+    RunOptions options;
+    int exit_status;
+
+    RunOptions_init(&options);
+
+    return Module_compileAndRun((ASTNode*)module, &CTemplateConfig, &options, "yjit", 0, 0, &exit_status);
+}
+
+//Runs with stdout going to capture, returning what was printed in output
+char* run_captured(char* (*run)(void*), void* argument, FILE* capture, char* output) {
+
+    char* error;
+    size_t count;
+    int saved;
+
+    fflush(stdout);
+    rewind(capture);
+    ftruncate(fileno(capture), 0);
+
+    saved = dup(1);
+    dup2(fileno(capture), 1);
+
+    error = run(argument);
+    fflush(stdout);
+
+    dup2(saved, 1);
+    close(saved);
+
+    rewind(capture);
+    count = fread(output, 1, JIT_TEST_OUTPUT_BYTES - 1, capture);
+    output[count] = 0;
+
+    return error;
+}
+
+//Every lambda has to be compiled with the expected frame, and give the tree
+//walker's result through the trampoline and, for leaves, when called directly
+char* check_lambdas(Jit* jit, Interpreter* plain, int* framed, int count) {
+
+    char* error;
+    char name[16];
+
+    for(int i = 0; i < count; i++) {
+
+        sprintf(name, "f%i", i);
+
+        JitLambda* entry = Jit_findLambda(jit, name);
+
+        if(entry == 0 || entry->offset < 0) return "A generated lambda was not compiled";
+
+        if(Jit_needsFrame(entry->lambda->LN_EXPR) != framed[i]) return "A lambda was compiled with the wrong frame";
+
+        for(int j = 0; j < sizeof(JitTestArgs) / sizeof(JitTestArgs[0]); j++) {
+
+            Value arg = { ValueInt };
+            Value expected;
+            int result;
+
+            arg.integer = JitTestArgs[j];
+
+            if((error = Interpreter_call(plain, entry->lambda, &arg, 1, &expected)) != 0) return error;
+
+            if((error = Jit_call(jit, name, &JitTestArgs[j], 1, &result)) != 0) return error;
+
+            if(result != expected.integer) return "Jit_call differs from the tree walker";
+
+            if(!framed[i] && ((JitFunction1)Jit_lookUp(jit, name, 0))(JitTestArgs[j]) != result) {
+
+                return "A direct call to a leaf differs from Jit_call";
+            }
+        }
+    }
+
+    return 0;
+}
+
+//Runs one module through the JIT, the tree walker and cc, which all have to
+//print the same
+char* test_module(unsigned seed, FILE* capture, int* divides_by_minus_one) {
+
+    char expected[JIT_TEST_OUTPUT_BYTES];
+    char output[JIT_TEST_OUTPUT_BYTES];
+    int framed[JIT_TEST_MAX_LAMBDAS];
+    int count;
+    size_t length;
+    char* source = test_source(seed, framed, &count, &length);
+    ASTNode* module;
+    Interpreter plain = { 0 };
+    Jit jit;
+    char* error;
+
+    if(source == 0) return "Failed to allocate space for the source";
+
+    if((error = prepare_module(source, length, &module)) != 0) {
+
+        free(source);
+
+        return error;
+    }
+
+    if((error = Jit_init(&jit, module)) == 0) error = Interpreter_init(&plain, module);
+
+    if(error == 0) error = run_captured(run_interpreter, &plain, capture, expected);
+
+    if(error == 0) error = run_captured(run_interpreter, &jit.interpreter, capture, output);
+
+    if(error == 0 && strcmp(expected, output) != 0) error = "The JIT printed something else than the tree walker";
+
+    if(error == 0) error = check_lambdas(&jit, &plain, framed, count);
+
+    for(int i = 0; i < jit.lambdaCount; i++) {
+
+        ASTNode* body = jit.lambdas[i].offset < 0 ? 0 : jit.lambdas[i].lambda->LN_EXPR;
+
+        if(
+            body != 0 && body->type == Operator && (ASTOperatorType)(size_t)body->ON_OPERATOR == OpDivide &&
+            (int)(long)body->ON_RIGHT_EXPR->NLN_NUMBER == -1
+        ) *divides_by_minus_one = 1;
+    }
+
+    Interpreter_cleanUp(&plain);
+    Jit_cleanUp(&jit);
+    ASTNode_cleanUp(module);
+
+    if(error == 0 && (error = prepare_module(source, length, &module)) == 0) {
+
+        if((error = Module_nameLambdas(module)) == 0) error = run_captured(run_compiled, module, capture, output);
+
+        if(error == 0 && strcmp(expected, output) != 0) error = "The JIT printed something else than cc's build";
+
+        ASTNode_cleanUp(module);
+    }
+
+    free(source);
+
+    return error;
+}
+
+//Division by -1 has to wrap like the tree walker for INT_MIN, and hitting the
+//stack limit has to unwind through the trampoline and leave the JIT usable
+char* test_limits(FILE* capture) {
+
+    char expected[JIT_TEST_OUTPUT_BYTES];
+    char output[JIT_TEST_OUTPUT_BYTES];
+    ASTNode* module;
+    Interpreter plain = { 0 };
+    Jit jit;
+    char* error;
+    char* jit_error;
+    Value arg = { ValueInt };
+    Value wrapped;
+    int min = INT_MIN;
+    int result;
+
+    if((error = prepare_module(JitTestLimits, strlen(JitTestLimits), &module)) != 0) return error;
+
+    if((error = Jit_init(&jit, module)) == 0) error = Interpreter_init(&plain, module);
+
+    if(error == 0 && Jit_lookUp(&jit, "down", 0) == 0) error = "The recursive lambda was not compiled";
+
+    if(error == 0 && run_captured(run_interpreter, &plain, capture, expected) == 0) error = "The tree walker did not overflow";
+
+    if(error == 0) {
+
+        jit_error = run_captured(run_interpreter, &jit.interpreter, capture, output);
+
+        if(jit_error == 0 || strcmp(jit_error, JIT_TEST_OVERFLOW) != 0 || !jit.state->overflowed) {
+
+            error = "The JIT did not unwind from the stack limit";
+        } else if(strcmp(expected, output) != 0) {
+
+            error = "The JIT printed something else than the tree walker";
+        }
+    }
+
+    if(error == 0 && ((jit_error = Jit_call(&jit, "down", &min, 1, &result)) == 0 || strcmp(jit_error, JIT_TEST_OVERFLOW) != 0)) {
+
+        error = "Jit_call did not report the stack limit";
+    }
+
+    if(error == 0 && ((error = Jit_call(&jit, "halve", &min, 1, &result)) != 0 || jit.state->overflowed)) {
+
+        if(error == 0) error = "The JIT stayed overflowed after unwinding";
+    }
+
+    if(error == 0 && result != INT_MIN / 2) error = "The JIT did not recover from the stack limit";
+
+    arg.integer = INT_MIN;
+
+    if(error == 0) error = Interpreter_call(&plain, Jit_findLambda(&jit, "negate")->lambda, &arg, 1, &wrapped);
+
+    if(error == 0) error = Jit_call(&jit, "negate", &min, 1, &result);
+
+    if(error == 0 && result != wrapped.integer) error = "INT_MIN / -1 differs from the tree walker";
+
+    Interpreter_cleanUp(&plain);
+    Jit_cleanUp(&jit);
+    ASTNode_cleanUp(module);
+
+    return error;
+}
+
+//Checks the JIT against the tree walker and cc on generated integer modules,
+//the first argument being how many, then its division and stack limit cases
+int main(int argc, char** argv) {
+
+    int modules = argc > 1 ? (int)strtol(argv[1], 0, 10) : JIT_TEST_DEFAULT_MODULES;
+    int divides_by_minus_one = 0;
+    int failures = 0;
+    FILE* capture = tmpfile();
+    char* error;
+
+    if(capture == 0 || Yc_init() != 0) {
+
+        printf("Unable to set up the test\n");
+
+        return 1;
+    }
+
+    for(int i = 0; i < modules; i++) {
+
+        if((error = test_module((unsigned)i, capture, &divides_by_minus_one)) != 0) {
+
+            printf("module %i: %s\n", i, error);
+            failures++;
+        }
+    }
+
+    if(modules > 0 && !divides_by_minus_one) {
+
+        printf("No generated module divided by -1\n");
+        failures++;
+    }
+
+    if((error = test_limits(capture)) != 0) {
+
+        printf("limits: %s\n", error);
+        failures++;
+    }
+
+    printf("%i modules, %i failures\n", modules, failures);
+
+    fclose(capture);
+
+    return failures != 0;
+}
@@ -0,0 +1,190 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../callgraph.h"
+#include "../parse.h"
+
+#define LAYOUT_SCALE_LAMBDAS 50000
+
+typedef struct LayoutCase_s {
+    char* source;
+    char* order;
+    char* cold;
+} LayoutCase;
+
+//order lists the declarations as they have to come out, cold the lambdas
+//nothing at the top level reaches
+LayoutCase LayoutCases[] = {
+    //A value initializer calls f, which has to be assigned before it runs
+    { "var f = (var a) => a + 1; var x = f(printf(\"hi\\n\")); var g = (var a) => a * 2; printf(\"%d %d\\n\", x, g(x));",
+        "f x g", "" },
+    { "var g = (var a) => a; var f = (var a) => g(a); f(1);", "f g", "" },
+    { "var u = (var a) => a; var g = (var a) => a; var f = (var a) => g(a); var x = f(1); var h = (var a) => h(a); x;",
+        "f g u x h", "u h" },
+    { "var f = (var a) => a; printf(\"%d\\n\", 1); var g = (var a) => f(a); g(2);", "f g", "" },
+    { 0 }
+};
+
+double now() {
+
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+char* parse_module(char* source, ASTNode** module) {
+
+    ScannerSource scanner;
+    ParseOptions options = { 0, 1 };
+
+    Scanner_init(&scanner, source, strlen(source));
+
+    return Module_parse(&scanner, &options, module);
+}
+
+//Appends each declared name, and separately each cold lambda's, space separated
+void describe(ASTNode* module, char* order, char* cold) {
+
+    order[0] = cold[0] = 0;
+
+    for(int i = 0; i < module->childCount; i++) {
+
+        ASTNode* statement = module->children[i];
+        String* name;
+
+        if(statement->type != Declaration) continue;
+
+        name = (String*)statement->DN_SYMBOL->SN_TEXT;
+
+        sprintf(&order[strlen(order)], "%s%.*s", order[0] ? " " : "", (int)name->length, name->data);
+
+        if(ASTDeclarationNode_IsLambda(statement) && statement->DN_INITIALIZER->LN_COLD) {
+
+            sprintf(&cold[strlen(cold)], "%s%.*s", cold[0] ? " " : "", (int)name->length, name->data);
+        }
+    }
+}
+
+int check_case(LayoutCase* layout) {
+
+    ASTNode* module = 0;
+    PassStats stats = { 0, 0 };
+    char order[256];
+    char cold[256];
+    char* error;
+
+    if((error = parse_module(layout->source, &module)) != 0 || (error = Module_layOutLambdas(module, &stats)) != 0) {
+
+        printf("Laying out \"%s\" failed: %s\n", layout->source, error);
+
+        if(module != 0) ASTNode_cleanUp(module);
+
+        return 0;
+    }
+
+    describe(module, order, cold);
+    ASTNode_cleanUp(module);
+
+    if(strcmp(order, layout->order) != 0 || strcmp(cold, layout->cold) != 0) {
+
+        printf("\"%s\" laid out as \"%s\", cold \"%s\" instead of \"%s\", cold \"%s\"\n",
+            layout->source, order, cold, layout->order, layout->cold);
+
+        return 0;
+    }
+
+    return 1;
+}
+
+//Chains of lambdas with a value or a call between every few, each calling
+//one declared further on
+char* scale_source(int lambdas) {
+
+    char* source = (char*)malloc((size_t)lambdas * 80 + 256);
+    size_t count = 0;
+
+    if(source == 0) return 0;
+
+    for(int i = 0; i < lambdas; i++) {
+
+        count += sprintf(&source[count], "var f%i = (var a) => f%i(a);\n", i, (i * 7 + 3) % lambdas);
+
+        if(i % 5 == 4) count += sprintf(&source[count], "var v%i = f%i(%i);\n", i, i - 2, i);
+        if(i % 9 == 8) count += sprintf(&source[count], "printf(\"%%d\\n\", f%i(1));\n", i);
+    }
+
+    return source;
+}
+
+//The statements that are not lambda declarations, by position. Lambdas may
+//only trade places among themselves, so these must not move
+ASTNode** fixed_statements(ASTNode* module) {
+
+    ASTNode** fixed = (ASTNode**)calloc(module->childCount, sizeof(ASTNode*));
+
+    if(fixed == 0) return 0;
+
+    for(int i = 0; i < module->childCount; i++) {
+
+        if(!ASTDeclarationNode_IsLambda(module->children[i])) fixed[i] = module->children[i];
+    }
+
+    return fixed;
+}
+
+//Lays out a large module, checking no lambda crosses a statement that could
+//call it and that the pass stays fast
+int check_scale(int lambdas) {
+
+    ASTNode* module = 0;
+    PassStats stats = { 0, 0 };
+    char* source = scale_source(lambdas);
+    ASTNode** before;
+    ASTNode** after;
+    int moved = 0;
+    char* error;
+
+    if(source == 0 || (error = parse_module(source, &module)) != 0 || (before = fixed_statements(module)) == 0) {
+
+        printf("Unable to set up the scale check\n");
+
+        return 0;
+    }
+
+    double start = now();
+
+    error = Module_layOutLambdas(module, &stats);
+
+    double seconds = now() - start;
+
+    after = error == 0 ? fixed_statements(module) : 0;
+
+    for(int i = 0; after != 0 && i < module->childCount; i++) moved += before[i] != after[i];
+
+    printf("Laid out %i lambdas in %.3f s, %ld declarations moved\n", lambdas, seconds, stats.nodesChanged);
+
+    if(error != 0 || after == 0 || moved != 0) printf("%i statements moved\n", moved);
+
+    ASTNode_cleanUp(module);
+    free(before);
+    free(after);
+    free(source);
+
+    return error == 0 && after != 0 && moved == 0;
+}
+
+int main(int argc, char** argv) {
+
+    int failures = 0;
+
+    for(LayoutCase* layout = LayoutCases; layout->source != 0; layout++) failures += !check_case(layout);
+
+    failures += !check_scale(LAYOUT_SCALE_LAMBDAS);
+
+    printf("%s\n", failures == 0 ? "Layout checks passed" : "Layout checks failed");
+
+    return failures != 0;
+}
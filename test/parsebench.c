@@ -0,0 +1,126 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../parse.h"
+
+#define BENCH_SOURCE_BYTES (32 << 20)
+
+double now() {
+
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+//Chains of small lambdas calling the next one, with a call now and then
+char* bench_source(size_t bytes, size_t* length) {
+
+    char* source = (char*)malloc(bytes + 256);
+    size_t count = 0;
+
+    if(source == 0) return 0;
+
+    for(int i = 0; count < bytes; i++) {
+
+        count += i % 16 == 15
+            ? sprintf(&source[count], "printf(\"%%d\\n\", f%i(%i, 2));\n", i - 1, i)
+            : sprintf(&source[count], "var f%i = (var a, var b) => f%i(a * b, b - %i);\n", i, i + 1, i % 7);
+    }
+
+    *length = count;
+
+    return source;
+}
+
+//Parses the same source on 1 to 16 threads and checks every parse comes out
+//with the same statements, counting the serial parse's failed rule attempts
+int main(int argc, char** argv) {
+
+    char* source;
+    size_t length;
+    size_t expected_statements = 0;
+    double serial_seconds = 0;
+    ParseStats stats = { 0 };
+    long attempts = 0;
+    long failures = 0;
+
+    if(argc > 1) {
+
+        FILE* in_file = fopen(argv[1], "r");
+
+        if(in_file == 0 || Scanner_readAll(in_file, &source, &length) != 0) {
+
+            printf("Unable to read input file %s\n", argv[1]);
+
+            return 1;
+        }
+
+        fclose(in_file);
+    } else if((source = bench_source(BENCH_SOURCE_BYTES, &length)) == 0) {
+
+        printf("Unable to allocate the benchmark source\n");
+
+        return 1;
+    }
+
+    printf("Parsing %zu bytes\n", length);
+
+    for(int threads = 1; threads <= 16; threads *= 2) {
+
+        ParseOptions options = { 0, threads, threads == 1 ? &stats : 0 };
+        ScannerSource scanner;
+        ASTNode* module = 0;
+        char* error;
+
+        Scanner_init(&scanner, source, length);
+
+        double start = now();
+
+        error = Module_parse(&scanner, &options, &module);
+
+        double seconds = now() - start;
+
+        if(error != 0) {
+
+            printf("%2i threads: %s\n", threads, error);
+
+            if(module != 0) ASTNode_cleanUp(module);
+
+            return 1;
+        }
+
+        if(threads == 1) {
+
+            expected_statements = module->childCount;
+            serial_seconds = seconds;
+        }
+
+        if(module->childCount != expected_statements) {
+
+            printf("%2i threads found %zu statements instead of %zu\n", threads, module->childCount, expected_statements);
+
+            return 1;
+        }
+
+        printf("%2i threads %8.3f s  %8.1f MiB/s  %5.2fx\n", threads, seconds,
+            length / (double)(1 << 20) / seconds, serial_seconds / seconds);
+
+        ASTNode_cleanUp(module);
+    }
+
+    //Rules tried on a source that parses are wasted exactly when they fail
+    for(int i = 0; i < PARSE_RULE_COUNT; i++) {
+
+        attempts += stats.attempts[i];
+        failures += stats.failures[i];
+    }
+
+    printf("%ld rule attempts, %ld failed\n", attempts, failures);
+
+    free(source);
+
+    return 0;
+}
@@ -0,0 +1,198 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define RUN_BENCH_RUNS 7
+#define RUN_BENCH_COMMANDS 3
+#define RUN_BENCH_ARGS 8
+#define RUN_BENCH_OUTPUT_BYTES 4096
+
+//Commands run one after another, SCRIPT, OUT_C and BINARY stand for the
+//script and the files the pipeline leaves in a private directory
+typedef struct RunBenchCase_s {
+    char* name;
+    char* commands[RUN_BENCH_COMMANDS][RUN_BENCH_ARGS];
+} RunBenchCase;
+
+RunBenchCase RunBenchCases[] = {
+    { "gcc pipeline", {
+        { "./yc", "-o", "OUT_C", "SCRIPT", 0 },
+        { "cc", "-O1", "-o", "BINARY", "OUT_C", 0 },
+        { "BINARY", 0 } } },
+    { "yc -x", { { "./yc", "-x", "--no-cache", "SCRIPT", 0 } } },
+    { "yc -x cached", { { "./yc", "-x", "SCRIPT", 0 } } },
+    { "yc -r", { { "./yc", "-r", "SCRIPT", 0 } } },
+    { 0 }
+};
+
+double now() {
+
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int compare_doubles(const void* a, const void* b) {
+
+    double difference = *(double*)a - *(double*)b;
+
+    return difference < 0 ? -1 : difference > 0;
+}
+
+//Runs one command with stdout going to capture, failing if it does not exit 0
+char* run_command(char** command, char* script, char* out_c, char* binary, FILE* capture) {
+
+    char* args[RUN_BENCH_ARGS];
+    int status;
+    pid_t child;
+
+    for(int i = 0; i < RUN_BENCH_ARGS; i++) {
+
+        args[i] = command[i] == 0 ? 0
+            : strcmp(command[i], "SCRIPT") == 0 ? script
+            : strcmp(command[i], "OUT_C") == 0 ? out_c
+            : strcmp(command[i], "BINARY") == 0 ? binary
+            : command[i];
+
+        if(args[i] == 0) break;
+    }
+
+    fflush(stdout);
+
+    if((child = fork()) < 0) return "Unable to start a command";
+
+    if(child == 0) {
+
+        dup2(fileno(capture), 1);
+        execvp(args[0], args);
+        _exit(127);
+    }
+
+    if(waitpid(child, &status, 0) != child || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+
+        return "A command failed";
+    }
+
+    return 0;
+}
+
+//Time from starting the first command until the last one has exited, which
+//for a small script is the time to its first output
+char* run_case(RunBenchCase* bench, char* script, char* directory, FILE* capture, char* output, double* seconds) {
+
+    char out_c[4096];
+    char binary[4096];
+    char* error = 0;
+    size_t count;
+
+    snprintf(out_c, sizeof(out_c), "%s/out.c", directory);
+    snprintf(binary, sizeof(binary), "%s/out", directory);
+
+    rewind(capture);
+    ftruncate(fileno(capture), 0);
+
+    double start = now();
+
+    for(int i = 0; i < RUN_BENCH_COMMANDS && bench->commands[i][0] != 0 && error == 0; i++) {
+
+        error = run_command(bench->commands[i], script, out_c, binary, capture);
+    }
+
+    *seconds = now() - start;
+
+    unlink(out_c);
+    unlink(binary);
+
+    rewind(capture);
+    count = fread(output, 1, RUN_BENCH_OUTPUT_BYTES - 1, capture);
+    output[count] = 0;
+
+    return error;
+}
+
+int bench_script(char* script, char* directory, FILE* capture) {
+
+    char expected[RUN_BENCH_OUTPUT_BYTES];
+    char output[RUN_BENCH_OUTPUT_BYTES];
+    double pipeline = 0;
+    int have_expected = 0;
+    int failures = 0;
+
+    printf("%s, median of %i runs\n", script, RUN_BENCH_RUNS);
+
+    for(RunBenchCase* bench = RunBenchCases; bench->name != 0; bench++) {
+
+        double seconds[RUN_BENCH_RUNS];
+        char* error = 0;
+
+        //One untimed run fills the page cache and the binary cache
+        for(int run = -1; run < RUN_BENCH_RUNS && error == 0; run++) {
+
+            double elapsed;
+
+            error = run_case(bench, script, directory, capture, output, &elapsed);
+
+            if(run >= 0) seconds[run] = elapsed;
+
+            if(error == 0 && !have_expected) {
+
+                strcpy(expected, output);
+                have_expected = 1;
+            }
+
+            if(error == 0 && strcmp(expected, output) != 0) error = "Output differs from the first case's";
+        }
+
+        if(error != 0) {
+
+            printf("  %-14s %s\n", bench->name, error);
+            failures++;
+
+            continue;
+        }
+
+        qsort(seconds, RUN_BENCH_RUNS, sizeof(double), compare_doubles);
+
+        if(bench == RunBenchCases) pipeline = seconds[RUN_BENCH_RUNS / 2];
+
+        printf("  %-14s %9.3f ms", bench->name, seconds[RUN_BENCH_RUNS / 2] * 1000);
+
+        if(pipeline != 0) printf("  %7.1fx", pipeline / seconds[RUN_BENCH_RUNS / 2]);
+
+        printf("\n");
+    }
+
+    return failures;
+}
+
+//Times each script from the command line, test.y by default, through the
+//edit-test loop of yc, cc and the binary, through yc -x with and without its
+//binary cache and through the interpreter, checking they all print the same
+int main(int argc, char** argv) {
+
+    char directory[] = "/tmp/yrunbench-XXXXXX";
+    FILE* capture = tmpfile();
+    int failures = 0;
+
+    if(capture == 0 || mkdtemp(directory) == 0) {
+
+        printf("Unable to set up the benchmark\n");
+
+        return 1;
+    }
+
+    if(argc < 2) failures += bench_script("test.y", directory, capture);
+
+    for(int i = 1; i < argc; i++) failures += bench_script(argv[i], directory, capture);
+
+    rmdir(directory);
+    fclose(capture);
+
+    return failures != 0;
+}
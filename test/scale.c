@@ -0,0 +1,189 @@
+#define _GNU_SOURCE
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../libyc.h"
+#include "../vec.h"
+
+//Declared names show up six times in the C output, so long names make the
+//output several times larger than the source that has to be held to get it
+#define SCALE_NAME_LENGTH 4096
+#define SCALE_PROBE_LAMBDAS 16
+#define SCALE_DOUBLINGS 4
+
+//Just past 2^31 bytes, where an int length would have wrapped
+#define SCALE_DEFAULT_MIB 2112
+
+double now() {
+
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+//Growth that would wrap has to fail instead of handing back a short buffer
+int check_overflow() {
+
+    char byte = 0;
+    String huge = { SIZE_MAX - 1, SIZE_MAX - 1, &byte };
+    String tail = { 2, 0, "ab" };
+    VEC(VoidPtr) list = { 0, SIZE_MAX / sizeof(void*), SIZE_MAX / sizeof(void*), 0 };
+
+    if(String_append(&huge, &tail) == 0) {
+
+        printf("Appending past SIZE_MAX succeeded\n");
+
+        return 1;
+    }
+
+    if(Vec_VoidPtr_add(&list, 0) == 0) {
+
+        printf("Growing a list past SIZE_MAX succeeded\n");
+
+        return 1;
+    }
+
+    return 0;
+}
+
+void scale_name(char* name, size_t index) {
+
+    sprintf(name, "f%zu_", index);
+    memset(&name[strlen(name)], 'x', SCALE_NAME_LENGTH - strlen(name));
+    name[SCALE_NAME_LENGTH] = 0;
+}
+
+//A module of lambdas with long, distinct names
+char* scale_source(size_t lambdas, size_t* length) {
+
+    char name[SCALE_NAME_LENGTH + 1];
+    char* source = (char*)malloc(lambdas * (SCALE_NAME_LENGTH + 32) + 1);
+
+    *length = 0;
+
+    if(source == 0) return 0;
+
+    for(size_t i = 0; i < lambdas; i++) {
+
+        scale_name(name, i);
+        *length += sprintf(&source[*length], "var %s = (var a) => a;\n", name);
+    }
+
+    return source;
+}
+
+//The last lambda's assignment is the last thing main does before the empty
+//expression each declaration leaves there
+int check_output(String* output, size_t lambdas) {
+
+    char name[SCALE_NAME_LENGTH + 1];
+    char expected[2 * SCALE_NAME_LENGTH + 16];
+    size_t tail = sizeof(expected) + lambdas + 64;
+
+    if(tail > output->length) tail = output->length;
+
+    scale_name(name, lambdas - 1);
+    sprintf(expected, "\n%s = Lambda_%s_", name, name);
+
+    return memmem(&output->data[output->length - tail], tail, expected, strlen(expected)) != 0;
+}
+
+//Renders modules of doubling size through YcContext_render, the last one
+//past target bytes of output, and fails if the render rate falls by more
+//than tolerance from one doubling to the next. Growth that is not
+//amortized linear, or a size that stops fitting an int, shows up here
+int main(int argc, char** argv) {
+
+    size_t target = (argc > 1 ? strtoull(argv[1], 0, 10) : SCALE_DEFAULT_MIB) << 20;
+    double tolerance = argc > 2 ? strtod(argv[2], 0) : 0.4;
+    YcContext context;
+    size_t length;
+    size_t lambda_bytes;
+    double last_rate = 0;
+    char* source;
+    char* error;
+
+    if(check_overflow() != 0) return 1;
+
+    if((error = YcContext_init(&context, 0, 0)) != 0) {
+
+        printf("Unable to set up a context: %s\n", error);
+
+        return 1;
+    }
+
+    //What one more lambda adds to the output, without the module's own text
+    for(int probe = 1; probe <= 2; probe++) {
+
+        if((source = scale_source(probe * SCALE_PROBE_LAMBDAS, &length)) == 0 ||
+            (error = YcContext_render(&context, source, length)) != 0) {
+
+            printf("Probe render failed: %s\n", source == 0 ? "out of memory" : error);
+
+            return 1;
+        }
+
+        free(source);
+
+        lambda_bytes = probe == 1 ? context.output->length : (context.output->length - lambda_bytes) / SCALE_PROBE_LAMBDAS;
+    }
+
+    for(int step = SCALE_DOUBLINGS - 1; step >= 0; step--) {
+
+        size_t lambdas = (target >> step) / lambda_bytes + 1;
+
+        if((source = scale_source(lambdas, &length)) == 0) {
+
+            printf("Unable to allocate %zu MiB of module source\n", length >> 20);
+
+            return 1;
+        }
+
+        double start = now();
+
+        error = YcContext_render(&context, source, length);
+
+        double seconds = now() - start;
+        double rate = context.output->length / (double)(1 << 20) / seconds;
+
+        free(source);
+
+        if(error != 0) {
+
+            printf("Render of %zu lambdas failed: %s\n", lambdas, error);
+
+            return 1;
+        }
+
+        printf("%8zu lambdas  %6zu MiB source  %6zu MiB output  %8.3f s  %8.1f MiB/s\n",
+            lambdas, length >> 20, context.output->length >> 20, seconds, rate);
+
+        if(context.output->length < (target >> step) || !check_output(context.output, lambdas)) {
+
+            printf("Output does not hold the rendered module\n");
+
+            return 1;
+        }
+
+        if(last_rate != 0 && rate < last_rate * (1 - tolerance)) {
+
+            printf("Render rate fell from %.1f to %.1f MiB/s when the module doubled\n", last_rate, rate);
+
+            return 1;
+        }
+
+        last_rate = rate;
+    }
+
+    printf("Rendered %zu bytes%s, rate held within %.0f%% per doubling\n", context.output->length,
+        context.output->length > INT_MAX ? ", past INT_MAX" : "", tolerance * 100);
+
+    YcContext_cleanUp(&context);
+
+    return 0;
+}
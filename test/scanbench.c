@@ -0,0 +1,186 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../scanner.h"
+
+#if defined(__x86_64__)
+#include <x86intrin.h>
+#define CYCLES() __rdtsc()
+#else
+#define CYCLES() 0ull
+#endif
+
+#define BENCH_SOURCE_BYTES (8 << 20)
+#define BENCH_PASSES 8
+#define BENCH_RUN_BYTES (64 << 10)
+#define BENCH_RUN_PASSES 256
+
+double now() {
+
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+//Deeply indented statements with a comment line above most of them, the
+//shape of the sources other tools generate for us
+char* bench_source(size_t* length) {
+
+    char* source = (char*)malloc(BENCH_SOURCE_BYTES + 256);
+    size_t count = 0;
+
+    if(source == 0) return 0;
+
+    for(int line = 0; count < BENCH_SOURCE_BYTES; line++) {
+
+        int depth = 2 + line % 18;
+
+        if(line % 3 != 0) {
+
+            count += sprintf(&source[count], "%*s// step %i of the generated pipeline, keep in sync\n", depth * 4, "", line);
+        }
+
+        count += sprintf(&source[count], "%*svar value_%i = add(value_%i, %i);\n", depth * 4, "", line, line / 2, line % 97);
+    }
+
+    *length = count;
+
+    return source;
+}
+
+//Walks the source the way the parser does: skip, take one token, repeat
+size_t bench_walk(char* source, size_t length) {
+
+    ScannerSource scanner;
+    size_t tokens = 0;
+
+    Scanner_init(&scanner, source, length);
+
+    while(1) {
+
+        ScannerSkipWhitespace(&scanner);
+
+        if(ScannerAtEnd(&scanner)) return tokens;
+
+        size_t run = Scanner_identifierLength(&scanner.data[scanner.position], scanner.length - scanner.position);
+
+        scanner.position += run == 0 ? 1 : run;
+        tokens++;
+    }
+}
+
+//Skip speed on its own, over whitespace runs of one length separated by a
+//single token byte
+void bench_runs(const ScannerSearches* searches) {
+
+    static char buffer[BENCH_RUN_BYTES];
+
+    printf("%-8s", searches->name);
+
+    for(size_t run = 1; run <= 128; run *= 2) {
+
+        memset(buffer, ' ', sizeof(buffer));
+
+        for(size_t i = run; i < sizeof(buffer); i += run + 1) buffer[i] = 'x';
+
+        unsigned long long start_cycles = CYCLES();
+
+        for(int pass = 0; pass < BENCH_RUN_PASSES; pass++) {
+
+            for(size_t position = 0; position < sizeof(buffer); position++) {
+
+                position += searches->whitespaceLength(&buffer[position], sizeof(buffer) - position);
+            }
+        }
+
+        unsigned long long cycles = CYCLES() - start_cycles;
+
+        printf(" %6.2f", cycles == 0 ? 0.0 : (double)sizeof(buffer) * BENCH_RUN_PASSES / cycles);
+    }
+
+    printf("\n");
+}
+
+//Times each set of scanner searches the CPU supports, first on whitespace
+//runs alone and then walking a whole source
+int main(int argc, char** argv) {
+
+    char* source;
+    size_t length;
+    size_t expected_tokens = 0;
+
+    if(argc > 1) {
+
+        FILE* in_file = fopen(argv[1], "r");
+
+        if(in_file == 0 || Scanner_readAll(in_file, &source, &length) != 0) {
+
+            printf("Unable to read input file %s\n", argv[1]);
+
+            return 1;
+        }
+
+        fclose(in_file);
+    } else if((source = bench_source(&length)) == 0) {
+
+        printf("Unable to allocate the benchmark source\n");
+
+        return 1;
+    }
+
+    printf("Whitespace bytes/cycle by run length\n        ");
+
+    for(size_t run = 1; run <= 128; run *= 2) printf(" %6zu", run);
+
+    printf("\n");
+
+    for(const ScannerSearches* searches = ScannerSearchesFor; searches->name != 0; searches++) {
+
+        if(ScannerSearches_supported(searches)) bench_runs(searches);
+    }
+
+    printf("\nWalking %zu bytes, %i passes\n", length, BENCH_PASSES);
+
+    for(const ScannerSearches* searches = ScannerSearchesFor; searches->name != 0; searches++) {
+
+        size_t tokens = 0;
+
+        if(Scanner_useSearches(searches->name) != 0) {
+
+            printf("%-8s unsupported\n", searches->name);
+
+            continue;
+        }
+
+        //One untimed pass to fault the pages in and warm the caches
+        bench_walk(source, length);
+
+        double start = now();
+        unsigned long long start_cycles = CYCLES();
+
+        for(int i = 0; i < BENCH_PASSES; i++) tokens = bench_walk(source, length);
+
+        unsigned long long cycles = CYCLES() - start_cycles;
+        double seconds = now() - start;
+
+        if(expected_tokens == 0) expected_tokens = tokens;
+
+        if(tokens != expected_tokens) {
+
+            printf("%-8s found %zu tokens instead of %zu\n", searches->name, tokens, expected_tokens);
+
+            return 1;
+        }
+
+        printf("%-8s %8.3f bytes/cycle  %8.1f MiB/s\n", searches->name,
+            cycles == 0 ? 0.0 : (double)length * BENCH_PASSES / cycles,
+            length * (double)BENCH_PASSES / (1 << 20) / seconds);
+    }
+
+    free(source);
+
+    return 0;
+}
@@ -0,0 +1,277 @@
+#define _GNU_SOURCE
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define SERVER_BENCH_RUNS 21
+#define SERVER_BENCH_ARGS 8
+#define SERVER_BENCH_OUTPUT_BYTES (1 << 16)
+#define SERVER_BENCH_START_SECONDS 5.0
+
+//Each case runs as ./yc followed by its arguments, once plain and once with
+//--client in front. SCRIPT and OUT_C stand for the script and a private output file
+typedef struct ServerBenchCase_s {
+    char* name;
+    char* args[SERVER_BENCH_ARGS];
+} ServerBenchCase;
+
+ServerBenchCase ServerBenchCases[] = {
+    { "write C", { "-o", "OUT_C", "SCRIPT", 0 } },
+    { "write C -O2", { "-O2", "-o", "OUT_C", "SCRIPT", 0 } },
+    { "interpret", { "-r", "SCRIPT", 0 } },
+    { 0 }
+};
+
+double now() {
+
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int compare_doubles(const void* a, const void* b) {
+
+    double difference = *(double*)a - *(double*)b;
+
+    return difference < 0 ? -1 : difference > 0;
+}
+
+//The server is ready once a client without arguments gets the usage back
+int server_ready(char* client) {
+
+    int status;
+    pid_t child;
+
+    fflush(stdout);
+
+    if((child = fork()) < 0) return 0;
+
+    if(child == 0) {
+
+        freopen("/dev/null", "w", stdout);
+        execl("./yc", "./yc", client, (char*)0);
+        _exit(127);
+    }
+
+    return waitpid(child, &status, 0) == child && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+char* start_server(char* socket_path, pid_t* server) {
+
+    char serve[4096];
+    char client[4096];
+    double deadline = now() + SERVER_BENCH_START_SECONDS;
+
+    snprintf(serve, sizeof(serve), "--serve=%s", socket_path);
+    snprintf(client, sizeof(client), "--client=%s", socket_path);
+
+    fflush(stdout);
+
+    if((*server = fork()) < 0) return "Unable to start the server";
+
+    if(*server == 0) {
+
+        execl("./yc", "./yc", serve, (char*)0);
+        _exit(127);
+    }
+
+    while(!server_ready(client)) {
+
+        if(waitpid(*server, 0, WNOHANG) != 0) {
+
+            *server = 0;
+
+            return "The server exited before accepting requests";
+        }
+
+        if(now() > deadline) return "The server did not start";
+
+        usleep(10000);
+    }
+
+    return 0;
+}
+
+//Runs ./yc once with stdout going to capture, then returns what it printed
+//followed by the file it wrote in output
+char* run_yc(ServerBenchCase* bench, char* client, char* script, char* out_c, FILE* capture, char* output, double* seconds) {
+
+    char* args[SERVER_BENCH_ARGS + 2];
+    int count = 0;
+    int status;
+    size_t length;
+    pid_t child;
+    FILE* out_file;
+
+    args[count++] = "./yc";
+
+    if(client != 0) args[count++] = client;
+
+    for(int i = 0; i < SERVER_BENCH_ARGS && bench->args[i] != 0; i++) {
+
+        args[count++] = strcmp(bench->args[i], "SCRIPT") == 0 ? script
+            : strcmp(bench->args[i], "OUT_C") == 0 ? out_c
+            : bench->args[i];
+    }
+
+    args[count] = 0;
+
+    unlink(out_c);
+    fflush(stdout);
+    rewind(capture);
+    ftruncate(fileno(capture), 0);
+
+    double start = now();
+
+    if((child = fork()) < 0) return "Unable to start yc";
+
+    if(child == 0) {
+
+        dup2(fileno(capture), 1);
+        execv(args[0], args);
+        _exit(127);
+    }
+
+    if(waitpid(child, &status, 0) != child || !WIFEXITED(status) || WEXITSTATUS(status) != 0) return "yc failed";
+
+    *seconds = now() - start;
+
+    rewind(capture);
+    length = fread(output, 1, SERVER_BENCH_OUTPUT_BYTES - 1, capture);
+
+    if((out_file = fopen(out_c, "r")) != 0) {
+
+        length += fread(&output[length], 1, SERVER_BENCH_OUTPUT_BYTES - 1 - length, out_file);
+        fclose(out_file);
+    }
+
+    output[length] = 0;
+
+    return 0;
+}
+
+//Times the runs of one case with or without client, checking each prints
+//and writes the same as the first plain run
+char* time_runs(ServerBenchCase* bench, char* client, char* script, char* out_c, FILE* capture, char* expected, double* median) {
+
+    char* output = (char*)malloc(SERVER_BENCH_OUTPUT_BYTES);
+    double seconds[SERVER_BENCH_RUNS];
+    char* error = 0;
+
+    if(output == 0) return "Failed to allocate space for the output";
+
+    //One untimed run fills the page cache and the server's parse cache
+    for(int run = -1; run < SERVER_BENCH_RUNS && error == 0; run++) {
+
+        double elapsed;
+
+        error = run_yc(bench, client, script, out_c, capture, output, &elapsed);
+
+        if(run >= 0) seconds[run] = elapsed;
+
+        if(error == 0 && client == 0 && run < 0) strcpy(expected, output);
+
+        if(error == 0 && strcmp(expected, output) != 0) error = "Output differs from plain yc's";
+    }
+
+    free(output);
+
+    if(error != 0) return error;
+
+    qsort(seconds, SERVER_BENCH_RUNS, sizeof(double), compare_doubles);
+
+    *median = seconds[SERVER_BENCH_RUNS / 2];
+
+    return 0;
+}
+
+int bench_script(char* script, char* socket_path, char* out_c, FILE* capture) {
+
+    char client[4096];
+    char* expected = (char*)malloc(SERVER_BENCH_OUTPUT_BYTES);
+    int failures = 0;
+
+    if(expected == 0) return 1;
+
+    snprintf(client, sizeof(client), "--client=%s", socket_path);
+
+    printf("%s, median of %i runs\n", script, SERVER_BENCH_RUNS);
+
+    for(ServerBenchCase* bench = ServerBenchCases; bench->name != 0; bench++) {
+
+        double plain;
+        double served;
+        char* error;
+
+        if(
+            (error = time_runs(bench, 0, script, out_c, capture, expected, &plain)) != 0 ||
+            (error = time_runs(bench, client, script, out_c, capture, expected, &served)) != 0
+        ) {
+
+            printf("  %-12s %s\n", bench->name, error);
+            failures++;
+
+            continue;
+        }
+
+        printf("  %-12s yc %8.3f ms  --client %8.3f ms  %6.1fx\n", bench->name, plain * 1000, served * 1000, plain / served);
+    }
+
+    free(expected);
+
+    return failures;
+}
+
+//Starts yc --serve on a private socket and times each script from the
+//command line, test.y by default, through plain yc runs and --client runs
+//against it, checking both print and write the same
+int main(int argc, char** argv) {
+
+    char directory[] = "/tmp/yserverbench-XXXXXX";
+    char socket_path[4096];
+    char out_c[4096];
+    FILE* capture = tmpfile();
+    pid_t server;
+    char* error;
+    int failures = 0;
+
+    if(capture == 0 || mkdtemp(directory) == 0) {
+
+        printf("Unable to set up the benchmark\n");
+
+        return 1;
+    }
+
+    snprintf(socket_path, sizeof(socket_path), "%s/yc.sock", directory);
+    snprintf(out_c, sizeof(out_c), "%s/out.c", directory);
+
+    if((error = start_server(socket_path, &server)) != 0) {
+
+        printf("%s\n", error);
+        failures++;
+    } else {
+
+        if(argc < 2) failures += bench_script("test.y", socket_path, out_c, capture);
+
+        for(int i = 1; i < argc; i++) failures += bench_script(argv[i], socket_path, out_c, capture);
+    }
+
+    if(server > 0) {
+
+        kill(server, SIGTERM);
+        waitpid(server, 0, 0);
+    }
+
+    unlink(out_c);
+    unlink(socket_path);
+    rmdir(directory);
+    fclose(capture);
+
+    return failures != 0;
+}
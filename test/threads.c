@@ -0,0 +1,112 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../libyc.h"
+
+#define OUTPUT_CAPACITY (1 << 20)
+
+typedef struct Worker_s {
+    pthread_t thread;
+    char* source;
+    size_t sourceLength;
+    char* expected;
+    int iterations;
+    int failures;
+} Worker;
+
+void* Worker_run(void* arg) {
+
+    Worker* worker = (Worker*)arg;
+    YcContext context;
+    size_t length;
+    char* output = (char*)malloc(OUTPUT_CAPACITY);
+    char* error;
+
+    if(output == 0 || (error = YcContext_init(&context, 2, 0)) != 0) {
+
+        worker->failures = worker->iterations;
+
+        return 0;
+    }
+
+    for(int i = 0; i < worker->iterations; i++) {
+
+        error = YcContext_compile(&context, worker->source, worker->sourceLength, output, OUTPUT_CAPACITY, &length);
+
+        if(error != 0 || strcmp(output, worker->expected) != 0) worker->failures++;
+    }
+
+    YcContext_cleanUp(&context);
+    free(output);
+
+    return 0;
+}
+
+double now() {
+
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+//Compiles the same module from every thread at once and checks each result
+//against a single-threaded compile
+int main(int argc, char** argv) {
+
+    char* in_name = argc > 1 ? argv[1] : "test.y";
+    int thread_count = argc > 2 ? atoi(argv[2]) : 8;
+    int iterations = argc > 3 ? atoi(argv[3]) : 1000;
+    char* source = (char*)malloc(OUTPUT_CAPACITY);
+    char* expected = (char*)malloc(OUTPUT_CAPACITY);
+    Worker workers[thread_count];
+    FILE* in_file = fopen(in_name, "r");
+    YcContext context;
+    size_t source_length, length;
+    char* error;
+    int failures = 0;
+
+    if(in_file == 0) {
+
+        printf("Unable to open input file %s\n", in_name);
+
+        return 1;
+    }
+
+    source_length = fread(source, 1, OUTPUT_CAPACITY, in_file);
+    fclose(in_file);
+
+    if((error = YcContext_init(&context, 2, 0)) != 0 ||
+        (error = YcContext_compile(&context, source, source_length, expected, OUTPUT_CAPACITY, &length)) != 0) {
+
+        printf("Reference compile failed: %s\n", error);
+
+        return 1;
+    }
+
+    YcContext_cleanUp(&context);
+
+    double start = now();
+
+    for(int i = 0; i < thread_count; i++) {
+
+        workers[i] = (Worker){ 0, source, source_length, expected, iterations, 0 };
+        pthread_create(&workers[i].thread, 0, Worker_run, &workers[i]);
+    }
+
+    for(int i = 0; i < thread_count; i++) {
+
+        pthread_join(workers[i].thread, 0);
+        failures += workers[i].failures;
+    }
+
+    double elapsed = now() - start;
+
+    printf("%d threads x %d compiles: %.3f s, %.0f compiles/s, %d mismatches\n",
+        thread_count, iterations, elapsed, thread_count * iterations / elapsed, failures);
+
+    return failures != 0;
+}
@@ -0,0 +1,215 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "../bytecode.h"
+#include "../interp.h"
+#include "../libyc.h"
+#include "../naming.h"
+#include "../parsecache.h"
+#include "../run.h"
+
+#define BENCH_DEFAULT_DEPTH 20
+#define BENCH_EVALUATIONS 3
+#define BENCH_RUNS 5
+#define BENCH_OUTPUT_BYTES 4096
+
+typedef char* (*BenchBackend)(ASTNode* module);
+
+typedef struct BenchCase_s {
+    char* name;
+    BenchBackend run;
+} BenchCase;
+
+double now() {
+
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int compare_doubles(const void* a, const void* b) {
+
+    double difference = *(double*)a - *(double*)b;
+
+    return difference < 0 ? -1 : difference > 0;
+}
+
+//A binary tree of calls depth lambdas deep, each level calling the next
+//twice and combining the results through sub, so the time goes into calls
+//and arithmetic rather than printing
+char* bench_source(int depth, size_t* length) {
+
+    char* source = (char*)malloc((size_t)depth * 96 + 256);
+    size_t count;
+
+    if(source == 0) return 0;
+
+    count = sprintf(source, "var sub = (var a, var b) => a - b;\n");
+
+    for(int i = 0; i < depth; i++) {
+
+        count += sprintf(&source[count], "var f%i = (var a) => sub(f%i(a + %i), f%i(a));\n", i, i + 1, i, i + 1);
+    }
+
+    count += sprintf(&source[count], "var f%i = (var a) => a * 3;\n", depth);
+
+    for(int i = 0; i < BENCH_EVALUATIONS; i++) count += sprintf(&source[count], "printf(\"%%d\\n\", f0(%i));\n", i);
+
+    *length = count;
+
+    return source;
+}
+
+char* bench_interpret(ASTNode* module) {
+
+    Interpreter interpreter;
+    char* error;
+
+    if((error = Interpreter_init(&interpreter, module)) == 0) error = Interpreter_run(&interpreter);
+
+    Interpreter_cleanUp(&interpreter);
+
+    return error;
+}
+
+char* bench_bytecode(ASTNode* module) {
+
+    BytecodeProgram program;
+    char* error;
+
+    if((error = BytecodeProgram_compile(&program, module)) != 0) return error;
+
+    error = VM_run(&program);
+
+    BytecodeProgram_cleanUp(&program);
+
+    return error;
+}
+
+//The first run builds and caches the binary, later ones time naming and
+//rendering the C again, the cache lookup and running it
+char* bench_compiled(ASTNode* module) {
+
+    RunOptions options;
+    int exit_status;
+    char* error;
+
+    RunOptions_init(&options);
+
+    if((error = Module_nameLambdas(module)) != 0) return error;
+
+    return Module_compileAndRun(module, &CTemplateConfig, &options, "yvmbench", 0, 0, &exit_status);
+}
+
+BenchCase BenchCases[] = {
+    { "tree walker", bench_interpret },
+    { "bytecode VM", bench_bytecode },
+    { "gcc output", bench_compiled },
+    { 0 }
+};
+
+//Runs one backend on a fresh parse with stdout going to capture, returning
+//what it printed in output
+char* bench_run(BenchCase* bench, char* source, size_t length, FILE* capture, char* output, double* seconds) {
+
+    ParseOptions options = { 0, 1 };
+    ASTNode* module = 0;
+    char* error;
+    size_t count;
+    int saved;
+
+    if((error = ParseCache_parseSource(source, length, &options, &module)) != 0) return error;
+
+    fflush(stdout);
+    rewind(capture);
+    ftruncate(fileno(capture), 0);
+
+    saved = dup(1);
+    dup2(fileno(capture), 1);
+
+    double start = now();
+
+    error = bench->run(module);
+    fflush(stdout);
+
+    *seconds = now() - start;
+
+    dup2(saved, 1);
+    close(saved);
+
+    ASTNode_cleanUp(module);
+
+    rewind(capture);
+    count = fread(output, 1, BENCH_OUTPUT_BYTES - 1, capture);
+    output[count] = 0;
+
+    return error;
+}
+
+//Times the tree-walking interpreter, the bytecode VM and the compiled C on
+//the same call-heavy module, checking they all print the same results
+int main(int argc, char** argv) {
+
+    int depth = argc > 1 ? (int)strtol(argv[1], 0, 10) : BENCH_DEFAULT_DEPTH;
+    double calls = ((2 << depth) + (1 << depth) - 2.0) * BENCH_EVALUATIONS;
+    double baseline = 0;
+    size_t length;
+    char* source = bench_source(depth, &length);
+    char expected[BENCH_OUTPUT_BYTES];
+    char output[BENCH_OUTPUT_BYTES];
+    FILE* capture = tmpfile();
+    int failures = 0;
+
+    if(source == 0 || capture == 0 || Yc_init() != 0) {
+
+        printf("Unable to set up the benchmark\n");
+
+        return 1;
+    }
+
+    printf("%.0f calls, median of %i runs\n", calls, BENCH_RUNS);
+
+    for(BenchCase* bench = BenchCases; bench->name != 0; bench++) {
+
+        double seconds[BENCH_RUNS];
+        char* error = 0;
+
+        //One untimed run warms the caches and the binary cache
+        for(int run = -1; run < BENCH_RUNS && error == 0; run++) {
+
+            double elapsed;
+
+            error = bench_run(bench, source, length, capture, output, &elapsed);
+
+            if(run >= 0) seconds[run] = elapsed;
+
+            if(error == 0 && bench == BenchCases && run < 0) strcpy(expected, output);
+
+            if(error == 0 && strcmp(expected, output) != 0) error = "Output differs from the tree walker's";
+        }
+
+        if(error != 0) {
+
+            printf("%-12s %s\n", bench->name, error);
+            failures++;
+
+            continue;
+        }
+
+        qsort(seconds, BENCH_RUNS, sizeof(double), compare_doubles);
+
+        if(baseline == 0) baseline = seconds[BENCH_RUNS / 2];
+
+        printf("%-12s %8.3f s  %8.1f M calls/s  %6.2fx\n", bench->name, seconds[BENCH_RUNS / 2],
+            calls / seconds[BENCH_RUNS / 2] / 1e6, baseline / seconds[BENCH_RUNS / 2]);
+    }
+
+    fclose(capture);
+    free(source);
+
+    return failures != 0;
+}
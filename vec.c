@@ -0,0 +1,61 @@
+#include "vec.h"
+#include "helpers.h"
+#include <stdint.h>
+#include <stdlib.h>
+
+//Grows to the next power of two that holds count + extra elements, so a run
+//of adds costs amortized constant time
+char* Vec_grow(void** data, size_t* capacity, size_t count, size_t extra, size_t element_size, Arena* arena) {
+
+    char* error;
+    size_t grown;
+    void* grown_data;
+
+    if(extra > SIZE_MAX - count) return "Vector would be too long";
+
+    if((error = size_grow(count + extra, element_size, &grown)) != 0) return error;
+
+    if(arena != 0) {
+
+        if((error = Arena_alloc(arena, grown * element_size, &grown_data)) != 0) return error;
+
+        if(count > 0) memcpy(grown_data, *data, count * element_size);
+    } else if((grown_data = realloc(*data, grown * element_size)) == 0) {
+
+        return "Failed to allocate space for a vector";
+    }
+
+    *data = grown_data;
+    *capacity = grown;
+
+    return 0;
+}
+
+//Arena storage is left alone, it goes away with the arena anyway
+char* Vec_shrink(void** data, size_t* capacity, size_t count, size_t element_size, Arena* arena) {
+
+    void* shrunk;
+
+    if(arena != 0 || count == *capacity) return 0;
+
+    if(count == 0) {
+
+        free(*data);
+        *data = 0;
+        *capacity = 0;
+
+        return 0;
+    }
+
+    if((shrunk = realloc(*data, count * element_size)) == 0) return "Failed to shrink a vector";
+
+    *data = shrunk;
+    *capacity = count;
+
+    return 0;
+}
+
+void Vec_free(void* data, Arena* arena) {
+
+    if(arena == 0) free(data);
+}
@@ -0,0 +1,71 @@
+#ifndef VEC_H
+#define VEC_H
+
+#include "arena.h"
+#include <stddef.h>
+#include <string.h>
+
+//VEC(T) is a growable array holding its T elements inline. VEC_DECLARE(T)
+//generates the type and its Vec_T_* functions once per element type, so T
+//has to be a single identifier (typedef pointers as TPtr). A vector given an
+//arena takes its storage from the arena and never frees it
+#define VEC(T) Vec_ ## T
+
+char* Vec_grow(void** data, size_t* capacity, size_t count, size_t extra, size_t element_size, Arena* arena);
+
+char* Vec_shrink(void** data, size_t* capacity, size_t count, size_t element_size, Arena* arena);
+
+void Vec_free(void* data, Arena* arena);
+
+#define VEC_DECLARE(T) \
+    typedef struct Vec_ ## T ## _s { \
+        T* data; \
+        size_t count; \
+        size_t capacity; \
+        Arena* arena; \
+    } Vec_ ## T; \
+    \
+    static inline void Vec_ ## T ## _init(Vec_ ## T* vec, Arena* arena) { \
+        vec->data = 0; \
+        vec->count = 0; \
+        vec->capacity = 0; \
+        vec->arena = arena; \
+    } \
+    \
+    static inline char* Vec_ ## T ## _reserve(Vec_ ## T* vec, size_t extra) { \
+        if(extra <= vec->capacity - vec->count) return 0; \
+        return Vec_grow((void**)&vec->data, &vec->capacity, vec->count, extra, sizeof(T), vec->arena); \
+    } \
+    \
+    static inline char* Vec_ ## T ## _add(Vec_ ## T* vec, T entry) { \
+        char* error; \
+        if(vec->count == vec->capacity && (error = Vec_ ## T ## _reserve(vec, 1)) != 0) return error; \
+        vec->data[vec->count++] = entry; \
+        return 0; \
+    } \
+    \
+    static inline char* Vec_ ## T ## _append(Vec_ ## T* vec, const T* entries, size_t count) { \
+        char* error; \
+        if(count == 0) return 0; \
+        if((error = Vec_ ## T ## _reserve(vec, count)) != 0) return error; \
+        memcpy(&vec->data[vec->count], entries, count * sizeof(T)); \
+        vec->count += count; \
+        return 0; \
+    } \
+    \
+    static inline char* Vec_ ## T ## _shrink(Vec_ ## T* vec) { \
+        return Vec_shrink((void**)&vec->data, &vec->capacity, vec->count, sizeof(T), vec->arena); \
+    } \
+    \
+    static inline void Vec_ ## T ## _cleanUp(Vec_ ## T* vec) { \
+        Vec_free(vec->data, vec->arena); \
+        Vec_ ## T ## _init(vec, vec->arena); \
+    }
+
+typedef void* VoidPtr;
+typedef char* CharPtr;
+
+VEC_DECLARE(VoidPtr)
+VEC_DECLARE(CharPtr)
+
+#endif //VEC_H